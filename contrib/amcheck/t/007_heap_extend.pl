@@ -0,0 +1,103 @@
+
+# Copyright (c) 2025, PostgreSQL Global Development Group
+
+# Test extension of a heap relation by concurrent COPYs and by many
+# concurrent single-row inserts.  Once enough backends are waiting to extend
+# the relation, it is pre-extended on disk and the new pages are handed out
+# through the FSM.  Check that that happens, that all rows arrive and that
+# the heap is sound.
+use strict;
+use warnings FATAL => 'all';
+
+use PostgreSQL::Test::Cluster;
+use PostgreSQL::Test::Utils;
+
+use Test::More;
+
+my $node = PostgreSQL::Test::Cluster->new('heap_extend');
+$node->init;
+$node->append_conf(
+	'postgresql.conf', qq(
+autovacuum = off
+log_min_messages = debug1
+max_connections = 40
+));
+$node->start;
+$node->safe_psql('postgres', q(CREATE EXTENSION amcheck));
+$node->safe_psql('postgres', q(CREATE TABLE tbl(i int, t text)));
+
+# Enough data per COPY to extend the relation many times over
+my $nrows = 25000;
+my $copy_file = $node->basedir . '/copy_data.txt';
+my $filler = 'x' x 90;
+PostgreSQL::Test::Utils::append_to_file($copy_file,
+	join('', map { "$_\t$filler\n" } 1 .. $nrows));
+
+my $clients = 4;
+my $transactions = 4;
+$node->pgbench(
+	"--no-vacuum --client=$clients --transactions=$transactions",
+	0,
+	[qr{actually processed}],
+	[qr{^$}],
+	'concurrent COPYs',
+	{ '007_heap_extend_copy' => qq(COPY tbl FROM '$copy_file';) });
+
+my $result =
+  $node->safe_psql('postgres', q(SELECT count(*), count(DISTINCT i) FROM tbl));
+is($result, ($nrows * $clients * $transactions) . "|$nrows",
+	'all rows loaded');
+
+# Inserts that find free pages left by the COPYs through the FSM
+$node->safe_psql('postgres',
+	q(INSERT INTO tbl SELECT g, 'y' FROM generate_series(1, 1000) g));
+
+$result = $node->safe_psql('postgres',
+	q(SELECT count(*) FROM verify_heapam('tbl')));
+is($result, '0', 'no corruption after concurrent extension');
+
+$node->safe_psql('postgres', q(VACUUM tbl));
+$result = $node->safe_psql('postgres',
+	q(SELECT count(*) FROM verify_heapam('tbl')));
+is($result, '0', 'no corruption after vacuum');
+
+# Many clients inserting one wide row at a time, into a table that is large
+# enough to be pre-extended.  Each row takes a quarter of a page, so the
+# clients keep running out of space and queue up for the extension lock.
+$node->safe_psql(
+	'postgres', q(
+CREATE TABLE tbl2(i int, t text);
+ALTER TABLE tbl2 ALTER COLUMN t SET STORAGE PLAIN;
+INSERT INTO tbl2 SELECT g, repeat('x', 1800) FROM generate_series(1, 8000) g;
+));
+
+my $offset = -s $node->logfile;
+
+$clients = 32;
+$transactions = 500;
+$node->pgbench(
+	"--no-vacuum --client=$clients --transactions=$transactions",
+	0,
+	[qr{actually processed}],
+	[qr{^$}],
+	'concurrent single-row inserts',
+	{
+		'007_heap_extend_insert' =>
+		  q(INSERT INTO tbl2 VALUES (1, repeat('y', 1800));)
+	});
+
+ok( $node->log_contains(qr/pre-extended relation "tbl2" by \d+ blocks/,
+		$offset),
+	'relation pre-extended for single-row inserts');
+
+$result = $node->safe_psql('postgres',
+	q(SELECT count(*), count(*) FILTER (WHERE i = 1) FROM tbl2));
+is($result, (8000 + $clients * $transactions) . '|' . (1 + $clients * $transactions),
+	'all single-row inserts arrived');
+
+$result = $node->safe_psql('postgres',
+	q(SELECT count(*) FROM verify_heapam('tbl2')));
+is($result, '0', 'no corruption after concurrent single-row inserts');
+
+$node->stop;
+done_testing();
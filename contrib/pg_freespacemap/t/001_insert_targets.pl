@@ -0,0 +1,106 @@
+# Copyright (c) 2025, PostgreSQL Global Development Group
+
+# Test how the insert_targets storage parameter spreads inserts from
+# different backends over the pages the free space map knows about.
+use strict;
+use warnings FATAL => 'all';
+
+use PostgreSQL::Test::Cluster;
+use PostgreSQL::Test::Utils;
+
+use Test::More;
+
+my $node = PostgreSQL::Test::Cluster->new('main');
+$node->init;
+$node->append_conf('postgresql.conf', 'autovacuum = off');
+$node->start;
+
+$node->safe_psql('postgres', 'CREATE EXTENSION pg_freespacemap');
+
+# Create a table of 1000 pages with 7 rows each.  With fillfactor 100, the
+# space left on each page is too small for another row.
+sub create_table
+{
+	my ($name, $insert_targets) = @_;
+
+	$node->safe_psql(
+		'postgres', qq{
+CREATE TABLE $name (id int, t text) WITH (insert_targets = $insert_targets);
+ALTER TABLE $name ALTER COLUMN t SET STORAGE plain;
+INSERT INTO $name SELECT g, repeat('x', 1000) FROM generate_series(1, 7000) g;
+});
+}
+
+# Block number of a row inserted by the given session, which has not
+# inserted into the table before.
+sub insert_block
+{
+	my ($session, $name) = @_;
+
+	return $session->query_safe(
+		"INSERT INTO $name VALUES (0, repeat('x', 1000)) RETURNING (ctid::text::point)[0]::int"
+	);
+}
+
+# Insert one row from each of four backends that are connected at the same
+# time, and return the number of distinct blocks the rows went to.
+sub distinct_insert_blocks
+{
+	my ($name) = @_;
+	my @sessions = map { $node->background_psql('postgres') } 1 .. 4;
+	my %blocks;
+
+	$blocks{ insert_block($_, $name) } = 1 foreach @sessions;
+	$_->quit foreach @sessions;
+
+	return scalar(keys %blocks);
+}
+
+# Empty all pages and record their free space in the FSM, without
+# truncating the table.
+foreach my $targets (1, 1024)
+{
+	create_table("spread_$targets", $targets);
+	$node->safe_psql(
+		'postgres', qq{
+DELETE FROM spread_$targets;
+VACUUM (TRUNCATE false) spread_$targets;
+});
+}
+
+# Without insert_targets, each backend asks the FSM for a page starting at
+# the same hint, and all of them get the same page.
+is(distinct_insert_blocks('spread_1'),
+	1, 'without insert_targets, backends insert into the same page');
+
+# With insert_targets, each backend starts at a different offset from the
+# hint.  Only one of them can have an offset of zero, so at least three of
+# the four rows go to distinct pages.
+cmp_ok(distinct_insert_blocks('spread_1024'),
+	'>=', 3, 'with insert_targets, backends insert into different pages');
+
+# If the only page with free space is not at the backend's offset, the FSM
+# search must still find it rather than extend the table.  Here only the
+# first page has room, so the search has to wrap around.
+create_table('wrap', 1024);
+$node->safe_psql(
+	'postgres', q{
+DELETE FROM wrap WHERE ctid < '(1,0)';
+VACUUM (TRUNCATE false) wrap;
+});
+is( $node->safe_psql(
+		'postgres',
+		"SELECT count(*) FROM pg_freespace('wrap') WHERE avail >= 1100"),
+	'1',
+	'only one page has room for a row');
+
+my $size = $node->safe_psql('postgres', "SELECT pg_relation_size('wrap')");
+my $session = $node->background_psql('postgres');
+is(insert_block($session, 'wrap'),
+	'0', 'insert goes to the only page with free space');
+$session->quit;
+is($node->safe_psql('postgres', "SELECT pg_relation_size('wrap')"),
+	$size, 'table was not extended');
+
+$node->stop;
+done_testing();
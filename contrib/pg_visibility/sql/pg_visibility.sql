@@ -164,6 +164,37 @@ commit;
 select * from pg_visibility_map('copyfreeze');
 select * from pg_check_frozen('copyfreeze');
 
+-- Check that eager_page_freezing freezes pages outside of VACUUM.
+set eager_page_freezing = on;
+
+-- On-access pruning: HOT-update some rows on a nearly full page, so that the
+-- next scan prunes it, and freezes it while at it.
+create table eager_prune (a int, b text) with (autovacuum_enabled = off);
+insert into eager_prune select g, repeat('x', 100) from generate_series(1, 50) g;
+update eager_prune set a = -a where a <= 3;
+select * from pg_visibility_map('eager_prune');
+select count(*) from eager_prune;
+select * from pg_visibility_map('eager_prune');
+select * from pg_check_frozen('eager_prune');
+
+-- Filled pages: with eager_page_freezing_on_insert, once rows inserted by
+-- earlier transactions have filled a page, the insert that moves on to the
+-- next page freezes it.
+set eager_page_freezing_on_insert = on;
+create table eager_insert (a int, b text) with (autovacuum_enabled = off);
+do $$
+begin
+  for i in 1..100 loop
+    insert into eager_insert values (i, repeat('x', 100));
+    commit;
+  end loop;
+end
+$$;
+select * from pg_visibility_map('eager_insert');
+select * from pg_check_frozen('eager_insert');
+reset eager_page_freezing_on_insert;
+reset eager_page_freezing;
+
 -- cleanup
 drop table test_partitioned;
 drop view test_view;
@@ -174,3 +205,5 @@ drop foreign data wrapper dummy;
 drop materialized view matview_visibility_test;
 drop table regular_table;
 drop table copyfreeze;
+drop table eager_prune;
+drop table eager_insert;
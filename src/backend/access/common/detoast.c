@@ -17,11 +17,60 @@
 #include "access/table.h"
 #include "access/tableam.h"
 #include "access/toast_internals.h"
+#include "access/xact.h"
 #include "common/int.h"
 #include "common/pg_lzcompress.h"
+#include "executor/instrument.h"
+#include "lib/ilist.h"
 #include "utils/expandeddatum.h"
+#include "utils/hsearch.h"
+#include "utils/memutils.h"
 #include "utils/rel.h"
 
+/* GUC */
+int			detoast_cache_size = 0;
+
+/*
+ * Cache of recently detoasted external values.
+ *
+ * Queries that reference the same large value several times, for example in
+ * several expressions or on the inner side of a nested loop, would otherwise
+ * fetch it from the TOAST table and decompress it again each time.  A value
+ * stored in a TOAST table never changes until it's deleted, so the fully
+ * detoasted form can be remembered, keyed by the toast relation and value
+ * OID.  The cache lives in a child of TopTransactionContext and so goes away
+ * at the end of each transaction; we don't try to keep it any longer, because
+ * a value OID can be reused once the value has been deleted and vacuumed.
+ * As an additional safeguard, the raw size in the toast pointer must match
+ * too.
+ *
+ * The total size of the cached values is limited to detoast_cache_size
+ * kilobytes; the least recently used values are evicted to make room.
+ */
+typedef struct DetoastCacheKey
+{
+	Oid			toastrelid;		/* OID of the TOAST table */
+	Oid			valueid;		/* OID of the value within it */
+} DetoastCacheKey;
+
+typedef struct DetoastCacheEntry
+{
+	DetoastCacheKey key;		/* hash key; must be first */
+	int32		rawsize;		/* va_rawsize of the toast pointer */
+	struct varlena *value;		/* detoasted value */
+	dlist_node	lru_node;		/* position in LRU list */
+} DetoastCacheEntry;
+
+static MemoryContext DetoastCacheContext = NULL;
+static HTAB *DetoastCacheHash = NULL;
+static dlist_head DetoastCacheLRU;	/* most recently used first */
+static Size DetoastCacheUsed = 0;
+
+static struct varlena *detoast_cache_lookup(struct varlena *attr);
+static void detoast_cache_insert(struct varlena *attr, struct varlena *value);
+static void detoast_cache_remove(DetoastCacheEntry *entry);
+static void detoast_cache_reset(void *arg);
+
 static struct varlena *toast_fetch_datum(struct varlena *attr);
 static struct varlena *toast_fetch_datum_slice(struct varlena *attr,
 											   int32 sliceoffset,
@@ -117,6 +166,14 @@ detoast_attr(struct varlena *attr)
 {
 	if (VARATT_IS_EXTERNAL_ONDISK(attr))
 	{
+		struct varlena *toast_ptr = attr;
+		struct varlena *cached;
+
+		/* Maybe we've detoasted this very value recently */
+		cached = detoast_cache_lookup(toast_ptr);
+		if (cached != NULL)
+			return cached;
+
 		/*
 		 * This is an externally stored datum --- fetch it back from there
 		 */
@@ -129,6 +186,8 @@ detoast_attr(struct varlena *attr)
 			attr = toast_decompress_datum(tmp);
 			pfree(tmp);
 		}
+
+		detoast_cache_insert(toast_ptr, attr);
 	}
 	else if (VARATT_IS_EXTERNAL_INDIRECT(attr))
 	{
@@ -246,10 +305,10 @@ detoast_attr_slice(struct varlena *attr,
 			 * Determine maximum amount of compressed data needed for a prefix
 			 * of a given length (after decompression).
 			 *
-			 * At least for now, if it's LZ4 data, we'll have to fetch the
-			 * whole thing, because there doesn't seem to be an API call to
-			 * determine how much compressed data we need to be sure of being
-			 * able to decompress the required slice.
+			 * At least for now, if it's LZ4 or zstd data, we'll have to fetch
+			 * the whole thing, because there doesn't seem to be an API call
+			 * to determine how much compressed data we need to be sure of
+			 * being able to decompress the required slice.
 			 */
 			if (VARATT_EXTERNAL_GET_COMPRESS_METHOD(toast_pointer) ==
 				TOAST_PGLZ_COMPRESSION_ID)
@@ -485,6 +544,13 @@ toast_decompress_datum(struct varlena *attr)
 			return pglz_decompress_datum(attr);
 		case TOAST_LZ4_COMPRESSION_ID:
 			return lz4_decompress_datum(attr);
+		case TOAST_ZSTD_COMPRESSION_ID:
+			return zstd_decompress_datum(attr);
+		case TOAST_EXTENDED_COMPRESSION_ID:
+			ereport(ERROR,
+					(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+					 errmsg("extended compression headers are not supported")));
+			return NULL;		/* keep compiler quiet */
 		default:
 			elog(ERROR, "invalid compression method id %d", cmid);
 			return NULL;		/* keep compiler quiet */
@@ -528,12 +594,167 @@ toast_decompress_datum_slice(struct varlena *attr, int32 slicelength)
 			return pglz_decompress_datum_slice(attr, slicelength);
 		case TOAST_LZ4_COMPRESSION_ID:
 			return lz4_decompress_datum_slice(attr, slicelength);
+		case TOAST_ZSTD_COMPRESSION_ID:
+			return zstd_decompress_datum_slice(attr, slicelength);
+		case TOAST_EXTENDED_COMPRESSION_ID:
+			ereport(ERROR,
+					(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+					 errmsg("extended compression headers are not supported")));
+			return NULL;		/* keep compiler quiet */
 		default:
 			elog(ERROR, "invalid compression method id %d", cmid);
 			return NULL;		/* keep compiler quiet */
 	}
 }
 
+/* ----------
+ * detoast_cache_lookup -
+ *
+ *	Return a palloc'd copy of the detoasted form of the value that the
+ *	given on-disk toast pointer refers to, if it's in the detoast cache.
+ *	Returns NULL if not.
+ * ----------
+ */
+static struct varlena *
+detoast_cache_lookup(struct varlena *attr)
+{
+	struct varatt_external toast_pointer;
+	DetoastCacheKey key;
+	DetoastCacheEntry *entry;
+	struct varlena *result;
+
+	if (detoast_cache_size <= 0 || DetoastCacheHash == NULL)
+		return NULL;
+
+	VARATT_EXTERNAL_GET_POINTER(toast_pointer, attr);
+
+	memset(&key, 0, sizeof(key));
+	key.toastrelid = toast_pointer.va_toastrelid;
+	key.valueid = toast_pointer.va_valueid;
+
+	entry = (DetoastCacheEntry *) hash_search(DetoastCacheHash, &key,
+											  HASH_FIND, NULL);
+	if (entry == NULL || entry->rawsize != toast_pointer.va_rawsize)
+		return NULL;
+
+	dlist_move_head(&DetoastCacheLRU, &entry->lru_node);
+	pgBufferUsage.detoast_cache_hits++;
+
+	result = (struct varlena *) palloc(VARSIZE(entry->value));
+	memcpy(result, entry->value, VARSIZE(entry->value));
+
+	return result;
+}
+
+/* ----------
+ * detoast_cache_insert -
+ *
+ *	Remember the detoasted form of the value that the given on-disk toast
+ *	pointer refers to, evicting older values as needed to stay within
+ *	detoast_cache_size.  The caller keeps ownership of 'value'.
+ * ----------
+ */
+static void
+detoast_cache_insert(struct varlena *attr, struct varlena *value)
+{
+	struct varatt_external toast_pointer;
+	DetoastCacheKey key;
+	DetoastCacheEntry *entry;
+	Size		limit;
+	Size		size;
+	bool		found;
+
+	if (detoast_cache_size <= 0 || !IsTransactionState())
+		return;
+
+	pgBufferUsage.detoast_cache_misses++;
+
+	limit = (Size) detoast_cache_size * 1024;
+	size = VARSIZE(value) + sizeof(DetoastCacheEntry);
+	if (size > limit)
+		return;
+
+	/* Create the cache on first use in this transaction */
+	if (DetoastCacheHash == NULL)
+	{
+		HASHCTL		ctl;
+		MemoryContextCallback *cb;
+
+		DetoastCacheContext = AllocSetContextCreate(TopTransactionContext,
+													"Detoast cache",
+													ALLOCSET_DEFAULT_SIZES);
+
+		ctl.keysize = sizeof(DetoastCacheKey);
+		ctl.entrysize = sizeof(DetoastCacheEntry);
+		ctl.hcxt = DetoastCacheContext;
+		DetoastCacheHash = hash_create("Detoast cache", 64, &ctl,
+									   HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+		dlist_init(&DetoastCacheLRU);
+		DetoastCacheUsed = 0;
+
+		/* forget about the cache when the transaction ends */
+		cb = MemoryContextAlloc(DetoastCacheContext,
+								sizeof(MemoryContextCallback));
+		cb->func = detoast_cache_reset;
+		cb->arg = NULL;
+		MemoryContextRegisterResetCallback(DetoastCacheContext, cb);
+	}
+
+	VARATT_EXTERNAL_GET_POINTER(toast_pointer, attr);
+
+	memset(&key, 0, sizeof(key));
+	key.toastrelid = toast_pointer.va_toastrelid;
+	key.valueid = toast_pointer.va_valueid;
+
+	/* Drop a stale entry for the same value OID, if any */
+	entry = (DetoastCacheEntry *) hash_search(DetoastCacheHash, &key,
+											  HASH_FIND, NULL);
+	if (entry != NULL)
+		detoast_cache_remove(entry);
+
+	/* Make room */
+	while (DetoastCacheUsed + size > limit)
+	{
+		Assert(!dlist_is_empty(&DetoastCacheLRU));
+		detoast_cache_remove(dlist_tail_element(DetoastCacheEntry, lru_node,
+												&DetoastCacheLRU));
+	}
+
+	entry = (DetoastCacheEntry *) hash_search(DetoastCacheHash, &key,
+											  HASH_ENTER, &found);
+	Assert(!found);
+	entry->rawsize = toast_pointer.va_rawsize;
+	entry->value = (struct varlena *) MemoryContextAlloc(DetoastCacheContext,
+														 VARSIZE(value));
+	memcpy(entry->value, value, VARSIZE(value));
+	dlist_push_head(&DetoastCacheLRU, &entry->lru_node);
+	DetoastCacheUsed += size;
+}
+
+/*
+ * Remove an entry from the detoast cache.
+ */
+static void
+detoast_cache_remove(DetoastCacheEntry *entry)
+{
+	DetoastCacheUsed -= VARSIZE(entry->value) + sizeof(DetoastCacheEntry);
+	dlist_delete(&entry->lru_node);
+	pfree(entry->value);
+	hash_search(DetoastCacheHash, &entry->key, HASH_REMOVE, NULL);
+}
+
+/*
+ * Memory context callback, called when the detoast cache's memory is
+ * released at the end of the transaction.
+ */
+static void
+detoast_cache_reset(void *arg)
+{
+	DetoastCacheContext = NULL;
+	DetoastCacheHash = NULL;
+	DetoastCacheUsed = 0;
+}
+
 /* ----------
  * toast_raw_datum_size -
  *
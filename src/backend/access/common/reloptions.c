@@ -337,6 +337,15 @@ static relopt_int intRelOpts[] =
 		},
 		TOAST_TUPLE_TARGET, 128, TOAST_TUPLE_TARGET_MAIN
 	},
+	{
+		{
+			"insert_targets",
+			"Number of distinct pages that concurrent inserts are spread across",
+			RELOPT_KIND_HEAP,
+			ShareUpdateExclusiveLock
+		},
+		1, 1, 1024
+	},
 	{
 		{
 			"pages_per_range",
@@ -1898,6 +1907,8 @@ default_reloptions(Datum reloptions, bool validate, relopt_kind kind)
 		offsetof(StdRdOptions, autovacuum) + offsetof(AutoVacOpts, log_min_duration)},
 		{"toast_tuple_target", RELOPT_TYPE_INT,
 		offsetof(StdRdOptions, toast_tuple_target)},
+		{"insert_targets", RELOPT_TYPE_INT,
+		offsetof(StdRdOptions, insert_targets)},
 		{"autovacuum_vacuum_cost_delay", RELOPT_TYPE_REAL,
 		offsetof(StdRdOptions, autovacuum) + offsetof(AutoVacOpts, vacuum_cost_delay)},
 		{"autovacuum_vacuum_scale_factor", RELOPT_TYPE_REAL,
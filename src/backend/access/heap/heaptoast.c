@@ -30,8 +30,39 @@
 #include "access/heaptoast.h"
 #include "access/toast_helper.h"
 #include "access/toast_internals.h"
+#include "catalog/index.h"
+#include "storage/read_stream.h"
 #include "utils/fmgroids.h"
 
+/*
+ * TOAST values with at least this many chunks are read through a read
+ * stream; see heap_fetch_toast_chunks_stream().
+ */
+#define TOAST_STREAM_MIN_CHUNKS		32
+
+/* State of heap_fetch_toast_slice() */
+typedef struct ToastSliceFetch
+{
+	Relation	toastrel;
+	Oid			valueid;
+	int32		attrsize;		/* total size of the value */
+	int32		totalchunks;	/* total number of chunks of the value */
+	int32		sliceoffset;
+	int32		slicelength;
+	int32		startchunk;		/* first chunk of the slice */
+	int32		endchunk;		/* last chunk of the slice */
+	int32		expectedchunk;	/* next chunk to copy */
+	struct varlena *result;
+} ToastSliceFetch;
+
+/* Private data of toast_chunk_stream_cb() */
+typedef struct ToastChunkStreamPrivate
+{
+	ItemPointerData *tids;		/* TIDs of the chunks, in chunk order */
+	int			ntids;
+	int			next;			/* next TID to return the block of */
+} ToastChunkStreamPrivate;
+
 
 /* ----------
  * heap_toast_delete -
@@ -612,6 +643,219 @@ toast_build_flattened_tuple(TupleDesc tupleDesc,
 	return new_tuple;
 }
 
+/*
+ * Copy the data of one TOAST chunk into the proper place of the result of
+ * heap_fetch_toast_slice(), after checking that it's the chunk we expected.
+ */
+static void
+heap_toast_copy_chunk(ToastSliceFetch *fetch, HeapTuple ttup)
+{
+	TupleDesc	toasttupDesc = fetch->toastrel->rd_att;
+	int32		curchunk;
+	Pointer		chunk;
+	bool		isnull;
+	char	   *chunkdata;
+	int32		chunksize;
+	int32		expected_size;
+	int32		chcpystrt;
+	int32		chcpyend;
+
+	/*
+	 * Have a chunk, extract the sequence number and the data
+	 */
+	curchunk = DatumGetInt32(fastgetattr(ttup, 2, toasttupDesc, &isnull));
+	Assert(!isnull);
+	chunk = DatumGetPointer(fastgetattr(ttup, 3, toasttupDesc, &isnull));
+	Assert(!isnull);
+	if (!VARATT_IS_EXTENDED(chunk))
+	{
+		chunksize = VARSIZE(chunk) - VARHDRSZ;
+		chunkdata = VARDATA(chunk);
+	}
+	else if (VARATT_IS_SHORT(chunk))
+	{
+		/* could happen due to heap_form_tuple doing its thing */
+		chunksize = VARSIZE_SHORT(chunk) - VARHDRSZ_SHORT;
+		chunkdata = VARDATA_SHORT(chunk);
+	}
+	else
+	{
+		/* should never happen */
+		elog(ERROR, "found toasted toast chunk for toast value %u in %s",
+			 fetch->valueid, RelationGetRelationName(fetch->toastrel));
+		chunksize = 0;			/* keep compiler quiet */
+		chunkdata = NULL;
+	}
+
+	/*
+	 * Some checks on the data we've found
+	 */
+	if (curchunk != fetch->expectedchunk)
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg_internal("unexpected chunk number %d (expected %d) for toast value %u in %s",
+								 curchunk, fetch->expectedchunk, fetch->valueid,
+								 RelationGetRelationName(fetch->toastrel))));
+	if (curchunk > fetch->endchunk)
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg_internal("unexpected chunk number %d (out of range %d..%d) for toast value %u in %s",
+								 curchunk,
+								 fetch->startchunk, fetch->endchunk,
+								 fetch->valueid,
+								 RelationGetRelationName(fetch->toastrel))));
+	expected_size = curchunk < fetch->totalchunks - 1 ? TOAST_MAX_CHUNK_SIZE
+		: fetch->attrsize - ((fetch->totalchunks - 1) * TOAST_MAX_CHUNK_SIZE);
+	if (chunksize != expected_size)
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg_internal("unexpected chunk size %d (expected %d) in chunk %d of %d for toast value %u in %s",
+								 chunksize, expected_size,
+								 curchunk, fetch->totalchunks, fetch->valueid,
+								 RelationGetRelationName(fetch->toastrel))));
+
+	/*
+	 * Copy the data into proper place in our result
+	 */
+	chcpystrt = 0;
+	chcpyend = chunksize - 1;
+	if (curchunk == fetch->startchunk)
+		chcpystrt = fetch->sliceoffset % TOAST_MAX_CHUNK_SIZE;
+	if (curchunk == fetch->endchunk)
+		chcpyend = (fetch->sliceoffset + fetch->slicelength - 1) % TOAST_MAX_CHUNK_SIZE;
+
+	memcpy(VARDATA(fetch->result) +
+		   (curchunk * TOAST_MAX_CHUNK_SIZE - fetch->sliceoffset) + chcpystrt,
+		   chunkdata + chcpystrt,
+		   (chcpyend - chcpystrt) + 1);
+
+	fetch->expectedchunk++;
+}
+
+/*
+ * Read stream callback for heap_fetch_toast_chunks_stream().  Returns the
+ * blocks holding the chunks in chunk order, but each run of chunks stored in
+ * the same block only once.
+ */
+static BlockNumber
+toast_chunk_stream_cb(ReadStream *stream,
+					  void *callback_private_data,
+					  void *per_buffer_data)
+{
+	ToastChunkStreamPrivate *p = callback_private_data;
+	BlockNumber blkno;
+
+	if (p->next >= p->ntids)
+		return InvalidBlockNumber;
+
+	blkno = ItemPointerGetBlockNumber(&p->tids[p->next]);
+	do
+		p->next++;
+	while (p->next < p->ntids &&
+		   ItemPointerGetBlockNumber(&p->tids[p->next]) == blkno);
+
+	return blkno;
+}
+
+/*
+ * Fetch the chunks of a large TOAST value for heap_fetch_toast_slice().
+ *
+ * Fetching the chunks one at a time through the index means waiting for a
+ * synchronous read of each heap block, which makes reading a large value from
+ * cold storage very slow.  Instead, we first collect the TIDs of all the
+ * chunks from the index, and then read the heap blocks through a read stream,
+ * so that the I/O can be started well before we need each block.
+ */
+static void
+heap_fetch_toast_chunks_stream(ToastSliceFetch *fetch, Relation toastidx,
+							   Snapshot snapshot,
+							   int nscankeys, ScanKey toastkey)
+{
+	IndexScanDesc scan;
+	ItemPointer tid;
+	ToastChunkStreamPrivate p;
+	ReadStream *stream;
+	Buffer		buf;
+	int			maxtids;
+	int			i;
+
+	/*
+	 * Collect the TIDs.  The index is on (valueid, chunkidx), so they come in
+	 * chunk order.  There might be more of them than chunks if there are
+	 * index entries for dead tuples.
+	 */
+	maxtids = fetch->endchunk - fetch->startchunk + 1;
+	p.tids = palloc_array(ItemPointerData, maxtids);
+	p.ntids = 0;
+	p.next = 0;
+
+	scan = index_beginscan(fetch->toastrel, toastidx, snapshot, NULL,
+						   nscankeys, 0);
+	index_rescan(scan, toastkey, nscankeys, NULL, 0);
+	while ((tid = index_getnext_tid(scan, ForwardScanDirection)) != NULL)
+	{
+		if (p.ntids >= maxtids)
+		{
+			maxtids *= 2;
+			p.tids = repalloc_array(p.tids, ItemPointerData, maxtids);
+		}
+		p.tids[p.ntids++] = *tid;
+	}
+	index_endscan(scan);
+
+	/* Now read the chunks themselves */
+	stream = read_stream_begin_relation(READ_STREAM_DEFAULT,
+										NULL,
+										fetch->toastrel,
+										MAIN_FORKNUM,
+										toast_chunk_stream_cb,
+										&p,
+										0);
+
+	i = 0;
+	while ((buf = read_stream_next_buffer(stream, NULL)) != InvalidBuffer)
+	{
+		BlockNumber blkno = BufferGetBlockNumber(buf);
+
+		LockBuffer(buf, BUFFER_LOCK_SHARE);
+		for (; i < p.ntids && ItemPointerGetBlockNumber(&p.tids[i]) == blkno; i++)
+		{
+			HeapTupleData ttup;
+			bool		isnull;
+			Oid			chunk_id;
+
+			if (!heap_hot_search_buffer(&p.tids[i], fetch->toastrel, buf,
+										snapshot, &ttup, NULL, true))
+				continue;
+
+			/*
+			 * The index scan is over and SnapshotToast is not an MVCC
+			 * snapshot, so nothing stopped VACUUM from removing a dead tuple
+			 * that one of the TIDs pointed to, and the slot may since have
+			 * been reused by a chunk of another value.  The chunks of our
+			 * value are live, so skip any tuple that isn't one of them.  If
+			 * we're missing a chunk as a result, heap_toast_copy_chunk() and
+			 * our caller complain as usual.
+			 */
+			chunk_id = DatumGetObjectId(fastgetattr(&ttup, 1,
+													fetch->toastrel->rd_att,
+													&isnull));
+			Assert(!isnull);
+			if (chunk_id != fetch->valueid)
+				continue;
+
+			heap_toast_copy_chunk(fetch, &ttup);
+		}
+		LockBuffer(buf, BUFFER_LOCK_UNLOCK);
+
+		ReleaseBuffer(buf);
+	}
+	Assert(i == p.ntids);
+
+	read_stream_end(stream);
+	pfree(p.tids);
+}
+
 /*
  * Fetch a TOAST slice from a heap table.
  *
@@ -629,14 +873,9 @@ heap_fetch_toast_slice(Relation toastrel, Oid valueid, int32 attrsize,
 {
 	Relation   *toastidxs;
 	ScanKeyData toastkey[3];
-	TupleDesc	toasttupDesc = toastrel->rd_att;
 	int			nscankeys;
-	SysScanDesc toastscan;
-	HeapTuple	ttup;
-	int32		expectedchunk;
-	int32		totalchunks = ((attrsize - 1) / TOAST_MAX_CHUNK_SIZE) + 1;
-	int			startchunk;
-	int			endchunk;
+	Snapshot	snapshot;
+	ToastSliceFetch fetch;
 	int			num_indexes;
 	int			validIndex;
 
@@ -646,9 +885,17 @@ heap_fetch_toast_slice(Relation toastrel, Oid valueid, int32 attrsize,
 									&toastidxs,
 									&num_indexes);
 
-	startchunk = sliceoffset / TOAST_MAX_CHUNK_SIZE;
-	endchunk = (sliceoffset + slicelength - 1) / TOAST_MAX_CHUNK_SIZE;
-	Assert(endchunk <= totalchunks);
+	fetch.toastrel = toastrel;
+	fetch.valueid = valueid;
+	fetch.attrsize = attrsize;
+	fetch.totalchunks = ((attrsize - 1) / TOAST_MAX_CHUNK_SIZE) + 1;
+	fetch.sliceoffset = sliceoffset;
+	fetch.slicelength = slicelength;
+	fetch.startchunk = sliceoffset / TOAST_MAX_CHUNK_SIZE;
+	fetch.endchunk = (sliceoffset + slicelength - 1) / TOAST_MAX_CHUNK_SIZE;
+	fetch.expectedchunk = fetch.startchunk;
+	fetch.result = result;
+	Assert(fetch.endchunk <= fetch.totalchunks);
 
 	/* Set up a scan key to fetch from the index. */
 	ScanKeyInit(&toastkey[0],
@@ -660,14 +907,14 @@ heap_fetch_toast_slice(Relation toastrel, Oid valueid, int32 attrsize,
 	 * No additional condition if fetching all chunks. Otherwise, use an
 	 * equality condition for one chunk, and a range condition otherwise.
 	 */
-	if (startchunk == 0 && endchunk == totalchunks - 1)
+	if (fetch.startchunk == 0 && fetch.endchunk == fetch.totalchunks - 1)
 		nscankeys = 1;
-	else if (startchunk == endchunk)
+	else if (fetch.startchunk == fetch.endchunk)
 	{
 		ScanKeyInit(&toastkey[1],
 					(AttrNumber) 2,
 					BTEqualStrategyNumber, F_INT4EQ,
-					Int32GetDatum(startchunk));
+					Int32GetDatum(fetch.startchunk));
 		nscankeys = 2;
 	}
 	else
@@ -675,117 +922,53 @@ heap_fetch_toast_slice(Relation toastrel, Oid valueid, int32 attrsize,
 		ScanKeyInit(&toastkey[1],
 					(AttrNumber) 2,
 					BTGreaterEqualStrategyNumber, F_INT4GE,
-					Int32GetDatum(startchunk));
+					Int32GetDatum(fetch.startchunk));
 		ScanKeyInit(&toastkey[2],
 					(AttrNumber) 2,
 					BTLessEqualStrategyNumber, F_INT4LE,
-					Int32GetDatum(endchunk));
+					Int32GetDatum(fetch.endchunk));
 		nscankeys = 3;
 	}
 
-	/* Prepare for scan */
-	toastscan = systable_beginscan_ordered(toastrel, toastidxs[validIndex],
-										   get_toast_snapshot(), nscankeys, toastkey);
+	snapshot = get_toast_snapshot();
 
-	/*
-	 * Read the chunks by index
-	 *
-	 * The index is on (valueid, chunkidx) so they will come in order
-	 */
-	expectedchunk = startchunk;
-	while ((ttup = systable_getnext_ordered(toastscan, ForwardScanDirection)) != NULL)
+	if (fetch.endchunk - fetch.startchunk + 1 >= TOAST_STREAM_MIN_CHUNKS &&
+		!ReindexIsProcessingIndex(RelationGetRelid(toastidxs[validIndex])))
 	{
-		int32		curchunk;
-		Pointer		chunk;
-		bool		isnull;
-		char	   *chunkdata;
-		int32		chunksize;
-		int32		expected_size;
-		int32		chcpystrt;
-		int32		chcpyend;
+		/* Large value, read it through a read stream */
+		heap_fetch_toast_chunks_stream(&fetch, toastidxs[validIndex],
+									   snapshot, nscankeys, toastkey);
+	}
+	else
+	{
+		SysScanDesc toastscan;
+		HeapTuple	ttup;
 
-		/*
-		 * Have a chunk, extract the sequence number and the data
-		 */
-		curchunk = DatumGetInt32(fastgetattr(ttup, 2, toasttupDesc, &isnull));
-		Assert(!isnull);
-		chunk = DatumGetPointer(fastgetattr(ttup, 3, toasttupDesc, &isnull));
-		Assert(!isnull);
-		if (!VARATT_IS_EXTENDED(chunk))
-		{
-			chunksize = VARSIZE(chunk) - VARHDRSZ;
-			chunkdata = VARDATA(chunk);
-		}
-		else if (VARATT_IS_SHORT(chunk))
-		{
-			/* could happen due to heap_form_tuple doing its thing */
-			chunksize = VARSIZE_SHORT(chunk) - VARHDRSZ_SHORT;
-			chunkdata = VARDATA_SHORT(chunk);
-		}
-		else
-		{
-			/* should never happen */
-			elog(ERROR, "found toasted toast chunk for toast value %u in %s",
-				 valueid, RelationGetRelationName(toastrel));
-			chunksize = 0;		/* keep compiler quiet */
-			chunkdata = NULL;
-		}
+		/* Prepare for scan */
+		toastscan = systable_beginscan_ordered(toastrel, toastidxs[validIndex],
+											   snapshot, nscankeys, toastkey);
 
 		/*
-		 * Some checks on the data we've found
+		 * Read the chunks by index
+		 *
+		 * The index is on (valueid, chunkidx) so they will come in order
 		 */
-		if (curchunk != expectedchunk)
-			ereport(ERROR,
-					(errcode(ERRCODE_DATA_CORRUPTED),
-					 errmsg_internal("unexpected chunk number %d (expected %d) for toast value %u in %s",
-									 curchunk, expectedchunk, valueid,
-									 RelationGetRelationName(toastrel))));
-		if (curchunk > endchunk)
-			ereport(ERROR,
-					(errcode(ERRCODE_DATA_CORRUPTED),
-					 errmsg_internal("unexpected chunk number %d (out of range %d..%d) for toast value %u in %s",
-									 curchunk,
-									 startchunk, endchunk, valueid,
-									 RelationGetRelationName(toastrel))));
-		expected_size = curchunk < totalchunks - 1 ? TOAST_MAX_CHUNK_SIZE
-			: attrsize - ((totalchunks - 1) * TOAST_MAX_CHUNK_SIZE);
-		if (chunksize != expected_size)
-			ereport(ERROR,
-					(errcode(ERRCODE_DATA_CORRUPTED),
-					 errmsg_internal("unexpected chunk size %d (expected %d) in chunk %d of %d for toast value %u in %s",
-									 chunksize, expected_size,
-									 curchunk, totalchunks, valueid,
-									 RelationGetRelationName(toastrel))));
+		while ((ttup = systable_getnext_ordered(toastscan, ForwardScanDirection)) != NULL)
+			heap_toast_copy_chunk(&fetch, ttup);
 
-		/*
-		 * Copy the data into proper place in our result
-		 */
-		chcpystrt = 0;
-		chcpyend = chunksize - 1;
-		if (curchunk == startchunk)
-			chcpystrt = sliceoffset % TOAST_MAX_CHUNK_SIZE;
-		if (curchunk == endchunk)
-			chcpyend = (sliceoffset + slicelength - 1) % TOAST_MAX_CHUNK_SIZE;
-
-		memcpy(VARDATA(result) +
-			   (curchunk * TOAST_MAX_CHUNK_SIZE - sliceoffset) + chcpystrt,
-			   chunkdata + chcpystrt,
-			   (chcpyend - chcpystrt) + 1);
-
-		expectedchunk++;
+		systable_endscan_ordered(toastscan);
 	}
 
 	/*
 	 * Final checks that we successfully fetched the datum
 	 */
-	if (expectedchunk != (endchunk + 1))
+	if (fetch.expectedchunk != (fetch.endchunk + 1))
 		ereport(ERROR,
 				(errcode(ERRCODE_DATA_CORRUPTED),
 				 errmsg_internal("missing chunk number %d for toast value %u in %s",
-								 expectedchunk, valueid,
+								 fetch.expectedchunk, valueid,
 								 RelationGetRelationName(toastrel))));
 
-	/* End scan and close indexes. */
-	systable_endscan_ordered(toastscan);
+	/* Close indexes. */
 	toast_close_indexes(toastidxs, num_indexes, AccessShareLock);
 }
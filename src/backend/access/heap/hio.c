@@ -19,9 +19,11 @@
 #include "access/hio.h"
 #include "access/htup_details.h"
 #include "access/visibilitymap.h"
+#include "pgstat.h"
 #include "storage/bufmgr.h"
 #include "storage/freespace.h"
 #include "storage/lmgr.h"
+#include "storage/procnumber.h"
 
 
 /*
@@ -210,6 +212,73 @@ GetVisibilityMapPins(Relation relation, Buffer buffer1, Buffer buffer2,
 	return released_locks;
 }
 
+/*
+ * Vacuum truncates trailing empty pages once there are rel_pages /
+ * REL_TRUNCATE_FRACTION of them; see vacuumlazy.c.
+ */
+#define PREEXTEND_TRUNCATE_FRACTION 16
+
+/*
+ * Pre-extend when at least this many backends are waiting for the extension
+ * lock, by this many pages for each of them.
+ */
+#define PREEXTEND_MIN_WAITERS 4
+#define PREEXTEND_PAGES_PER_WAITER 8
+
+/*
+ * Extend the relation on disk by up to extend_by blocks, without bringing the
+ * new blocks into shared buffers.  Returns the number of blocks added, the
+ * first of which is returned in *first_block.  The caller must hold the
+ * extension lock, and enter the blocks into the FSM once it has released it.
+ *
+ * RelationAddBlocks() uses this when at least PREEXTEND_MIN_WAITERS backends
+ * are waiting to extend the relation, which is when extending by pinned
+ * buffers, a few at a time for each waiter, can't keep up.  smgrzeroextend() uses fallocate for all but small
+ * extensions, so no pages need to be zeroed in shared buffers or written out
+ * while the extension lock is held.  A backend that gets one of these blocks
+ * from the FSM reads an all-zeroes page and initializes it, as
+ * RelationGetBufferForTuple() does for any new page.
+ *
+ * batch_pages is the number of pinned pages the caller is about to extend by
+ * as well.  Together they are kept below rel_pages /
+ * PREEXTEND_TRUNCATE_FRACTION, so that a vacuum that comes along before the
+ * pages are used won't truncate them away again.  That rules out
+ * pre-extending small relations, but those are cheap to extend anyway.
+ * Several pre-extensions in quick succession can still add up to enough
+ * empty pages to be truncated; we accept that, as under the contention that
+ * triggers pre-extension the pages don't stay empty for long.
+ */
+static uint32
+RelationPreExtend(Relation relation, uint32 extend_by, uint32 batch_pages,
+				  BlockNumber *first_block)
+{
+	SMgrRelation smgr = RelationGetSmgr(relation);
+	BlockNumber nblocks;
+	uint32		max_extend_by;
+	instr_time	io_start;
+
+	nblocks = smgrnblocks(smgr, MAIN_FORKNUM);
+
+	max_extend_by = nblocks / PREEXTEND_TRUNCATE_FRACTION;
+	if (max_extend_by <= batch_pages + 1)
+		return 0;
+	extend_by = Min(extend_by, max_extend_by - batch_pages - 1);
+
+	if ((uint64) nblocks + extend_by + batch_pages >= MaxBlockNumber)
+		return 0;
+
+	io_start = pgstat_prepare_io_time(track_io_timing);
+	smgrzeroextend(smgr, MAIN_FORKNUM, nblocks, extend_by, false);
+	pgstat_count_io_op_time(IOOBJECT_RELATION, IOCONTEXT_NORMAL, IOOP_EXTEND,
+							io_start, 1, extend_by * BLCKSZ);
+
+	elog(DEBUG1, "pre-extended relation \"%s\" by %u blocks",
+		 RelationGetRelationName(relation), extend_by);
+
+	*first_block = nblocks;
+	return extend_by;
+}
+
 /*
  * Extend the relation. By multiple pages, if beneficial.
  *
@@ -239,11 +308,15 @@ RelationAddBlocks(Relation relation, BulkInsertState bistate,
 				  int num_pages, bool use_fsm, bool *did_unlock)
 {
 #define MAX_BUFFERS_TO_EXTEND_BY 64
+#define MAX_BLOCKS_TO_PREEXTEND 512
 	Buffer		victim_buffers[MAX_BUFFERS_TO_EXTEND_BY];
 	BlockNumber first_block = InvalidBlockNumber;
 	BlockNumber last_block = InvalidBlockNumber;
 	uint32		extend_by_pages;
 	uint32		not_in_fsm_pages;
+	uint32		preextend_pages = 0;
+	BlockNumber preextend_first = InvalidBlockNumber;
+	uint32		flags = EB_LOCK_FIRST;
 	Buffer		buffer;
 	Page		page;
 
@@ -305,6 +378,21 @@ RelationAddBlocks(Relation relation, BulkInsertState bistate,
 		 * them all concurrently.
 		 */
 		extend_by_pages = Min(extend_by_pages, MAX_BUFFERS_TO_EXTEND_BY);
+
+		/*
+		 * If many backends are queued up for the extension lock and can find
+		 * the pages via the FSM, also extend by a number of pages for each
+		 * of them without pinning them; see RelationPreExtend().  Single-row
+		 * inserts only ask for a page or so per waiter, so without this the
+		 * waiters would soon be back in the queue.
+		 *
+		 * MAX_BLOCKS_TO_PREEXTEND + MAX_BUFFERS_TO_EXTEND_BY is below
+		 * REL_TRUNCATE_MINIMUM; RelationPreExtend() takes care of the
+		 * relative truncation threshold.
+		 */
+		if (use_fsm && waitcount >= PREEXTEND_MIN_WAITERS)
+			preextend_pages = Min(waitcount * PREEXTEND_PAGES_PER_WAITER,
+								  MAX_BLOCKS_TO_PREEXTEND);
 	}
 
 	/*
@@ -329,6 +417,24 @@ RelationAddBlocks(Relation relation, BulkInsertState bistate,
 		bistate->current_buf = InvalidBuffer;
 	}
 
+	/*
+	 * If pre-extending, do so under the same hold of the extension lock as
+	 * the extension by pinned buffers.  By the time we'd get the lock again
+	 * the waiters would have queued up behind it once more.  This means that
+	 * ExtendBufferedRelBy() acquires its victim buffers while we hold the
+	 * lock, which it otherwise avoids, but that's cheap next to the
+	 * extension itself.  The pre-extended blocks come first, so the pinned
+	 * ones still end up at the end of the relation.
+	 */
+	if (preextend_pages > 0)
+	{
+		LockRelationForExtension(relation, ExclusiveLock);
+		preextend_pages = RelationPreExtend(relation, preextend_pages,
+											extend_by_pages,
+											&preextend_first);
+		flags |= EB_SKIP_EXTENSION_LOCK;
+	}
+
 	/*
 	 * Extend the relation. We ask for the first returned page to be locked,
 	 * so that we are sure that nobody has inserted into the page
@@ -340,10 +446,12 @@ RelationAddBlocks(Relation relation, BulkInsertState bistate,
 	 */
 	first_block = ExtendBufferedRelBy(BMR_REL(relation), MAIN_FORKNUM,
 									  bistate ? bistate->strategy : NULL,
-									  EB_LOCK_FIRST,
+									  flags,
 									  extend_by_pages,
 									  victim_buffers,
 									  &extend_by_pages);
+	if (flags & EB_SKIP_EXTENSION_LOCK)
+		UnlockRelationForExtension(relation, ExclusiveLock);
 	buffer = victim_buffers[0]; /* the buffer the function will return */
 	last_block = first_block + (extend_by_pages - 1);
 	Assert(first_block == BufferGetBlockNumber(buffer));
@@ -368,7 +476,7 @@ RelationAddBlocks(Relation relation, BulkInsertState bistate,
 	 * not pin), we don't want to do IO while holding a buffer lock. This will
 	 * necessitate a bit more extensive checking in our caller.
 	 */
-	if (use_fsm && not_in_fsm_pages < extend_by_pages)
+	if (use_fsm && (not_in_fsm_pages < extend_by_pages || preextend_pages > 0))
 	{
 		LockBuffer(buffer, BUFFER_LOCK_UNLOCK);
 		*did_unlock = true;
@@ -406,6 +514,17 @@ RelationAddBlocks(Relation relation, BulkInsertState bistate,
 		FreeSpaceMapVacuumRange(relation, first_fsm_block, last_block);
 	}
 
+	/* Enter the pre-extended pages into the FSM as well */
+	if (preextend_pages > 0)
+	{
+		Size		freespace = BLCKSZ - SizeOfPageHeaderData;
+
+		for (uint32 i = 0; i < preextend_pages; i++)
+			RecordPageWithFreeSpace(relation, preextend_first + i, freespace);
+		FreeSpaceMapVacuumRange(relation, preextend_first,
+								preextend_first + preextend_pages);
+	}
+
 	if (bistate)
 	{
 		/*
@@ -431,6 +550,7 @@ RelationAddBlocks(Relation relation, BulkInsertState bistate,
 
 	return buffer;
 #undef MAX_BUFFERS_TO_EXTEND_BY
+#undef MAX_BLOCKS_TO_PREEXTEND
 }
 
 /*
@@ -476,6 +596,11 @@ RelationAddBlocks(Relation relation, BulkInsertState bistate,
  *	This can save some cycles when we know the relation is new and doesn't
  *	contain useful amounts of free space.
  *
+ *	If the relation's insert_targets option is set, each backend starts its
+ *	FSM searches at a different offset, depending on MyProcNumber, so that
+ *	concurrent inserters end up on distinct pages rather than all contending
+ *	for the content lock of the page the FSM hands out next.
+ *
  *	HEAP_INSERT_SKIP_FSM is also useful for non-WAL-logged additions to a
  *	relation, if the caller holds exclusive lock and is careful to invalidate
  *	relation's smgr_targblock before the first insertion --- that ensures that
@@ -516,6 +641,10 @@ RelationGetBufferForTuple(Relation relation, Size len,
 				otherBlock;
 	bool		unlockedTargetBuffer;
 	bool		recheckVmPins;
+	int			insertTargets;
+	int			fsmStartOffset = 0;
+	BlockNumber cachedTargetBlock;
+	bool		filledTarget;
 
 	len = MAXALIGN(len);		/* be conservative */
 
@@ -574,6 +703,12 @@ RelationGetBufferForTuple(Relation relation, Size len,
 		targetBlock = BufferGetBlockNumber(bistate->current_buf);
 	else
 		targetBlock = RelationGetTargetBlock(relation);
+	cachedTargetBlock = targetBlock;
+
+	/* Spread concurrent inserters over insert_targets pages, if requested */
+	insertTargets = RelationGetInsertTargets(relation, 1);
+	if (insertTargets > 1 && MyProcNumber != INVALID_PROC_NUMBER)
+		fsmStartOffset = MyProcNumber % insertTargets;
 
 	if (targetBlock == InvalidBlockNumber && use_fsm)
 	{
@@ -581,7 +716,8 @@ RelationGetBufferForTuple(Relation relation, Size len,
 		 * We have no cached target page, so ask the FSM for an initial
 		 * target.
 		 */
-		targetBlock = GetPageWithFreeSpace(relation, targetFreeSpace);
+		targetBlock = GetPageWithFreeSpaceExtended(relation, targetFreeSpace,
+												   fsmStartOffset);
 	}
 
 	/*
@@ -707,6 +843,14 @@ loop:
 			return buffer;
 		}
 
+		/*
+		 * If we've been inserting into this page and filled it, it may be
+		 * worth freezing as soon as our insertions are visible to everyone.
+		 */
+		filledTarget = eager_page_freezing &&
+			targetBlock == cachedTargetBlock &&
+			!PageIsAllVisible(page);
+
 		/*
 		 * Not enough space, so we must give up our page locks and pin (if
 		 * any) and prepare to look elsewhere.  We don't care which order we
@@ -722,6 +866,10 @@ loop:
 			ReleaseBuffer(buffer);
 		}
 
+		/* bistate->current_buf still holds a pin on the page */
+		if (filledTarget)
+			heap_page_freeze_request(relation, targetBlock, bistate == NULL);
+
 		/* Is there an ongoing bulk extension? */
 		if (bistate && bistate->next_free != InvalidBlockNumber)
 		{
@@ -756,10 +904,11 @@ loop:
 			 * Update FSM as to condition of this page, and ask for another
 			 * page to try.
 			 */
-			targetBlock = RecordAndGetPageWithFreeSpace(relation,
-														targetBlock,
-														pageFreeSpace,
-														targetFreeSpace);
+			targetBlock = RecordAndGetPageWithFreeSpaceExtended(relation,
+																targetBlock,
+																pageFreeSpace,
+																targetFreeSpace,
+																fsmStartOffset);
 		}
 	}
 
@@ -19,13 +19,18 @@
 #include "access/htup_details.h"
 #include "access/multixact.h"
 #include "access/transam.h"
+#include "access/visibilitymap.h"
+#include "access/xact.h"
 #include "access/xlog.h"
 #include "access/xloginsert.h"
+#include "catalog/pg_am_d.h"
 #include "commands/vacuum.h"
 #include "executor/instrument.h"
 #include "miscadmin.h"
 #include "pgstat.h"
+#include "postmaster/autovacuum.h"
 #include "storage/bufmgr.h"
+#include "storage/procarray.h"
 #include "utils/rel.h"
 #include "utils/snapmgr.h"
 
@@ -176,6 +181,11 @@ static void heap_prune_record_unchanged_lp_redirect(PruneState *prstate, OffsetN
 
 static void page_verify_redirects(Page page);
 
+static bool heap_page_prune_locked(Relation relation, Buffer buffer,
+								   GlobalVisState *vistest, Buffer vmbuffer);
+static void heap_page_prune_get_cutoffs(Relation relation,
+										struct VacuumCutoffs *cutoffs);
+
 
 /*
  * Optionally prune and repair fragmentation in the specified page.
@@ -187,6 +197,15 @@ static void page_verify_redirects(Page page);
  * Note: this is called quite often.  It's important that it fall out quickly
  * if there's not any use in pruning.
  *
+ * If background_page_pruning is enabled, the page is instead queued for an
+ * autovacuum worker to prune (see heap_page_prune_deferred()), so that the
+ * query that came across it doesn't have to do the work and emit the WAL.
+ * We still prune right away if a previous UPDATE found the page full, as
+ * someone needs the space now, or if the request can't be queued.
+ *
+ * If eager_page_freezing is enabled, we also freeze the page and set its
+ * visibility map bits where possible, see heap_page_prune_locked().
+ *
  * Caller must have pin on the buffer, and must *not* have a lock on it.
  */
 void
@@ -241,56 +260,348 @@ heap_page_prune_opt(Relation relation, Buffer buffer)
 
 	if (PageIsFull(page) || PageGetHeapFreeSpace(page) < minfree)
 	{
-		/* OK, try to get exclusive buffer lock */
-		if (!ConditionalLockBufferForCleanup(buffer))
+		Buffer		vmbuffer = InvalidBuffer;
+
+		/* Hand the page off to autovacuum, if requested and possible */
+		if (background_page_pruning && !PageIsFull(page) &&
+			!AmAutoVacuumWorkerProcess() &&
+			!RELATION_IS_LOCAL(relation) &&
+			AutoVacuumingActive() &&
+			AutoVacuumRequestWork(AVW_HeapPrunePage,
+								  RelationGetRelid(relation),
+								  BufferGetBlockNumber(buffer)))
 			return;
 
 		/*
-		 * Now that we have buffer lock, get accurate information about the
-		 * page's free space, and recheck the heuristic about whether to
-		 * prune.
+		 * If we're going to freeze, pin the visibility map page now, so that
+		 * we don't have to do I/O while holding the buffer lock.  Freezing
+		 * may need to create new multixacts, which we don't risk in parallel
+		 * workers.
 		 */
-		if (PageIsFull(page) || PageGetHeapFreeSpace(page) < minfree)
-		{
-			OffsetNumber dummy_off_loc;
-			PruneFreezeResult presult;
+		if (eager_page_freezing && !IsInParallelMode())
+			visibilitymap_pin(relation, BufferGetBlockNumber(buffer),
+							  &vmbuffer);
 
+		/* OK, try to get exclusive buffer lock */
+		if (ConditionalLockBufferForCleanup(buffer))
+		{
 			/*
-			 * For now, pass mark_unused_now as false regardless of whether or
-			 * not the relation has indexes, since we cannot safely determine
-			 * that during on-access pruning with the current implementation.
+			 * Now that we have buffer lock, get accurate information about
+			 * the page's free space, and recheck the heuristic about whether
+			 * to prune.
 			 */
-			heap_page_prune_and_freeze(relation, buffer, vistest, 0,
-									   NULL, &presult, PRUNE_ON_ACCESS, &dummy_off_loc, NULL, NULL);
+			if (PageIsFull(page) || PageGetHeapFreeSpace(page) < minfree)
+				heap_page_prune_locked(relation, buffer, vistest, vmbuffer);
+
+			/* And release buffer lock */
+			LockBuffer(buffer, BUFFER_LOCK_UNLOCK);
 
 			/*
-			 * Report the number of tuples reclaimed to pgstats.  This is
-			 * presult.ndeleted minus the number of newly-LP_DEAD-set items.
-			 *
-			 * We derive the number of dead tuples like this to avoid totally
-			 * forgetting about items that were set to LP_DEAD, since they
-			 * still need to be cleaned up by VACUUM.  We only want to count
-			 * heap-only tuples that just became LP_UNUSED in our report,
-			 * which don't.
-			 *
-			 * VACUUM doesn't have to compensate in the same way when it
-			 * tracks ndeleted, since it will set the same LP_DEAD items to
-			 * LP_UNUSED separately.
+			 * We avoid reuse of any free space created on the page by
+			 * unrelated UPDATEs/INSERTs by opting to not update the FSM at
+			 * this point.  The free space should be reused by UPDATEs to
+			 * *this* page.
 			 */
-			if (presult.ndeleted > presult.nnewlpdead)
-				pgstat_update_heap_dead_tuples(relation,
-											   presult.ndeleted - presult.nnewlpdead);
 		}
 
-		/* And release buffer lock */
-		LockBuffer(buffer, BUFFER_LOCK_UNLOCK);
+		if (BufferIsValid(vmbuffer))
+			ReleaseBuffer(vmbuffer);
+	}
+}
 
+/*
+ * heap_page_prune_locked
+ *
+ * Workhorse of on-access pruning: prune the page, on which the caller holds
+ * a cleanup lock.
+ *
+ * If vmbuffer is valid, it must be the caller's pin on the page's visibility
+ * map page, and we also freeze tuples and set the page all-visible or
+ * all-frozen in the visibility map if possible.  That's much like what VACUUM
+ * does for the page: tuples that must be frozen because they are older than
+ * the FreezeLimit from heap_page_prune_get_cutoffs() are frozen in any case.
+ * Beyond that, we freeze the page's tuples whenever that makes the whole page
+ * frozen (HEAP_PAGE_PRUNE_FREEZE_EAGERLY), where VACUUM would only do so if
+ * it had to write a full-page image anyway.  LP_DEAD items are left for
+ * VACUUM.
+ *
+ * Returns true if the page is all-frozen in the visibility map afterwards.
+ */
+static bool
+heap_page_prune_locked(Relation relation, Buffer buffer,
+					   GlobalVisState *vistest, Buffer vmbuffer)
+{
+	Page		page = BufferGetPage(buffer);
+	BlockNumber blkno = BufferGetBlockNumber(buffer);
+	OffsetNumber dummy_off_loc;
+	PruneFreezeResult presult;
+	bool		all_frozen = false;
+
+	if (!BufferIsValid(vmbuffer))
+	{
 		/*
-		 * We avoid reuse of any free space created on the page by unrelated
-		 * UPDATEs/INSERTs by opting to not update the FSM at this point.  The
-		 * free space should be reused by UPDATEs to *this* page.
+		 * For now, pass mark_unused_now as false regardless of whether or not
+		 * the relation has indexes, since we cannot safely determine that
+		 * during on-access pruning with the current implementation.
 		 */
+		heap_page_prune_and_freeze(relation, buffer, vistest, 0,
+								   NULL, &presult, PRUNE_ON_ACCESS, &dummy_off_loc, NULL, NULL);
+	}
+	else
+	{
+		struct VacuumCutoffs cutoffs;
+		TransactionId new_relfrozen_xid;
+		MultiXactId new_relmin_mxid;
+
+		heap_page_prune_get_cutoffs(relation, &cutoffs);
+
+		/* we don't advance relfrozenxid, so these results are unused */
+		new_relfrozen_xid = cutoffs.OldestXmin;
+		new_relmin_mxid = cutoffs.OldestMxact;
+
+		heap_page_prune_and_freeze(relation, buffer, vistest,
+								   HEAP_PAGE_PRUNE_FREEZE |
+								   HEAP_PAGE_PRUNE_FREEZE_EAGERLY,
+								   &cutoffs, &presult, PRUNE_ON_ACCESS,
+								   &dummy_off_loc,
+								   &new_relfrozen_xid, &new_relmin_mxid);
+
+		if (presult.all_visible)
+		{
+			uint8		flags = VISIBILITYMAP_ALL_VISIBLE;
+
+			if (presult.all_frozen)
+			{
+				Assert(!TransactionIdIsValid(presult.vm_conflict_horizon));
+				flags |= VISIBILITYMAP_ALL_FROZEN;
+			}
+
+			/* Set the bits unless they're all set already */
+			if (!PageIsAllVisible(page) ||
+				(visibilitymap_get_status(relation, blkno, &vmbuffer) & flags) != flags)
+			{
+				PageSetAllVisible(page);
+				MarkBufferDirty(buffer);
+				visibilitymap_set(relation, blkno, buffer, InvalidXLogRecPtr,
+								  vmbuffer, presult.vm_conflict_horizon,
+								  flags);
+			}
+			all_frozen = presult.all_frozen;
+		}
 	}
+
+	/*
+	 * Report the number of tuples reclaimed to pgstats.  This is
+	 * presult.ndeleted minus the number of newly-LP_DEAD-set items.
+	 *
+	 * We derive the number of dead tuples like this to avoid totally
+	 * forgetting about items that were set to LP_DEAD, since they still need
+	 * to be cleaned up by VACUUM.  We only want to count heap-only tuples
+	 * that just became LP_UNUSED in our report, which don't.
+	 *
+	 * VACUUM doesn't have to compensate in the same way when it tracks
+	 * ndeleted, since it will set the same LP_DEAD items to LP_UNUSED
+	 * separately.
+	 */
+	if (presult.ndeleted > presult.nnewlpdead)
+		pgstat_update_heap_dead_tuples(relation,
+									   presult.ndeleted - presult.nnewlpdead);
+
+	return all_frozen;
+}
+
+/*
+ * Compute the freeze cutoffs for heap_page_prune_locked().
+ *
+ * This is a simplified version of vacuum_get_cutoffs(), using the current
+ * removal horizon of the relation and the vacuum_freeze_min_age and
+ * vacuum_multixact_freeze_min_age settings.  We don't warn about horizons
+ * that are held back; VACUUM will do that.
+ *
+ * Unlike VACUUM, we take relfrozenxid and relminmxid from the relcache entry
+ * rather than rereading pg_class, so they may be stale.  That is harmless.
+ * While we hold a lock on the relation, only VACUUM can change them, and it
+ * only advances them, so a stale value is older than the current one.  We
+ * only use them to cross-check the XIDs and MultiXactIds found on the page,
+ * which with an older value catches a little less corruption but never
+ * reports any that isn't there.  We don't compute new values for them
+ * either, and freezing only removes XIDs from the page, so whatever a
+ * concurrent VACUUM sets them to remains correct.  (Commands that rewrite
+ * the relation and reset them conflict with our lock.)
+ */
+static void
+heap_page_prune_get_cutoffs(Relation relation, struct VacuumCutoffs *cutoffs)
+{
+	TransactionId nextXID;
+	MultiXactId nextMXID;
+	int			freeze_min_age;
+	int			multixact_freeze_min_age;
+
+	cutoffs->relfrozenxid = relation->rd_rel->relfrozenxid;
+	cutoffs->relminmxid = relation->rd_rel->relminmxid;
+
+	cutoffs->OldestXmin = GetOldestNonRemovableTransactionId(relation);
+	cutoffs->OldestMxact = GetOldestMultiXactId();
+
+	nextXID = ReadNextTransactionId();
+	nextMXID = ReadNextMultiXactId();
+
+	freeze_min_age = Min(vacuum_freeze_min_age, autovacuum_freeze_max_age / 2);
+	cutoffs->FreezeLimit = nextXID - freeze_min_age;
+	if (!TransactionIdIsNormal(cutoffs->FreezeLimit))
+		cutoffs->FreezeLimit = FirstNormalTransactionId;
+	if (TransactionIdPrecedes(cutoffs->OldestXmin, cutoffs->FreezeLimit))
+		cutoffs->FreezeLimit = cutoffs->OldestXmin;
+
+	multixact_freeze_min_age = Min(vacuum_multixact_freeze_min_age,
+								   MultiXactMemberFreezeThreshold() / 2);
+	cutoffs->MultiXactCutoff = nextMXID - multixact_freeze_min_age;
+	if (cutoffs->MultiXactCutoff < FirstMultiXactId)
+		cutoffs->MultiXactCutoff = FirstMultiXactId;
+	if (MultiXactIdPrecedes(cutoffs->OldestMxact, cutoffs->MultiXactCutoff))
+		cutoffs->MultiXactCutoff = cutoffs->OldestMxact;
+}
+
+/*
+ * heap_page_prune_deferred
+ *
+ * Prune a page that heap_page_prune_opt() queued for autovacuum.  This is
+ * called by autovacuum workers while processing their work items.  The
+ * relation may have been dropped, rewritten or truncated since the page was
+ * queued; in that case there's nothing to do.
+ */
+void
+heap_page_prune_deferred(Oid relid, BlockNumber blkno)
+{
+	Relation	rel;
+	Buffer		buffer;
+
+	rel = try_relation_open(relid, AccessShareLock);
+	if (rel == NULL)
+		return;
+
+	if (RELKIND_HAS_TABLE_AM(rel->rd_rel->relkind) &&
+		rel->rd_rel->relam == HEAP_TABLE_AM_OID &&
+		blkno < RelationGetNumberOfBlocks(rel))
+	{
+		/* pruning needs a snapshot to compute its horizon */
+		PushActiveSnapshot(GetTransactionSnapshot());
+
+		buffer = ReadBufferExtended(rel, MAIN_FORKNUM, blkno, RBM_NORMAL,
+									NULL);
+		heap_page_prune_opt(rel, buffer);
+		ReleaseBuffer(buffer);
+
+		PopActiveSnapshot();
+	}
+
+	relation_close(rel, AccessShareLock);
+}
+
+/*
+ * heap_page_freeze_request
+ *
+ * Called when an insert has filled a page and moves on to another one, if
+ * eager_page_freezing is enabled.  We queue the page for an autovacuum worker
+ * to freeze (see heap_page_freeze_deferred()), by which time the inserted
+ * tuples will hopefully be visible to everyone.  Failure to queue the page is
+ * not reported; VACUUM will get to it eventually.
+ *
+ * If eager_page_freezing_on_insert is also enabled, we first try to freeze
+ * the page and set its visibility map bits right here, which works if its
+ * tuples are all visible to everyone already, as is usually the case when
+ * rows trickle in from many short transactions.  That puts the work on the
+ * inserting backend, which is why it is a separate setting.  It doesn't work
+ * if the caller still holds a pin on the page, so the caller must say
+ * whether we may try.
+ */
+void
+heap_page_freeze_request(Relation relation, BlockNumber blkno,
+						 bool try_now)
+{
+	if (!eager_page_freezing)
+		return;
+
+	/* Freezing may need to create new multixacts; see heap_page_prune_opt */
+	if (eager_page_freezing_on_insert && try_now && !IsInParallelMode())
+	{
+		Buffer		buffer;
+		Buffer		vmbuffer = InvalidBuffer;
+		bool		frozen = false;
+
+		buffer = ReadBuffer(relation, blkno);
+		visibilitymap_pin(relation, blkno, &vmbuffer);
+
+		if (ConditionalLockBufferForCleanup(buffer))
+		{
+			if (!PageIsAllVisible(BufferGetPage(buffer)))
+				frozen = heap_page_prune_locked(relation, buffer,
+												GlobalVisTestFor(relation),
+												vmbuffer);
+			LockBuffer(buffer, BUFFER_LOCK_UNLOCK);
+		}
+
+		ReleaseBuffer(vmbuffer);
+		ReleaseBuffer(buffer);
+
+		if (frozen)
+			return;
+	}
+
+	if (RELATION_IS_LOCAL(relation) || !AutoVacuumingActive())
+		return;
+
+	(void) AutoVacuumRequestWork(AVW_HeapFreezePage,
+								 RelationGetRelid(relation), blkno);
+}
+
+/*
+ * heap_page_freeze_deferred
+ *
+ * Prune and freeze a page that heap_page_freeze_request() queued for
+ * autovacuum, and set its visibility map bits.  Like
+ * heap_page_prune_deferred(), this is called by autovacuum workers while
+ * processing their work items, and does nothing if the page is gone.  We
+ * also skip the page if it has been marked all-visible in the meantime, or
+ * if someone else holds a pin on it.
+ */
+void
+heap_page_freeze_deferred(Oid relid, BlockNumber blkno)
+{
+	Relation	rel;
+	Buffer		buffer;
+	Buffer		vmbuffer = InvalidBuffer;
+
+	rel = try_relation_open(relid, AccessShareLock);
+	if (rel == NULL)
+		return;
+
+	if (RELKIND_HAS_TABLE_AM(rel->rd_rel->relkind) &&
+		rel->rd_rel->relam == HEAP_TABLE_AM_OID &&
+		blkno < RelationGetNumberOfBlocks(rel))
+	{
+		/* pruning needs a snapshot to compute its horizon */
+		PushActiveSnapshot(GetTransactionSnapshot());
+
+		buffer = ReadBufferExtended(rel, MAIN_FORKNUM, blkno, RBM_NORMAL,
+									NULL);
+		visibilitymap_pin(rel, blkno, &vmbuffer);
+
+		if (ConditionalLockBufferForCleanup(buffer))
+		{
+			if (!PageIsAllVisible(BufferGetPage(buffer)))
+				heap_page_prune_locked(rel, buffer, GlobalVisTestFor(rel),
+									   vmbuffer);
+			LockBuffer(buffer, BUFFER_LOCK_UNLOCK);
+		}
+
+		ReleaseBuffer(vmbuffer);
+		ReleaseBuffer(buffer);
+
+		PopActiveSnapshot();
+	}
+
+	relation_close(rel, AccessShareLock);
 }
 
 
@@ -323,8 +634,15 @@ heap_page_prune_opt(Relation relation, Buffer buffer)
  *   FREEZE indicates that we will also freeze tuples, and will return
  *   'all_visible', 'all_frozen' flags to the caller.
  *
+ *   FREEZE_EAGERLY, used with FREEZE, indicates that we should freeze the
+ *   tuples whenever that would make the page all-frozen, rather than only
+ *   if we're emitting a full-page image anyway.  The page must not have
+ *   LP_DEAD items for that, since they would keep the page from being
+ *   marked all-visible.
+ *
  * cutoffs contains the freeze cutoffs, established by VACUUM at the beginning
- * of vacuuming the relation.  Required if HEAP_PRUNE_FREEZE option is set.
+ * of vacuuming the relation, or by heap_page_prune_locked() for the page at
+ * hand.  Required if HEAP_PRUNE_FREEZE option is set.
  * cutoffs->OldestXmin is also used to determine if dead tuples are
  * HEAPTUPLE_RECENTLY_DEAD or HEAPTUPLE_DEAD.
  *
@@ -423,7 +741,8 @@ heap_page_prune_and_freeze(Relation relation, Buffer buffer,
 	 * whether the page will be all-visible and all-frozen after pruning and
 	 * freezing to help the caller to do that.
 	 *
-	 * Currently, only VACUUM sets the VM bits.  To save the effort, only do
+	 * Currently, only VACUUM and on-access pruning with eager_page_freezing
+	 * set the VM bits.  To save the effort, only do
 	 * the bookkeeping if the caller needs it.  Currently, that's tied to
 	 * HEAP_PAGE_PRUNE_FREEZE, but it could be a separate flag if you wanted
 	 * to update the VM bits without also freezing or freeze without also
@@ -699,10 +1018,14 @@ heap_page_prune_and_freeze(Relation relation, Buffer buffer,
 			if (prstate.all_visible && prstate.all_frozen && prstate.nfrozen > 0)
 			{
 				/*
-				 * Freezing would make the page all-frozen.  Have already
-				 * emitted an FPI or will do so anyway?
+				 * Freezing would make the page all-frozen.  Does the caller
+				 * want that in any case, or have we already emitted an FPI
+				 * or will do so anyway?
 				 */
-				if (RelationNeedsWAL(relation))
+				if ((options & HEAP_PAGE_PRUNE_FREEZE_EAGERLY) &&
+					prstate.lpdead_items == 0)
+					do_freeze = true;
+				else if (RelationNeedsWAL(relation))
 				{
 					if (hint_bit_fpi)
 						do_freeze = true;
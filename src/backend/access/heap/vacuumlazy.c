@@ -27,6 +27,8 @@
  *
  * Manually invoked VACUUMs may scan indexes during phase II in parallel. For
  * more information on this, see the comment at the top of vacuumparallel.c.
+ * The same workers then also help with phase III, each of them vacuuming the
+ * heap blocks in its share of dead_items.
  *
  * In between phases, vacuum updates the freespace map (every
  * VACUUM_FSM_EVERY_PAGES).
@@ -146,6 +148,7 @@
 #include "common/pg_prng.h"
 #include "executor/instrument.h"
 #include "miscadmin.h"
+#include "optimizer/paths.h"
 #include "pgstat.h"
 #include "portability/instr_time.h"
 #include "postmaster/autovacuum.h"
@@ -336,6 +339,7 @@ typedef struct LVRelState
 	BlockNumber vm_new_frozen_pages;
 
 	BlockNumber lpdead_item_pages;	/* # pages with LP_DEAD items */
+	BlockNumber dead_items_pages;	/* # pages currently in dead_items */
 	BlockNumber missed_dead_pages;	/* # pages with missed dead tuples */
 	BlockNumber nonempty_pages; /* actually, last nonempty page + 1 */
 
@@ -418,6 +422,22 @@ typedef struct LVSavedErrInfo
 	VacErrPhase phase;
 } LVSavedErrInfo;
 
+/*
+ * The second heap pass divides the blocks in dead_items among the parallel
+ * vacuum participants in chunks of this many consecutive blocks, to keep
+ * each participant's reads mostly sequential.
+ */
+#define PARALLEL_VACUUM_HEAP_CHUNK_SIZE		64
+
+/* Read stream callback state for the second heap pass */
+typedef struct VacuumReapLpState
+{
+	TidStoreIter *iter;
+	int			myshare;		/* our share of the blocks */
+	int			nshares;		/* total number of shares */
+	int			first_extra_share;	/* we also take shares from here up */
+} VacuumReapLpState;
+
 
 /* non-export function prototypes */
 static void lazy_scan_heap(LVRelState *vacrel);
@@ -440,6 +460,10 @@ static bool lazy_scan_noprune(LVRelState *vacrel, Buffer buf,
 static void lazy_vacuum(LVRelState *vacrel);
 static bool lazy_vacuum_all_indexes(LVRelState *vacrel);
 static void lazy_vacuum_heap_rel(LVRelState *vacrel);
+static BlockNumber lazy_vacuum_heap_blocks(LVRelState *vacrel, int myshare,
+										   int nshares, int first_extra_share);
+static BlockNumber share_blocks_before(BlockNumber blkno, int myshare,
+									   int nshares, int first_extra_share);
 static void lazy_vacuum_heap_page(LVRelState *vacrel, BlockNumber blkno,
 								  Buffer buffer, OffsetNumber *deadoffsets,
 								  int num_offsets, Buffer vmbuffer);
@@ -734,6 +758,7 @@ heap_vacuum_rel(Relation rel, const VacuumParams params,
 	vacrel->removed_pages = 0;
 	vacrel->new_frozen_tuple_pages = 0;
 	vacrel->lpdead_item_pages = 0;
+	vacrel->dead_items_pages = 0;
 	vacrel->missed_dead_pages = 0;
 	vacrel->nonempty_pages = 0;
 	/* dead_items_alloc allocates vacrel->dead_items later on */
@@ -2678,8 +2703,9 @@ lazy_vacuum_all_indexes(LVRelState *vacrel)
 
 /*
  * Read stream callback for vacuum's third phase (second pass over the heap).
- * Gets the next block from the TID store and returns it or InvalidBlockNumber
- * if there are no further blocks to vacuum.
+ * Gets the next block from the TID store that belongs to one of our shares
+ * (see lazy_vacuum_heap_blocks()) and returns it or InvalidBlockNumber if
+ * there are no further blocks to vacuum.
  *
  * NB: Assumed to be safe to use with READ_STREAM_USE_BATCHING.
  */
@@ -2688,12 +2714,22 @@ vacuum_reap_lp_read_stream_next(ReadStream *stream,
 								void *callback_private_data,
 								void *per_buffer_data)
 {
-	TidStoreIter *iter = callback_private_data;
+	VacuumReapLpState *state = callback_private_data;
 	TidStoreIterResult *iter_result;
 
-	iter_result = TidStoreIterateNext(iter);
-	if (iter_result == NULL)
-		return InvalidBlockNumber;
+	for (;;)
+	{
+		int			share;
+
+		iter_result = TidStoreIterateNext(state->iter);
+		if (iter_result == NULL)
+			return InvalidBlockNumber;
+
+		share = (iter_result->blkno / PARALLEL_VACUUM_HEAP_CHUNK_SIZE) %
+			state->nshares;
+		if (share == state->myshare || share >= state->first_extra_share)
+			break;
+	}
 
 	/*
 	 * Save the TidStoreIterResult for later, so we can extract the offsets.
@@ -2724,11 +2760,11 @@ vacuum_reap_lp_read_stream_next(ReadStream *stream,
 static void
 lazy_vacuum_heap_rel(LVRelState *vacrel)
 {
-	ReadStream *stream;
-	BlockNumber vacuumed_pages = 0;
-	Buffer		vmbuffer = InvalidBuffer;
+	BlockNumber vacuumed_pages;
 	LVSavedErrInfo saved_err_info;
-	TidStoreIter *iter;
+	bool		parallel_pass;
+	int			nshares = 1;
+	int			nlaunched = 0;
 
 	Assert(vacrel->do_index_vacuuming);
 	Assert(vacrel->do_index_cleanup);
@@ -2743,15 +2779,88 @@ lazy_vacuum_heap_rel(LVRelState *vacrel)
 							 VACUUM_ERRCB_PHASE_VACUUM_HEAP,
 							 InvalidBlockNumber, InvalidOffsetNumber);
 
-	iter = TidStoreBeginIterate(vacrel->dead_items);
+	/*
+	 * Each participant adds the blocks it has gone past to the progress
+	 * counter, see lazy_vacuum_heap_blocks().
+	 */
+	pgstat_progress_update_param(PROGRESS_VACUUM_HEAP_BLKS_VACUUMED, 0);
+
+	/*
+	 * If we have parallel workers, and at least min_parallel_table_scan_size
+	 * blocks to vacuum, let them vacuum part of the blocks.  With fewer
+	 * blocks, the leader can vacuum them in less time than it takes to
+	 * launch the workers.  We take share 0, as well as the shares of any
+	 * workers that couldn't be launched.
+	 */
+	parallel_pass = ParallelVacuumIsActive(vacrel) &&
+		vacrel->dead_items_pages >= (BlockNumber) min_parallel_table_scan_size;
+	if (parallel_pass)
+		nlaunched = parallel_vacuum_heap_pass_begin(vacrel->pvs,
+													vacrel->cutoffs.OldestXmin,
+													&nshares);
+
+	vacuumed_pages = lazy_vacuum_heap_blocks(vacrel, 0, nshares, nlaunched + 1);
+
+	if (parallel_pass)
+		parallel_vacuum_heap_pass_end(vacrel->pvs, &vacuumed_pages,
+									  &vacrel->vm_new_visible_pages,
+									  &vacrel->vm_new_visible_frozen_pages);
+
+	/*
+	 * We set all LP_DEAD items from the first heap pass to LP_UNUSED during
+	 * the second heap pass.  No more, no less.
+	 */
+	Assert(vacrel->num_index_scans > 1 ||
+		   (vacrel->dead_items_info->num_items == vacrel->lpdead_items &&
+			vacuumed_pages == vacrel->lpdead_item_pages));
+
+	ereport(DEBUG2,
+			(errmsg("table \"%s\": removed %" PRId64 " dead item identifiers in %u pages",
+					vacrel->relname, vacrel->dead_items_info->num_items,
+					vacuumed_pages)));
+
+	/* Revert to the previous phase information for error traceback */
+	restore_vacuum_error_info(vacrel, &saved_err_info);
+}
+
+/*
+ *	lazy_vacuum_heap_blocks() -- vacuum our share of the blocks in dead_items
+ *
+ * The blocks are divided into nshares shares, in chunks of
+ * PARALLEL_VACUUM_HEAP_CHUNK_SIZE consecutive blocks.  We process share
+ * myshare, and all shares from first_extra_share up; pass nshares as
+ * first_extra_share to process just myshare.  A serial vacuum processes share
+ * 0 of 1.
+ *
+ * As we go, we add the number of blocks of our shares that lie before the
+ * block being vacuumed to the heap_blks_vacuumed progress counter, so that
+ * the sum over all participants tracks how far the pass has got.  For a
+ * serial vacuum, that is just the block number.
+ *
+ * Returns the number of pages vacuumed.
+ */
+static BlockNumber
+lazy_vacuum_heap_blocks(LVRelState *vacrel, int myshare, int nshares,
+						int first_extra_share)
+{
+	ReadStream *stream;
+	BlockNumber vacuumed_pages = 0;
+	BlockNumber reported_blocks = 0;
+	Buffer		vmbuffer = InvalidBuffer;
+	VacuumReapLpState state;
+
+	state.iter = TidStoreBeginIterate(vacrel->dead_items);
+	state.myshare = myshare;
+	state.nshares = nshares;
+	state.first_extra_share = first_extra_share;
 
 	/*
 	 * Set up the read stream for vacuum's second pass through the heap.
 	 *
 	 * It is safe to use batchmode, as vacuum_reap_lp_read_stream_next() does
-	 * not need to wait for IO and does not perform locking. Once we support
-	 * parallelism it should still be fine, as presumably the holder of locks
-	 * would never be blocked by IO while holding the lock.
+	 * not need to wait for IO and does not perform locking.  Each parallel
+	 * participant has its own stream and its own share of the blocks, so
+	 * there is no locking between them either.
 	 */
 	stream = read_stream_begin_relation(READ_STREAM_MAINTENANCE |
 										READ_STREAM_USE_BATCHING,
@@ -2759,12 +2868,13 @@ lazy_vacuum_heap_rel(LVRelState *vacrel)
 										vacrel->rel,
 										MAIN_FORKNUM,
 										vacuum_reap_lp_read_stream_next,
-										iter,
+										&state,
 										sizeof(TidStoreIterResult));
 
 	while (true)
 	{
 		BlockNumber blkno;
+		BlockNumber blocks;
 		Buffer		buf;
 		Page		page;
 		TidStoreIterResult *iter_result;
@@ -2782,6 +2892,16 @@ lazy_vacuum_heap_rel(LVRelState *vacrel)
 
 		vacrel->blkno = blkno = BufferGetBlockNumber(buf);
 
+		/* Report progress, via the leader if we're a parallel worker */
+		blocks = share_blocks_before(blkno, myshare, nshares,
+									 first_extra_share);
+		if (blocks > reported_blocks)
+		{
+			pgstat_progress_parallel_incr_param(PROGRESS_VACUUM_HEAP_BLKS_VACUUMED,
+												blocks - reported_blocks);
+			reported_blocks = blocks;
+		}
+
 		Assert(iter_result);
 		num_offsets = TidStoreGetBlockOffsets(iter_result, offsets, lengthof(offsets));
 		Assert(num_offsets <= lengthof(offsets));
@@ -2808,27 +2928,90 @@ lazy_vacuum_heap_rel(LVRelState *vacrel)
 	}
 
 	read_stream_end(stream);
-	TidStoreEndIterate(iter);
+	TidStoreEndIterate(state.iter);
 
 	vacrel->blkno = InvalidBlockNumber;
 	if (BufferIsValid(vmbuffer))
 		ReleaseBuffer(vmbuffer);
 
-	/*
-	 * We set all LP_DEAD items from the first heap pass to LP_UNUSED during
-	 * the second heap pass.  No more, no less.
-	 */
-	Assert(vacrel->num_index_scans > 1 ||
-		   (vacrel->dead_items_info->num_items == vacrel->lpdead_items &&
-			vacuumed_pages == vacrel->lpdead_item_pages));
+	return vacuumed_pages;
+}
 
-	ereport(DEBUG2,
-			(errmsg("table \"%s\": removed %" PRId64 " dead item identifiers in %u pages",
-					vacrel->relname, vacrel->dead_items_info->num_items,
-					vacuumed_pages)));
+/*
+ * Count the blocks before blkno that belong to our shares of the second heap
+ * pass, see lazy_vacuum_heap_blocks().
+ */
+static BlockNumber
+share_blocks_before(BlockNumber blkno, int myshare, int nshares,
+					int first_extra_share)
+{
+	BlockNumber nchunks = blkno / PARALLEL_VACUUM_HEAP_CHUNK_SIZE;
+	int			nmyshares = 1 + (nshares - first_extra_share);
+	BlockNumber result;
 
-	/* Revert to the previous phase information for error traceback */
-	restore_vacuum_error_info(vacrel, &saved_err_info);
+	/* Every full round of chunks has one chunk for each of our shares */
+	result = (nchunks / nshares) * nmyshares * PARALLEL_VACUUM_HEAP_CHUNK_SIZE;
+
+	/* Then the chunks of the last, partial round */
+	for (int share = 0; share <= nchunks % nshares; share++)
+	{
+		if (share != myshare && share < first_extra_share)
+			continue;
+		if (share < nchunks % nshares)
+			result += PARALLEL_VACUUM_HEAP_CHUNK_SIZE;
+		else
+			result += blkno % PARALLEL_VACUUM_HEAP_CHUNK_SIZE;
+	}
+
+	return result;
+}
+
+/*
+ * heap_vacuum_dead_items_worker() -- second heap pass in a parallel worker
+ *
+ * Called by parallel vacuum workers to vacuum share myshare of the blocks in
+ * dead_items, see lazy_vacuum_heap_blocks().  The caller has set up
+ * cost-based delay.  The number of pages vacuumed and of pages newly marked
+ * all-visible and all-frozen in the visibility map are returned for the
+ * leader to add up.
+ */
+void
+heap_vacuum_dead_items_worker(Relation rel, TidStore *dead_items,
+							  BufferAccessStrategy bstrategy,
+							  TransactionId OldestXmin,
+							  int myshare, int nshares,
+							  BlockNumber *vacuumed_pages,
+							  BlockNumber *vm_new_visible_pages,
+							  BlockNumber *vm_new_visible_frozen_pages)
+{
+	LVRelState	vacrel;
+	ErrorContextCallback errcallback;
+
+	memset(&vacrel, 0, sizeof(LVRelState));
+	vacrel.rel = rel;
+	vacrel.bstrategy = bstrategy;
+	vacrel.do_index_vacuuming = true;
+	vacrel.cutoffs.OldestXmin = OldestXmin;
+	vacrel.dead_items = dead_items;
+	vacrel.relnamespace = get_namespace_name(RelationGetNamespace(rel));
+	vacrel.relname = pstrdup(RelationGetRelationName(rel));
+	vacrel.blkno = InvalidBlockNumber;
+	vacrel.offnum = InvalidOffsetNumber;
+	vacrel.phase = VACUUM_ERRCB_PHASE_VACUUM_HEAP;
+
+	/* Setup error traceback support for ereport() */
+	errcallback.callback = vacuum_error_callback;
+	errcallback.arg = &vacrel;
+	errcallback.previous = error_context_stack;
+	error_context_stack = &errcallback;
+
+	*vacuumed_pages = lazy_vacuum_heap_blocks(&vacrel, myshare, nshares,
+											  nshares);
+	*vm_new_visible_pages = vacrel.vm_new_visible_pages;
+	*vm_new_visible_frozen_pages = vacrel.vm_new_visible_frozen_pages;
+
+	/* Pop the error context stack */
+	error_context_stack = errcallback.previous;
 }
 
 /*
@@ -2853,8 +3036,6 @@ lazy_vacuum_heap_page(LVRelState *vacrel, BlockNumber blkno, Buffer buffer,
 
 	Assert(vacrel->do_index_vacuuming);
 
-	pgstat_progress_update_param(PROGRESS_VACUUM_HEAP_BLKS_VACUUMED, blkno);
-
 	/* Update error traceback information */
 	update_vacuum_error_info(vacrel, &saved_err_info,
 							 VACUUM_ERRCB_PHASE_VACUUM_HEAP, blkno,
@@ -3551,6 +3732,7 @@ dead_items_add(LVRelState *vacrel, BlockNumber blkno, OffsetNumber *offsets,
 
 	TidStoreSetBlockOffsets(vacrel->dead_items, blkno, offsets, num_offsets);
 	vacrel->dead_items_info->num_items += num_offsets;
+	vacrel->dead_items_pages++;
 
 	/* update the progress information */
 	prog_val[0] = vacrel->dead_items_info->num_items;
@@ -3564,6 +3746,8 @@ dead_items_add(LVRelState *vacrel, BlockNumber blkno, OffsetNumber *offsets,
 static void
 dead_items_reset(LVRelState *vacrel)
 {
+	vacrel->dead_items_pages = 0;
+
 	if (ParallelVacuumIsActive(vacrel))
 	{
 		parallel_vacuum_reset_dead_items(vacrel->pvs);
@@ -174,7 +174,9 @@ RestoreArchivedFile(char *path, const char *xlogfname,
 	/*
 	 * Copy xlog from archival storage to XLOGDIR
 	 */
+	RestoreOriginalOpenFileLimit();
 	rc = system(xlogRestoreCmd);
+	RestoreCustomOpenFileLimit();
 
 	PostRestoreCommand();
 
@@ -327,7 +329,9 @@ ExecuteRecoveryCommand(const char *command, const char *commandName,
 	 */
 	fflush(NULL);
 	pgstat_report_wait_start(wait_event_info);
+	RestoreOriginalOpenFileLimit();
 	rc = system(xlogRecoveryCmd);
+	RestoreCustomOpenFileLimit();
 	pgstat_report_wait_end();
 
 	pfree(xlogRecoveryCmd);
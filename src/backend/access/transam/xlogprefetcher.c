@@ -698,9 +698,10 @@ XLogPrefetcherNextBlock(uintptr_t pgsr_private, XLogRecPtr *lsn)
 					RelFileLocatorEquals(block->rlocator, prefetcher->recent_rlocator[i]))
 				{
 					/*
-					 * XXX If we also remembered where it was, we could set
-					 * recent_buffer so that recovery could skip smgropen()
-					 * and a buffer table lookup.
+					 * We don't remember where it was, but recovery keeps its
+					 * own small cache of recently used buffers, so repeated
+					 * references will usually skip smgropen() and a buffer
+					 * table lookup anyway.  See XLogReadBufferExtended().
 					 */
 					XLogPrefetchIncrement(&SharedStats->skip_rep);
 					return LRQ_NEXT_NO_IO;
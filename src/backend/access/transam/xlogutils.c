@@ -77,6 +77,29 @@ typedef struct xl_invalid_page
 
 static HTAB *invalid_page_tab = NULL;
 
+/*
+ * Bulk loads produce long runs of WAL records that modify the same block, one
+ * heap insert after another.  To avoid a buffer mapping table probe (and the
+ * smgr calls that precede it) for every one of them, we remember where the
+ * blocks we recently read for redo were in the buffer pool, and pass that to
+ * ReadRecentBuffer() as a hint when the prefetcher didn't supply one.  The
+ * hint is only trusted after ReadRecentBuffer() has verified the buffer tag,
+ * so entries never need to be invalidated.  The cache is direct-mapped on
+ * the block number, which also keeps the blocks of a multi-block record,
+ * like the old and new pages of an update, in separate entries.
+ */
+#define REDO_RECENT_BUFFERS		16
+
+typedef struct RedoRecentBuffer
+{
+	RelFileLocator locator;
+	ForkNumber	forkno;
+	BlockNumber blkno;
+	Buffer		buffer;
+} RedoRecentBuffer;
+
+static RedoRecentBuffer redo_recent_buffers[REDO_RECENT_BUFFERS];
+
 static int	read_local_xlog_page_guts(XLogReaderState *state, XLogRecPtr targetPagePtr,
 									  int reqLen, XLogRecPtr targetRecPtr,
 									  char *cur_page, bool wait_for_wal);
@@ -464,9 +487,22 @@ XLogReadBufferExtended(RelFileLocator rlocator, ForkNumber forknum,
 	BlockNumber lastblock;
 	Buffer		buffer;
 	SMgrRelation smgr;
+	RedoRecentBuffer *recent;
 
 	Assert(blkno != P_NEW);
 
+	/*
+	 * If the prefetcher didn't tell us where the buffer might be, check if we
+	 * read the same block for a recent record.
+	 */
+	recent = &redo_recent_buffers[blkno % REDO_RECENT_BUFFERS];
+	if (!BufferIsValid(recent_buffer) &&
+		BufferIsValid(recent->buffer) &&
+		recent->blkno == blkno &&
+		recent->forkno == forknum &&
+		RelFileLocatorEquals(recent->locator, rlocator))
+		recent_buffer = recent->buffer;
+
 	/* Do we have a clue where the buffer might be already? */
 	if (BufferIsValid(recent_buffer) &&
 		mode == RBM_NORMAL &&
@@ -538,6 +574,15 @@ recent_buffer_fast_path:
 		}
 	}
 
+	/* Remember where the block is, for the next record that touches it */
+	if (BufferIsValid(buffer) && !BufferIsLocal(buffer))
+	{
+		recent->locator = rlocator;
+		recent->forkno = forknum;
+		recent->blkno = blkno;
+		recent->buffer = buffer;
+	}
+
 	return buffer;
 }
 
@@ -22,6 +22,7 @@
 #include "archive/shell_archive.h"
 #include "common/percentrepl.h"
 #include "pgstat.h"
+#include "storage/fd.h"
 
 static bool shell_archive_configured(ArchiveModuleState *state);
 static bool shell_archive_file(ArchiveModuleState *state,
@@ -77,7 +78,9 @@ shell_archive_file(ArchiveModuleState *state, const char *file,
 
 	fflush(NULL);
 	pgstat_report_wait_start(WAIT_EVENT_ARCHIVE_COMMAND);
+	RestoreOriginalOpenFileLimit();
 	rc = system(xlogarchcmd);
+	RestoreCustomOpenFileLimit();
 	pgstat_report_wait_end();
 
 	if (rc != 0)
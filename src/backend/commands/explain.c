@@ -13,6 +13,7 @@
  */
 #include "postgres.h"
 
+#include "access/detoast.h"
 #include "access/xact.h"
 #include "catalog/pg_type.h"
 #include "commands/createas.h"
@@ -125,6 +126,7 @@ static void show_sort_info(SortState *sortstate, ExplainState *es);
 static void show_incremental_sort_info(IncrementalSortState *incrsortstate,
 									   ExplainState *es);
 static void show_hash_info(HashState *hashstate, ExplainState *es);
+static void show_nestloop_info(NestLoopState *nlstate, ExplainState *es);
 static void show_material_info(MaterialState *mstate, ExplainState *es);
 static void show_windowagg_info(WindowAggState *winstate, ExplainState *es);
 static void show_ctescan_info(CteScanState *ctescanstate, ExplainState *es);
@@ -2161,6 +2163,8 @@ ExplainNode(PlanState *planstate, List *ancestors,
 			}
 			break;
 		case T_NestLoop:
+			show_upper_qual(((NestLoop *) plan)->hashclauses,
+							"Adaptive Hash Cond", planstate, ancestors, es);
 			show_upper_qual(((NestLoop *) plan)->join.joinqual,
 							"Join Filter", planstate, ancestors, es);
 			if (((NestLoop *) plan)->join.joinqual)
@@ -2170,6 +2174,7 @@ ExplainNode(PlanState *planstate, List *ancestors,
 			if (plan->qual)
 				show_instrumentation_count("Rows Removed by Filter", 2,
 										   planstate, es);
+			show_nestloop_info(castNode(NestLoopState, planstate), es);
 			break;
 		case T_MergeJoin:
 			show_upper_qual(((MergeJoin *) plan)->mergeclauses,
@@ -3465,6 +3470,49 @@ show_hash_info(HashState *hashstate, ExplainState *es)
 	}
 }
 
+/*
+ * Show whether a nestloop join switched to hashing its inner plan, and when.
+ */
+static void
+show_nestloop_info(NestLoopState *nlstate, ExplainState *es)
+{
+	bool		switched = (nlstate->nl_SwitchedAt > 0);
+
+	if (!es->analyze || nlstate->nl_SwitchRows == 0)
+		return;
+
+	if (es->format != EXPLAIN_FORMAT_TEXT)
+	{
+		ExplainPropertyBool("Switched to Hash", switched, es);
+		if (switched)
+		{
+			ExplainPropertyUInteger("Switch Outer Rows", NULL,
+									nlstate->nl_SwitchedAt, es);
+			ExplainPropertyUInteger("Hashed Inner Rows", NULL,
+									nlstate->nl_HashedRows, es);
+		}
+		if (switched || nlstate->nl_HashFailed)
+			ExplainPropertyUInteger("Peak Memory Usage", "kB",
+									BYTES_TO_KILOBYTES(nlstate->nl_HashSpacePeak),
+									es);
+	}
+	else if (switched)
+	{
+		ExplainIndentText(es);
+		appendStringInfo(es->str,
+						 "Switched to Hash: after " UINT64_FORMAT " outer rows  Inner Rows: " UINT64_FORMAT "  Memory Usage: " UINT64_FORMAT "kB\n",
+						 nlstate->nl_SwitchedAt,
+						 nlstate->nl_HashedRows,
+						 BYTES_TO_KILOBYTES(nlstate->nl_HashSpacePeak));
+	}
+	else if (nlstate->nl_HashFailed)
+	{
+		ExplainIndentText(es);
+		appendStringInfoString(es->str,
+							   "Switched to Hash: no, inner rows exceeded hash_mem\n");
+	}
+}
+
 /*
  * Show information on material node, storage method and maximum memory/disk
  * space used.
@@ -4076,6 +4124,7 @@ peek_buffer_usage(ExplainState *es, const BufferUsage *usage)
 	bool		has_shared_timing;
 	bool		has_local_timing;
 	bool		has_temp_timing;
+	bool		has_detoast;
 
 	if (usage == NULL)
 		return false;
@@ -4099,9 +4148,11 @@ peek_buffer_usage(ExplainState *es, const BufferUsage *usage)
 						!INSTR_TIME_IS_ZERO(usage->local_blk_write_time));
 	has_temp_timing = (!INSTR_TIME_IS_ZERO(usage->temp_blk_read_time) ||
 					   !INSTR_TIME_IS_ZERO(usage->temp_blk_write_time));
+	has_detoast = (usage->detoast_cache_hits > 0 ||
+				   usage->detoast_cache_misses > 0);
 
 	return has_shared || has_local || has_temp || has_shared_timing ||
-		has_local_timing || has_temp_timing;
+		has_local_timing || has_temp_timing || has_detoast;
 }
 
 /*
@@ -4128,6 +4179,8 @@ show_buffer_usage(ExplainState *es, const BufferUsage *usage)
 										!INSTR_TIME_IS_ZERO(usage->local_blk_write_time));
 		bool		has_temp_timing = (!INSTR_TIME_IS_ZERO(usage->temp_blk_read_time) ||
 									   !INSTR_TIME_IS_ZERO(usage->temp_blk_write_time));
+		bool		has_detoast = (usage->detoast_cache_hits > 0 ||
+								   usage->detoast_cache_misses > 0);
 
 		/* Show only positive counter values. */
 		if (has_shared || has_local || has_temp)
@@ -4226,6 +4279,14 @@ show_buffer_usage(ExplainState *es, const BufferUsage *usage)
 			}
 			appendStringInfoChar(es->str, '\n');
 		}
+
+		if (has_detoast)
+		{
+			ExplainIndentText(es);
+			appendStringInfo(es->str, "Detoast Cache: hits=%" PRId64 " misses=%" PRId64 "\n",
+							 usage->detoast_cache_hits,
+							 usage->detoast_cache_misses);
+		}
 	}
 	else
 	{
@@ -4270,6 +4331,13 @@ show_buffer_usage(ExplainState *es, const BufferUsage *usage)
 								 INSTR_TIME_GET_MILLISEC(usage->temp_blk_write_time),
 								 3, es);
 		}
+		if (detoast_cache_size > 0)
+		{
+			ExplainPropertyInteger("Detoast Cache Hits", NULL,
+								   usage->detoast_cache_hits, es);
+			ExplainPropertyInteger("Detoast Cache Misses", NULL,
+								   usage->detoast_cache_misses, es);
+		}
 	}
 }
 
@@ -80,6 +80,9 @@ int			vacuum_multixact_failsafe_age;
 double		vacuum_max_eager_freeze_failure_rate;
 bool		track_cost_delay_timing;
 bool		vacuum_truncate;
+bool		background_page_pruning;
+bool		eager_page_freezing;
+bool		eager_page_freezing_on_insert;
 
 /*
  * Variables for cost-based vacuum delay. The defaults differ between
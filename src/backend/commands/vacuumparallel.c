@@ -16,6 +16,12 @@
  * the parallel context is re-initialized so that the same DSM can be used for
  * multiple passes of index bulk-deletion and index cleanup.
  *
+ * The same workers are also used for the second pass over the heap, which
+ * marks the dead items collected in the first pass as unused.  The blocks in
+ * dead_items are split into as many shares as there are participants, and
+ * each participant vacuums the blocks in its own share; see
+ * heap_vacuum_dead_items_worker().
+ *
  * Portions Copyright (c) 1996-2025, PostgreSQL Global Development Group
  * Portions Copyright (c) 1994, Regents of the University of California
  *
@@ -27,6 +33,7 @@
 #include "postgres.h"
 
 #include "access/amapi.h"
+#include "access/heapam.h"
 #include "access/table.h"
 #include "access/xact.h"
 #include "commands/progress.h"
@@ -119,6 +126,19 @@ typedef struct PVShared
 
 	/* Statistics of shared dead items */
 	VacDeadItemsInfo dead_items_info;
+
+	/*
+	 * Fields for the second heap pass.  heap_pass tells the workers to vacuum
+	 * the heap rather than the indexes.  heap_oldest_xmin is the leader's
+	 * OldestXmin cutoff, and heap_nshares is the number of shares the blocks
+	 * are divided into.  The counters accumulate the workers' results.
+	 */
+	bool		heap_pass;
+	TransactionId heap_oldest_xmin;
+	int			heap_nshares;
+	pg_atomic_uint32 heap_vacuumed_pages;
+	pg_atomic_uint32 heap_vm_new_visible_pages;
+	pg_atomic_uint32 heap_vm_new_visible_frozen_pages;
 } PVShared;
 
 /* Status used during parallel index vacuum or cleanup */
@@ -390,6 +410,9 @@ parallel_vacuum_init(Relation rel, Relation *indrels, int nindexes,
 	pg_atomic_init_u32(&(shared->cost_balance), 0);
 	pg_atomic_init_u32(&(shared->active_nworkers), 0);
 	pg_atomic_init_u32(&(shared->idx), 0);
+	pg_atomic_init_u32(&(shared->heap_vacuumed_pages), 0);
+	pg_atomic_init_u32(&(shared->heap_vm_new_visible_pages), 0);
+	pg_atomic_init_u32(&(shared->heap_vm_new_visible_frozen_pages), 0);
 
 	shm_toc_insert(pcxt->toc, PARALLEL_VACUUM_KEY_SHARED, shared);
 	pvs->shared = shared;
@@ -532,6 +555,108 @@ parallel_vacuum_cleanup_all_indexes(ParallelVacuumState *pvs, long num_table_tup
 	parallel_vacuum_process_all_indexes(pvs, num_index_scans, false);
 }
 
+/*
+ * Launch parallel workers for the second heap pass.  This function must be
+ * used by the parallel vacuum leader process, which then vacuums its own
+ * share of the blocks and calls parallel_vacuum_heap_pass_end().
+ *
+ * Returns the number of workers launched.  *nshares is set to the number of
+ * shares the blocks are divided into.  Share 0 belongs to the leader, shares
+ * 1 to the returned number belong to the workers, and the leader must also
+ * take care of any shares beyond that, which were meant for workers that
+ * could not be launched.
+ */
+int
+parallel_vacuum_heap_pass_begin(ParallelVacuumState *pvs,
+								TransactionId OldestXmin, int *nshares)
+{
+	int			nworkers = pvs->pcxt->nworkers;
+
+	Assert(!IsParallelWorker());
+
+	/* Reinitialize parallel context to relaunch parallel workers */
+	ReinitializeParallelDSM(pvs->pcxt);
+
+	pvs->shared->heap_pass = true;
+	pvs->shared->heap_oldest_xmin = OldestXmin;
+	pvs->shared->heap_nshares = nworkers + 1;
+	pg_atomic_write_u32(&(pvs->shared->heap_vacuumed_pages), 0);
+	pg_atomic_write_u32(&(pvs->shared->heap_vm_new_visible_pages), 0);
+	pg_atomic_write_u32(&(pvs->shared->heap_vm_new_visible_frozen_pages), 0);
+
+	/* Setup the shared cost-based vacuum delay, as for index vacuuming */
+	pg_atomic_write_u32(&(pvs->shared->cost_balance), VacuumCostBalance);
+	pg_atomic_write_u32(&(pvs->shared->active_nworkers), 0);
+
+	ReinitializeParallelWorkers(pvs->pcxt, nworkers);
+
+	LaunchParallelWorkers(pvs->pcxt);
+
+	if (pvs->pcxt->nworkers_launched > 0)
+	{
+		VacuumCostBalance = 0;
+		VacuumCostBalanceLocal = 0;
+
+		VacuumSharedCostBalance = &(pvs->shared->cost_balance);
+		VacuumActiveNWorkers = &(pvs->shared->active_nworkers);
+
+		/* The leader participates in the heap pass too */
+		pg_atomic_add_fetch_u32(VacuumActiveNWorkers, 1);
+	}
+
+	ereport(pvs->shared->elevel,
+			(errmsg(ngettext("launched %d parallel vacuum worker for heap vacuuming (planned: %d)",
+							 "launched %d parallel vacuum workers for heap vacuuming (planned: %d)",
+							 pvs->pcxt->nworkers_launched),
+					pvs->pcxt->nworkers_launched, nworkers)));
+
+	*nshares = pvs->shared->heap_nshares;
+
+	return pvs->pcxt->nworkers_launched;
+}
+
+/*
+ * Wait for the workers launched by parallel_vacuum_heap_pass_begin() to
+ * finish, and add their results to the leader's counters.
+ */
+void
+parallel_vacuum_heap_pass_end(ParallelVacuumState *pvs,
+							  BlockNumber *vacuumed_pages,
+							  BlockNumber *vm_new_visible_pages,
+							  BlockNumber *vm_new_visible_frozen_pages)
+{
+	Assert(!IsParallelWorker());
+	Assert(pvs->shared->heap_pass);
+
+	/* The leader has completed its share */
+	if (VacuumActiveNWorkers)
+		pg_atomic_sub_fetch_u32(VacuumActiveNWorkers, 1);
+
+	WaitForParallelWorkersToFinish(pvs->pcxt);
+
+	for (int i = 0; i < pvs->pcxt->nworkers_launched; i++)
+		InstrAccumParallelQuery(&pvs->buffer_usage[i], &pvs->wal_usage[i]);
+
+	*vacuumed_pages +=
+		pg_atomic_read_u32(&(pvs->shared->heap_vacuumed_pages));
+	*vm_new_visible_pages +=
+		pg_atomic_read_u32(&(pvs->shared->heap_vm_new_visible_pages));
+	*vm_new_visible_frozen_pages +=
+		pg_atomic_read_u32(&(pvs->shared->heap_vm_new_visible_frozen_pages));
+
+	pvs->shared->heap_pass = false;
+
+	/*
+	 * Carry the shared balance value to heap scan and disable shared costing
+	 */
+	if (VacuumSharedCostBalance)
+	{
+		VacuumCostBalance = pg_atomic_read_u32(VacuumSharedCostBalance);
+		VacuumSharedCostBalance = NULL;
+		VacuumActiveNWorkers = NULL;
+	}
+}
+
 /*
  * Compute the number of parallel worker processes to request.  Both index
  * vacuum and index cleanup can be executed with parallel workers.
@@ -665,6 +790,7 @@ parallel_vacuum_process_all_indexes(ParallelVacuumState *pvs, int num_index_scan
 
 	/* Reset the parallel index processing and progress counters */
 	pg_atomic_write_u32(&(pvs->shared->idx), 0);
+	pvs->shared->heap_pass = false;
 
 	/* Setup the shared cost-based vacuum delay and launch workers */
 	if (nworkers > 0)
@@ -982,8 +1108,9 @@ parallel_vacuum_index_is_parallel_safe(Relation indrel, int num_index_scans,
 /*
  * Perform work within a launched parallel process.
  *
- * Since parallel vacuum workers perform only index vacuum or index cleanup,
- * we don't need to report progress information.
+ * Parallel vacuum workers perform only index vacuum, index cleanup or their
+ * share of the second heap pass.  They report their progress through the
+ * leader, using pgstat_progress_parallel_incr_param().
  */
 void
 parallel_vacuum_main(dsm_segment *seg, shm_toc *toc)
@@ -1085,8 +1212,35 @@ parallel_vacuum_main(dsm_segment *seg, shm_toc *toc)
 	/* Prepare to track buffer usage during parallel execution */
 	InstrStartParallelQuery();
 
-	/* Process indexes to perform vacuum/cleanup */
-	parallel_vacuum_process_safe_indexes(&pvs);
+	if (shared->heap_pass)
+	{
+		BlockNumber vacuumed_pages;
+		BlockNumber vm_new_visible_pages;
+		BlockNumber vm_new_visible_frozen_pages;
+
+		/* Vacuum our share of the heap blocks with dead items */
+		pg_atomic_add_fetch_u32(VacuumActiveNWorkers, 1);
+		heap_vacuum_dead_items_worker(rel, dead_items, pvs.bstrategy,
+									  shared->heap_oldest_xmin,
+									  ParallelWorkerNumber + 1,
+									  shared->heap_nshares,
+									  &vacuumed_pages,
+									  &vm_new_visible_pages,
+									  &vm_new_visible_frozen_pages);
+		pg_atomic_sub_fetch_u32(VacuumActiveNWorkers, 1);
+
+		pg_atomic_add_fetch_u32(&(shared->heap_vacuumed_pages),
+								vacuumed_pages);
+		pg_atomic_add_fetch_u32(&(shared->heap_vm_new_visible_pages),
+								vm_new_visible_pages);
+		pg_atomic_add_fetch_u32(&(shared->heap_vm_new_visible_frozen_pages),
+								vm_new_visible_frozen_pages);
+	}
+	else
+	{
+		/* Process indexes to perform vacuum/cleanup */
+		parallel_vacuum_process_safe_indexes(&pvs);
+	}
 
 	/* Report buffer/WAL usage during parallel execution */
 	buffer_usage = shm_toc_lookup(toc, PARALLEL_VACUUM_KEY_BUFFER_USAGE, false);
@@ -60,6 +60,7 @@
 #include "utils/backend_status.h"
 #include "utils/lsyscache.h"
 #include "utils/partcache.h"
+#include "utils/plancache.h"
 #include "utils/rls.h"
 #include "utils/snapmgr.h"
 
@@ -488,6 +489,15 @@ standard_ExecutorEnd(QueryDesc *queryDesc)
 		pgstat_update_parallel_workers_stats((PgStat_Counter) estate->es_parallel_workers_to_launch,
 											 (PgStat_Counter) estate->es_parallel_workers_launched);
 
+	/*
+	 * Tell the plan cache whether some node saw far more rows than the
+	 * planner predicted, so that it doesn't keep reusing a misestimated plan
+	 * blindly.
+	 */
+	if (plan_cache_misestimate_factor > 0 && queryDesc->cplan != NULL &&
+		!(estate->es_top_eflags & EXEC_FLAG_EXPLAIN_ONLY))
+		CachedPlanNoteEstimate(queryDesc->cplan, estate->es_misestimated);
+
 	/*
 	 * Check that ExecutorFinish was called, unless in EXPLAIN-only mode. This
 	 * Assert is needed because ExecutorFinish is new as of 9.1, and callers
@@ -868,7 +878,7 @@ InitPlan(QueryDesc *queryDesc, int eflags)
 	 * to each PartitionPruneInfo entry, and the es_part_prune_results list is
 	 * parallel to es_part_prune_infos.
 	 */
-	ExecDoInitialPruning(estate);
+	ExecDoInitialPruning(estate, queryDesc->cplan, queryDesc->cplan_generation);
 
 	/*
 	 * Next, build the ExecRowMark array from the PlanRowMark(s), if any.
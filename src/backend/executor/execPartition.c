@@ -16,19 +16,25 @@
 #include "access/table.h"
 #include "access/tableam.h"
 #include "catalog/partition.h"
+#include "catalog/pg_proc.h"
+#include "common/int.h"
 #include "executor/execPartition.h"
 #include "executor/executor.h"
 #include "executor/nodeModifyTable.h"
 #include "foreign/fdwapi.h"
 #include "mb/pg_wchar.h"
 #include "miscadmin.h"
+#include "optimizer/optimizer.h"
 #include "partitioning/partbounds.h"
 #include "partitioning/partdesc.h"
 #include "partitioning/partprune.h"
 #include "rewrite/rewriteManip.h"
+#include "storage/lmgr.h"
 #include "utils/acl.h"
+#include "utils/fmgroids.h"
 #include "utils/lsyscache.h"
 #include "utils/partcache.h"
+#include "utils/plancache.h"
 #include "utils/rls.h"
 #include "utils/ruleutils.h"
 
@@ -102,6 +108,18 @@ struct PartitionTupleRouting
 	MemoryContext memcxt;
 };
 
+/*
+ * Ways of comparing a partition key value with the partition bounds in
+ * get_partition_for_tuple().
+ */
+typedef enum PartKeyCmpType
+{
+	PARTKEY_CMP_FMGR,			/* call the partition support function */
+	PARTKEY_CMP_INT16,			/* compare as int16 */
+	PARTKEY_CMP_INT32,			/* compare as int32 */
+	PARTKEY_CMP_INT64,			/* compare as int64 */
+} PartKeyCmpType;
+
 /*-----------------------
  * PartitionDispatch - information about one partitioned table in a partition
  * hierarchy required to route a tuple to any of its partitions.  A
@@ -131,6 +149,12 @@ struct PartitionTupleRouting
  *		routing it through this table). A NULL value is stored if no tuple
  *		conversion is required.
  *
+ * keycmp
+ *		How to compare the partition key of a tuple with the partition bounds.
+ *		For single-column LIST and RANGE keys whose comparison function is
+ *		known to compare integer Datums, we compare them inline instead of
+ *		calling the function.  See partkey_cmp_type().
+ *
  * indexes
  *		Array of partdesc->nparts elements.  For leaf partitions the index
  *		corresponds to the partition's ResultRelInfo in the encapsulating
@@ -148,6 +172,7 @@ typedef struct PartitionDispatchData
 	PartitionDesc partdesc;
 	TupleTableSlot *tupslot;
 	AttrMap    *tupmap;
+	PartKeyCmpType keycmp;
 	int			indexes[FLEXIBLE_ARRAY_MEMBER];
 }			PartitionDispatchData;
 
@@ -173,6 +198,16 @@ static void FormPartitionKeyDatum(PartitionDispatch pd,
 								  EState *estate,
 								  Datum *values,
 								  bool *isnull);
+static PartKeyCmpType partkey_cmp_type(PartitionKey key);
+static inline int32 partkey_datum_cmp(PartitionDispatch pd, Datum bound,
+									  Datum value);
+static inline int32 partkey_rbound_cmp(PartitionDispatch pd, Datum *rb_datums,
+									   PartitionRangeDatumKind *rb_kind,
+									   Datum *values);
+static int	partkey_list_bsearch(PartitionDispatch pd, Datum value,
+								 bool *is_equal);
+static int	partkey_range_bsearch(PartitionDispatch pd, Datum *values,
+								  bool *is_equal);
 static int	get_partition_for_tuple(PartitionDispatch pd, Datum *values,
 									bool *isnull);
 static char *ExecBuildSlotPartitionKeyDescription(Relation rel,
@@ -199,6 +234,7 @@ static void find_matching_subplans_recurse(PartitionPruningData *prunedata,
 										   bool initial_prune,
 										   Bitmapset **validsubplans,
 										   Bitmapset **validsubplan_rtis);
+static bool initial_pruning_is_immutable(PlannedStmt *plannedstmt);
 
 
 /*
@@ -1142,6 +1178,7 @@ ExecInitPartitionDispatchInfo(EState *estate,
 	pd->key = RelationGetPartitionKey(rel);
 	pd->keystate = NIL;
 	pd->partdesc = partdesc;
+	pd->keycmp = partkey_cmp_type(pd->key);
 	if (parent_pd != NULL)
 	{
 		TupleDesc	tupdesc = RelationGetDescr(rel);
@@ -1348,6 +1385,172 @@ FormPartitionKeyDatum(PartitionDispatch pd,
 		elog(ERROR, "wrong number of partition key expressions");
 }
 
+/*
+ * partkey_cmp_type
+ *		Decide how get_partition_for_tuple() compares values of the given
+ *		partition key with the partition bounds.
+ *
+ * Routing a row through a LIST or RANGE partitioned table takes a binary
+ * search through the bounds, and for keys of the common integer and
+ * datetime types most of the time is spent in the function call overhead of
+ * the comparisons.  For single-column keys whose comparison function is one
+ * we know compares plain integer Datums, we do the comparisons inline.
+ */
+static PartKeyCmpType
+partkey_cmp_type(PartitionKey key)
+{
+	if (key->strategy == PARTITION_STRATEGY_HASH || key->partnatts != 1)
+		return PARTKEY_CMP_FMGR;
+
+	switch (key->partsupfunc[0].fn_oid)
+	{
+		case F_BTINT2CMP:
+			return PARTKEY_CMP_INT16;
+		case F_BTINT4CMP:
+		case F_DATE_CMP:
+			return PARTKEY_CMP_INT32;
+		case F_BTINT8CMP:
+		case F_TIMESTAMP_CMP:
+		case F_TIMESTAMPTZ_CMP:
+			return PARTKEY_CMP_INT64;
+		default:
+			return PARTKEY_CMP_FMGR;
+	}
+}
+
+/*
+ * partkey_datum_cmp
+ *		Compare a bound datum with the first column of a partition key, like
+ *		the partition support function would.
+ */
+static inline int32
+partkey_datum_cmp(PartitionDispatch pd, Datum bound, Datum value)
+{
+	switch (pd->keycmp)
+	{
+		case PARTKEY_CMP_INT16:
+			return pg_cmp_s16(DatumGetInt16(bound), DatumGetInt16(value));
+		case PARTKEY_CMP_INT32:
+			return pg_cmp_s32(DatumGetInt32(bound), DatumGetInt32(value));
+		case PARTKEY_CMP_INT64:
+			return pg_cmp_s64(DatumGetInt64(bound), DatumGetInt64(value));
+		case PARTKEY_CMP_FMGR:
+			break;
+	}
+
+	return DatumGetInt32(FunctionCall2Coll(&pd->key->partsupfunc[0],
+										   pd->key->partcollation[0],
+										   bound, value));
+}
+
+/*
+ * partkey_rbound_cmp
+ *		Like partition_rbound_datum_cmp(), using the inline comparison if
+ *		possible.
+ */
+static inline int32
+partkey_rbound_cmp(PartitionDispatch pd, Datum *rb_datums,
+				   PartitionRangeDatumKind *rb_kind, Datum *values)
+{
+	PartitionKey key = pd->key;
+
+	if (pd->keycmp == PARTKEY_CMP_FMGR)
+		return partition_rbound_datum_cmp(key->partsupfunc,
+										  key->partcollation,
+										  rb_datums, rb_kind,
+										  values, key->partnatts);
+
+	/* inline comparisons are only used for single-column keys */
+	if (rb_kind[0] == PARTITION_RANGE_DATUM_MINVALUE)
+		return -1;
+	else if (rb_kind[0] == PARTITION_RANGE_DATUM_MAXVALUE)
+		return 1;
+
+	return partkey_datum_cmp(pd, rb_datums[0], values[0]);
+}
+
+/*
+ * partkey_list_bsearch
+ *		Like partition_list_bsearch(), using the inline comparison if
+ *		possible.
+ */
+static int
+partkey_list_bsearch(PartitionDispatch pd, Datum value, bool *is_equal)
+{
+	PartitionBoundInfo boundinfo = pd->partdesc->boundinfo;
+	int			lo,
+				hi,
+				mid;
+
+	if (pd->keycmp == PARTKEY_CMP_FMGR)
+		return partition_list_bsearch(pd->key->partsupfunc,
+									  pd->key->partcollation,
+									  boundinfo, value, is_equal);
+
+	lo = -1;
+	hi = boundinfo->ndatums - 1;
+	while (lo < hi)
+	{
+		int32		cmpval;
+
+		mid = (lo + hi + 1) / 2;
+		cmpval = partkey_datum_cmp(pd, boundinfo->datums[mid][0], value);
+		if (cmpval <= 0)
+		{
+			lo = mid;
+			*is_equal = (cmpval == 0);
+			if (*is_equal)
+				break;
+		}
+		else
+			hi = mid - 1;
+	}
+
+	return lo;
+}
+
+/*
+ * partkey_range_bsearch
+ *		Like partition_range_datum_bsearch(), using the inline comparison if
+ *		possible.
+ */
+static int
+partkey_range_bsearch(PartitionDispatch pd, Datum *values, bool *is_equal)
+{
+	PartitionBoundInfo boundinfo = pd->partdesc->boundinfo;
+	int			lo,
+				hi,
+				mid;
+
+	if (pd->keycmp == PARTKEY_CMP_FMGR)
+		return partition_range_datum_bsearch(pd->key->partsupfunc,
+											 pd->key->partcollation,
+											 boundinfo, pd->key->partnatts,
+											 values, is_equal);
+
+	lo = -1;
+	hi = boundinfo->ndatums - 1;
+	while (lo < hi)
+	{
+		int32		cmpval;
+
+		mid = (lo + hi + 1) / 2;
+		cmpval = partkey_rbound_cmp(pd, boundinfo->datums[mid],
+									boundinfo->kind[mid], values);
+		if (cmpval <= 0)
+		{
+			lo = mid;
+			*is_equal = (cmpval == 0);
+			if (*is_equal)
+				break;
+		}
+		else
+			hi = mid - 1;
+	}
+
+	return lo;
+}
+
 /*
  * The number of times the same partition must be found in a row before we
  * switch from a binary search for the given values to just checking if the
@@ -1466,10 +1669,7 @@ get_partition_for_tuple(PartitionDispatch pd, Datum *values, bool *isnull)
 					int32		cmpval;
 
 					/* does the last found datum index match this datum? */
-					cmpval = DatumGetInt32(FunctionCall2Coll(&key->partsupfunc[0],
-															 key->partcollation[0],
-															 lastDatum,
-															 values[0]));
+					cmpval = partkey_datum_cmp(pd, lastDatum, values[0]);
 
 					if (cmpval == 0)
 						return boundinfo->indexes[last_datum_offset];
@@ -1477,10 +1677,7 @@ get_partition_for_tuple(PartitionDispatch pd, Datum *values, bool *isnull)
 					/* fall-through and do a manual lookup */
 				}
 
-				bound_offset = partition_list_bsearch(key->partsupfunc,
-													  key->partcollation,
-													  boundinfo,
-													  values[0], &equal);
+				bound_offset = partkey_list_bsearch(pd, values[0], &equal);
 				if (bound_offset >= 0 && equal)
 					part_index = boundinfo->indexes[bound_offset];
 			}
@@ -1517,12 +1714,7 @@ get_partition_for_tuple(PartitionDispatch pd, Datum *values, bool *isnull)
 					int32		cmpval;
 
 					/* check if the value is >= to the lower bound */
-					cmpval = partition_rbound_datum_cmp(key->partsupfunc,
-														key->partcollation,
-														lastDatums,
-														kind,
-														values,
-														key->partnatts);
+					cmpval = partkey_rbound_cmp(pd, lastDatums, kind, values);
 
 					/*
 					 * If it's equal to the lower bound then no need to check
@@ -1536,12 +1728,8 @@ get_partition_for_tuple(PartitionDispatch pd, Datum *values, bool *isnull)
 						/* check if the value is below the upper bound */
 						lastDatums = boundinfo->datums[last_datum_offset + 1];
 						kind = boundinfo->kind[last_datum_offset + 1];
-						cmpval = partition_rbound_datum_cmp(key->partsupfunc,
-															key->partcollation,
-															lastDatums,
-															kind,
-															values,
-															key->partnatts);
+						cmpval = partkey_rbound_cmp(pd, lastDatums, kind,
+													values);
 
 						if (cmpval > 0)
 							return boundinfo->indexes[last_datum_offset + 1];
@@ -1549,12 +1737,7 @@ get_partition_for_tuple(PartitionDispatch pd, Datum *values, bool *isnull)
 					/* fall-through and do a manual lookup */
 				}
 
-				bound_offset = partition_range_datum_bsearch(key->partsupfunc,
-															 key->partcollation,
-															 boundinfo,
-															 key->partnatts,
-															 values,
-															 &equal);
+				bound_offset = partkey_range_bsearch(pd, values, &equal);
 
 				/*
 				 * The bound at bound_offset is less than or equal to the
@@ -1819,12 +2002,24 @@ adjust_partition_colnos_using_map(List *colnos, AttrMap *attrMap)
  * entry  is still added to es_part_prune_results to maintain alignment with
  * es_part_prune_infos. This ensures that ExecInitPartitionExecPruning() can
  * use the same index to retrieve the pruning results.
+ *
+ * If the plan came from the plan cache, 'cplan' is the CachedPlan and
+ * 'cplan_generation' identifies the time it was locked for this execution.
+ * Unless the plan cache had to lock all of the partitions, it has done the
+ * initial pruning already, with the same Params, to find out which
+ * partitions to lock, and we use its results rather than doing the work
+ * again.
  */
 void
-ExecDoInitialPruning(EState *estate)
+ExecDoInitialPruning(EState *estate, CachedPlan *cplan, int cplan_generation)
 {
+	InitialPruneResult *prune_result = NULL;
 	ListCell   *lc;
 
+	if (cplan)
+		prune_result = CachedPlanTakePruneResult(cplan, cplan_generation,
+												 estate->es_plannedstmt);
+
 	foreach(lc, estate->es_part_prune_infos)
 	{
 		PartitionPruneInfo *pruneinfo = lfirst_node(PartitionPruneInfo, lc);
@@ -1843,6 +2038,15 @@ ExecDoInitialPruning(EState *estate)
 		 * Perform initial pruning steps, if any, and save the result
 		 * bitmapset or NULL as described in the header comment.
 		 */
+		if (prune_result)
+		{
+			validsubplans = bms_copy(list_nth(prune_result->validsubplans,
+											  foreach_current_index(lc)));
+			estate->es_part_prune_results =
+				lappend(estate->es_part_prune_results, validsubplans);
+			continue;
+		}
+
 		if (prunestate->do_initial_prune)
 			validsubplans = ExecFindMatchingSubPlans(prunestate, true,
 													 &validsubplan_rtis);
@@ -1853,7 +2057,168 @@ ExecDoInitialPruning(EState *estate)
 													 validsubplan_rtis);
 		estate->es_part_prune_results = lappend(estate->es_part_prune_results,
 												validsubplans);
+
+		/*
+		 * When the plan came from the plan cache, AcquireExecutorLocks() only
+		 * locked the prunable partitions that survived the same pruning
+		 * steps, and it only does that when the steps depend on nothing but
+		 * the Params, so we find the locks already held.  We get here with
+		 * such a plan if the pruning results were not available to us, such
+		 * as when the plan was locked for a nested execution in the meantime.
+		 * Take the locks anyway, so that a partition is never opened without
+		 * one.  (Parallel workers get a copy of es_unpruned_relids as
+		 * unprunableRelids, so there's nothing to do for them.)
+		 */
+		if (prunestate->do_initial_prune)
+		{
+			Bitmapset  *prunable_rtis;
+			int			rti = -1;
+
+			prunable_rtis = bms_difference(validsubplan_rtis,
+										   estate->es_plannedstmt->unprunableRelids);
+			while ((rti = bms_next_member(prunable_rtis, rti)) > 0)
+			{
+				RangeTblEntry *rte = exec_rt_fetch(rti, estate);
+
+				LockRelationOid(rte->relid, rte->rellockmode);
+			}
+			bms_free(prunable_rtis);
+		}
+	}
+
+	if (prune_result)
+		estate->es_unpruned_relids = bms_add_members(estate->es_unpruned_relids,
+													 prune_result->unpruned_relids);
+}
+
+/*
+ * initial_pruning_is_immutable
+ *		Do the initial pruning steps of a plan depend on nothing but the
+ *		values of its Params?
+ *
+ * Initial pruning steps may also call stable functions, either in the
+ * expressions compared with the partition key or as the comparison function
+ * itself (for example, comparing a timestamptz key with a date).  Their
+ * results can depend on the snapshot, and the plan cache prunes under a
+ * different snapshot than the one the query will later run with.
+ */
+static bool
+initial_pruning_is_immutable(PlannedStmt *plannedstmt)
+{
+	ListCell   *lc1;
+
+	foreach(lc1, plannedstmt->partPruneInfos)
+	{
+		PartitionPruneInfo *pruneinfo = lfirst_node(PartitionPruneInfo, lc1);
+		ListCell   *lc2;
+
+		foreach(lc2, pruneinfo->prune_infos)
+		{
+			List	   *prune_infos = lfirst(lc2);
+			ListCell   *lc3;
+
+			foreach(lc3, prune_infos)
+			{
+				PartitionedRelPruneInfo *pinfo = lfirst_node(PartitionedRelPruneInfo, lc3);
+				ListCell   *lc4;
+
+				foreach(lc4, pinfo->initial_pruning_steps)
+				{
+					PartitionPruneStepOp *step = lfirst(lc4);
+					ListCell   *lc5;
+
+					if (!IsA(step, PartitionPruneStepOp))
+						continue;
+
+					if (contain_mutable_functions((Node *) step->exprs))
+						return false;
+					foreach(lc5, step->cmpfns)
+					{
+						if (func_volatile(lfirst_oid(lc5)) != PROVOLATILE_IMMUTABLE)
+							return false;
+					}
+				}
+			}
+		}
+	}
+
+	return true;
+}
+
+/*
+ * ExecGetInitialPruneResult
+ *		Perform the initial pruning steps of a plan without otherwise starting
+ *		up the executor.
+ *
+ * This lets the plan cache avoid locking the partitions of a generic plan
+ * that initial pruning will remove anyway, and hand the results over to
+ * ExecDoInitialPruning() so that it needn't repeat the work.  The caller must
+ * already hold the locks on all of plannedstmt->unprunableRelids, which
+ * include the partitioned tables whose partitions are being pruned, and must
+ * have an active snapshot in case the pruning steps call stable functions.
+ * Values for external Params are taken from 'params'.
+ *
+ * Returns NULL if the pruning steps call stable functions, since the executor
+ * might not get the same answer later; see initial_pruning_is_immutable().
+ * The caller must then assume that none of the partitions are pruned.
+ *
+ * The result is allocated in the caller's memory context.
+ */
+InitialPruneResult *
+ExecGetInitialPruneResult(PlannedStmt *plannedstmt, ParamListInfo params)
+{
+	EState	   *estate;
+	MemoryContext oldcxt;
+	InitialPruneResult *result;
+	List	   *validsubplans = NIL;
+	Bitmapset  *unpruned = NULL;
+	ListCell   *lc;
+
+	if (!initial_pruning_is_immutable(plannedstmt))
+		return NULL;
+
+	estate = CreateExecutorState();
+	oldcxt = MemoryContextSwitchTo(estate->es_query_cxt);
+
+	estate->es_param_list_info = params;
+	ExecInitRangeTable(estate, plannedstmt->rtable, plannedstmt->permInfos,
+					   bms_copy(plannedstmt->unprunableRelids));
+	estate->es_plannedstmt = plannedstmt;
+
+	foreach(lc, plannedstmt->partPruneInfos)
+	{
+		PartitionPruneInfo *pruneinfo = lfirst_node(PartitionPruneInfo, lc);
+		PartitionPruneState *prunestate;
+		Bitmapset  *all_leafpart_rtis = NULL;
+		Bitmapset  *validsubplan_rtis = NULL;
+		Bitmapset  *valid = NULL;
+
+		prunestate = CreatePartitionPruneState(estate, pruneinfo,
+											   &all_leafpart_rtis);
+		if (prunestate->do_initial_prune)
+			valid = ExecFindMatchingSubPlans(prunestate, true,
+											 &validsubplan_rtis);
+		else
+			validsubplan_rtis = all_leafpart_rtis;
+
+		validsubplans = lappend(validsubplans, valid);
+		unpruned = bms_add_members(unpruned, validsubplan_rtis);
 	}
+
+	MemoryContextSwitchTo(oldcxt);
+
+	result = palloc_object(InitialPruneResult);
+	result->plannedstmt = plannedstmt;
+	result->validsubplans = NIL;
+	foreach(lc, validsubplans)
+		result->validsubplans = lappend(result->validsubplans,
+										bms_copy(lfirst(lc)));
+	result->unpruned_relids = bms_copy(unpruned);
+
+	ExecCloseRangeTableRelations(estate);
+	FreeExecutorState(estate);
+
+	return result;
 }
 
 /*
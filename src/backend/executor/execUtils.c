@@ -58,6 +58,7 @@
 #include "storage/lmgr.h"
 #include "utils/builtins.h"
 #include "utils/memutils.h"
+#include "utils/plancache.h"
 #include "utils/rel.h"
 #include "utils/typcache.h"
 
@@ -162,6 +163,8 @@ CreateExecutorState(void)
 	estate->es_parallel_workers_to_launch = 0;
 	estate->es_parallel_workers_launched = 0;
 
+	estate->es_misestimated = false;
+
 	estate->es_jit_flags = 0;
 	estate->es_jit = NULL;
 
@@ -678,6 +681,32 @@ tlist_matches_tupdesc(PlanState *ps, List *tlist, int varno, TupleDesc tupdesc)
 	return true;
 }
 
+/* ----------------
+ *		ExecCheckRowEstimate
+ *
+ * Called by nodes that consume their whole outer input before returning
+ * anything (Hash, Sort, Material) once they know how many rows it produced.
+ * If that's far more than the planner expected, remember it in the EState so
+ * that, at ExecutorEnd, the plan cache can be told that this plan was built
+ * on a bad estimate.  See plan_cache_misestimate_factor.
+ * ----------------
+ */
+void
+ExecCheckRowEstimate(PlanState *node, double ntuples)
+{
+	Plan	   *outerPlan;
+
+	if (plan_cache_misestimate_factor <= 0)
+		return;
+
+	outerPlan = outerPlan(node->plan);
+	if (outerPlan == NULL)
+		return;
+
+	if (ntuples > Max(outerPlan->plan_rows, 1.0) * plan_cache_misestimate_factor)
+		node->state->es_misestimated = true;
+}
+
 
 /* ----------------------------------------------------------------
  *				  Scan node support
@@ -169,6 +169,7 @@ typedef struct SQLFunctionCache
 	 * get a CachedPlan from.
 	 */
 	CachedPlan *cplan;			/* Plan for current query, if any */
+	int			cplan_generation;	/* its lock generation when we got it */
 	ResourceOwner cowner;		/* CachedPlan is registered with this owner */
 	int			next_query_index;	/* index of next CachedPlanSource to run */
 
@@ -699,6 +700,7 @@ init_execution_state(SQLFunctionCachePtr fcache)
 								  fcache->paramLI,
 								  fcache->cowner,
 								  NULL);
+	fcache->cplan_generation = fcache->cplan->lock_generation;
 
 	/*
 	 * If necessary, make esarray[] bigger to hold the needed state.
@@ -1369,6 +1371,8 @@ postquel_start(execution_state *es, SQLFunctionCachePtr fcache)
 							 fcache->paramLI,
 							 es->qd ? es->qd->queryEnv : NULL,
 							 0);
+	es->qd->cplan = fcache->cplan;
+	es->qd->cplan_generation = fcache->cplan_generation;
 
 	/* Utility commands don't need Executor. */
 	if (es->qd->operation != CMD_UTILITY)
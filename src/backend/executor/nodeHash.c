@@ -204,6 +204,8 @@ MultiExecPrivateHash(HashState *node)
 		hashtable->spacePeak = hashtable->spaceUsed;
 
 	hashtable->partialTuples = hashtable->totalTuples;
+
+	ExecCheckRowEstimate(&node->ps, hashtable->totalTuples);
 }
 
 /* ----------------------------------------------------------------
@@ -135,6 +135,9 @@ ExecMaterial(PlanState *pstate)
 		if (TupIsNull(outerslot))
 		{
 			node->eof_underlying = true;
+			if (tuplestorestate)
+				ExecCheckRowEstimate(&node->ss.ps,
+									 (double) tuplestore_tuple_count(tuplestorestate));
 			return NULL;
 		}
 
@@ -17,6 +17,21 @@
  *		ExecNestLoop	 - process a nestloop join of two plans
  *		ExecInitNestLoop - initialize the join
  *		ExecEndNestLoop  - shut down the join
+ *
+ * ADAPTIVE HASHING
+ *
+ *		When the inner plan doesn't depend on the outer one, a nestloop join
+ *		rescans the whole inner plan for every outer tuple, which is only
+ *		cheap if there are few outer tuples.  If the planner found hashable
+ *		join clauses in such a join (and enable_adaptive_nestloop is on),
+ *		we keep count of the outer tuples, and once there are many more of
+ *		them than the planner estimated, we read the inner plan one last
+ *		time into a hash table keyed by the inner side of those clauses.
+ *		From then on, each outer tuple is joined to just the inner tuples
+ *		found under its own key values.  All join quals are still checked
+ *		as usual, so the hash lookup only serves to skip inner tuples that
+ *		can't match.  If the inner plan's output turns out not to fit in
+ *		hash_mem, we give up on the idea and continue as a plain nestloop.
  */
 
 #include "postgres.h"
@@ -24,6 +39,19 @@
 #include "executor/execdebug.h"
 #include "executor/nodeNestloop.h"
 #include "miscadmin.h"
+#include "nodes/makefuncs.h"
+#include "utils/memutils.h"
+
+/*
+ * Switch to hashing the inner plan once the outer plan has returned this
+ * many times as many tuples as the planner estimated.
+ */
+#define NESTLOOP_HASH_SWITCH_FACTOR		10.0
+
+static void ExecNestLoopHashInner(NestLoopState *node);
+static List *ExecNestLoopHashLookup(NestLoopState *node);
+static void ExecNestLoopResetHash(NestLoopState *node);
+static bool ExecNestLoopKeysHaveNull(TupleTableSlot *keyslot, int numkeys);
 
 
 /* ----------------------------------------------------------------
@@ -120,6 +148,16 @@ ExecNestLoop(PlanState *pstate)
 			econtext->ecxt_outertuple = outerTupleSlot;
 			node->nl_NeedNewOuter = false;
 			node->nl_MatchedOuter = false;
+			node->nl_OuterRows++;
+
+			/*
+			 * If the outer plan has returned many more tuples than expected,
+			 * try to switch to hashing the inner plan.
+			 */
+			if (node->nl_SwitchRows > 0 && !node->nl_HashFilled &&
+				!node->nl_HashFailed &&
+				node->nl_OuterRows > node->nl_SwitchRows)
+				ExecNestLoopHashInner(node);
 
 			/*
 			 * fetch the values of any outer Vars that must be passed to the
@@ -145,10 +183,20 @@ ExecNestLoop(PlanState *pstate)
 			}
 
 			/*
-			 * now rescan the inner plan
+			 * now rescan the inner plan, or if we have hashed it, look up the
+			 * inner tuples that might match this outer tuple
 			 */
-			ENL1_printf("rescanning inner plan");
-			ExecReScan(innerPlan);
+			if (node->nl_HashFilled)
+			{
+				ENL1_printf("probing inner hash table");
+				node->nl_HashMatches = ExecNestLoopHashLookup(node);
+				node->nl_HashMatchPos = 0;
+			}
+			else
+			{
+				ENL1_printf("rescanning inner plan");
+				ExecReScan(innerPlan);
+			}
 		}
 
 		/*
@@ -156,7 +204,22 @@ ExecNestLoop(PlanState *pstate)
 		 */
 		ENL1_printf("getting new inner tuple");
 
-		innerTupleSlot = ExecProcNode(innerPlan);
+		if (node->nl_HashFilled)
+		{
+			if (node->nl_HashMatchPos < list_length(node->nl_HashMatches))
+			{
+				MinimalTuple tuple = list_nth(node->nl_HashMatches,
+											  node->nl_HashMatchPos++);
+
+				innerTupleSlot = ExecStoreMinimalTuple(tuple,
+													   node->nl_HashTupleSlot,
+													   false);
+			}
+			else
+				innerTupleSlot = NULL;
+		}
+		else
+			innerTupleSlot = ExecProcNode(innerPlan);
 		econtext->ecxt_innertuple = innerTupleSlot;
 
 		if (TupIsNull(innerTupleSlot))
@@ -254,6 +317,164 @@ ExecNestLoop(PlanState *pstate)
 	}
 }
 
+/*
+ * ExecNestLoopHashInner
+ *		Read the whole inner plan into the hash table
+ *
+ * On success, nl_HashFilled is set.  If the inner plan's output doesn't fit
+ * in hash_mem, the hash table is thrown away again and nl_HashFailed is set
+ * instead, so that we don't try again.
+ */
+static void
+ExecNestLoopHashInner(NestLoopState *node)
+{
+	PlanState  *innerPlan = innerPlanState(node);
+	ExprContext *econtext = node->js.ps.ps_ExprContext;
+	int			numkeys = node->nl_NumHashKeys;
+	Size		hash_mem_limit = get_hash_memory_limit();
+	uint64		nrows = 0;
+
+	Assert(!node->nl_HashFilled);
+
+	if (node->nl_HashTable == NULL)
+	{
+		TupleDesc	keydesc = node->nl_InnerKeyProj->pi_state.resultslot->tts_tupleDescriptor;
+		MemoryContext oldcxt;
+		AttrNumber *keyColIdx;
+		long		nbuckets;
+
+		/*
+		 * Everything goes into nl_HashContext, so that we can get rid of the
+		 * table by just resetting that.
+		 */
+		oldcxt = MemoryContextSwitchTo(node->nl_HashContext);
+		keyColIdx = (AttrNumber *) palloc(numkeys * sizeof(AttrNumber));
+		for (int i = 0; i < numkeys; i++)
+			keyColIdx[i] = i + 1;
+		MemoryContextSwitchTo(oldcxt);
+
+		/* the planner made sure that the estimate is of reasonable size */
+		nbuckets = (long) Max(innerPlan->plan->plan_rows, 1.0);
+		node->nl_HashTable = BuildTupleHashTable(&node->js.ps,
+												 keydesc,
+												 &TTSOpsVirtual,
+												 numkeys,
+												 keyColIdx,
+												 node->nl_EqFuncOids,
+												 node->nl_HashFunctions,
+												 node->nl_HashCollations,
+												 nbuckets,
+												 sizeof(List *),
+												 node->nl_HashContext,
+												 node->nl_HashContext,
+												 econtext->ecxt_per_tuple_memory,
+												 false);
+	}
+
+	ENL1_printf("hashing inner plan");
+	ExecReScan(innerPlan);
+
+	for (;;)
+	{
+		TupleTableSlot *innerTupleSlot;
+		TupleTableSlot *keyslot;
+		TupleHashEntry entry;
+		List	  **tuples;
+		MemoryContext oldcxt;
+		bool		isnew;
+		Size		space;
+
+		innerTupleSlot = ExecProcNode(innerPlan);
+		if (TupIsNull(innerTupleSlot))
+			break;
+
+		econtext->ecxt_innertuple = innerTupleSlot;
+		keyslot = ExecProject(node->nl_InnerKeyProj);
+
+		/* The hash operators are strict, so a null key never matches */
+		if (!ExecNestLoopKeysHaveNull(keyslot, numkeys))
+		{
+			entry = LookupTupleHashEntry(node->nl_HashTable, keyslot,
+										 &isnew, NULL);
+			tuples = (List **) TupleHashEntryGetAdditional(node->nl_HashTable,
+														   entry);
+
+			oldcxt = MemoryContextSwitchTo(node->nl_HashContext);
+			*tuples = lappend(*tuples,
+							  ExecCopySlotMinimalTuple(innerTupleSlot));
+			MemoryContextSwitchTo(oldcxt);
+			nrows++;
+		}
+
+		ResetExprContext(econtext);
+
+		space = MemoryContextMemAllocated(node->nl_HashContext, true);
+		node->nl_HashSpacePeak = Max(node->nl_HashSpacePeak, space);
+		if (space > hash_mem_limit)
+		{
+			ENL1_printf("inner plan doesn't fit in hash_mem");
+			ExecNestLoopResetHash(node);
+			node->nl_HashFailed = true;
+			return;
+		}
+	}
+
+	node->nl_HashFilled = true;
+	node->nl_SwitchedAt = node->nl_OuterRows;
+	node->nl_HashedRows = nrows;
+}
+
+/*
+ * ExecNestLoopHashLookup
+ *		Return the list of inner tuples that might match the current outer
+ *		tuple
+ */
+static List *
+ExecNestLoopHashLookup(NestLoopState *node)
+{
+	TupleTableSlot *keyslot;
+	TupleHashEntry entry;
+
+	keyslot = ExecProject(node->nl_OuterKeyProj);
+	if (ExecNestLoopKeysHaveNull(keyslot, node->nl_NumHashKeys))
+		return NIL;
+
+	entry = LookupTupleHashEntry(node->nl_HashTable, keyslot, NULL, NULL);
+	if (entry == NULL)
+		return NIL;
+
+	return *(List **) TupleHashEntryGetAdditional(node->nl_HashTable, entry);
+}
+
+/*
+ * ExecNestLoopResetHash
+ *		Throw away the hash table, going back to rescanning the inner plan
+ */
+static void
+ExecNestLoopResetHash(NestLoopState *node)
+{
+	MemoryContextReset(node->nl_HashContext);
+	node->nl_HashTable = NULL;
+	node->nl_HashFilled = false;
+	node->nl_HashMatches = NIL;
+	node->nl_HashMatchPos = 0;
+}
+
+/*
+ * Does a slot produced by one of the hash key projections contain a null?
+ */
+static bool
+ExecNestLoopKeysHaveNull(TupleTableSlot *keyslot, int numkeys)
+{
+	slot_getallattrs(keyslot);
+	for (int i = 0; i < numkeys; i++)
+	{
+		if (keyslot->tts_isnull[i])
+			return true;
+	}
+	return false;
+}
+
 /* ----------------------------------------------------------------
  *		ExecInitNestLoop
  * ----------------------------------------------------------------
@@ -304,6 +525,17 @@ ExecInitNestLoop(NestLoop *node, EState *estate, int eflags)
 	 * Initialize result slot, type and projection.
 	 */
 	ExecInitResultTupleSlotTL(&nlstate->js.ps, &TTSOpsVirtual);
+
+	/*
+	 * If we might switch to hashing the inner plan, inner tuples may come
+	 * from our own slot rather than the inner plan's.
+	 */
+	if (node->hashclauses != NIL)
+	{
+		nlstate->js.ps.inneropsset = true;
+		nlstate->js.ps.inneropsfixed = false;
+	}
+
 	ExecAssignProjectionInfo(&nlstate->js.ps, NULL);
 
 	/*
@@ -339,6 +571,67 @@ ExecInitNestLoop(NestLoop *node, EState *estate, int eflags)
 				 (int) node->join.jointype);
 	}
 
+	/*
+	 * set up for switching to hashing the inner plan, if possible
+	 */
+	if (node->hashclauses != NIL)
+	{
+		ExprContext *econtext = nlstate->js.ps.ps_ExprContext;
+		int			numkeys = list_length(node->hashclauses);
+		List	   *outerkeys = NIL;
+		List	   *innerkeys = NIL;
+		Oid		   *eqoperators;
+		TupleTableSlot *keyslot;
+		ListCell   *lc;
+		int			i;
+
+		eqoperators = (Oid *) palloc(numkeys * sizeof(Oid));
+		nlstate->nl_HashCollations = (Oid *) palloc(numkeys * sizeof(Oid));
+		i = 0;
+		foreach(lc, node->hashclauses)
+		{
+			OpExpr	   *hclause = lfirst_node(OpExpr, lc);
+
+			outerkeys = lappend(outerkeys,
+								makeTargetEntry(linitial(hclause->args),
+												i + 1, NULL, false));
+			innerkeys = lappend(innerkeys,
+								makeTargetEntry(lsecond(hclause->args),
+												i + 1, NULL, false));
+			eqoperators[i] = list_nth_oid(node->hashoperators, i);
+			nlstate->nl_HashCollations[i] = list_nth_oid(node->hashcollations,
+														 i);
+			i++;
+		}
+		nlstate->nl_NumHashKeys = numkeys;
+		execTuplesHashPrepare(numkeys, eqoperators,
+							  &nlstate->nl_EqFuncOids,
+							  &nlstate->nl_HashFunctions);
+
+		keyslot = ExecInitExtraTupleSlot(estate, ExecTypeFromTL(outerkeys),
+										 &TTSOpsVirtual);
+		nlstate->nl_OuterKeyProj =
+			ExecBuildProjectionInfo(outerkeys, econtext, keyslot,
+									&nlstate->js.ps, NULL);
+		keyslot = ExecInitExtraTupleSlot(estate, ExecTypeFromTL(innerkeys),
+										 &TTSOpsVirtual);
+		nlstate->nl_InnerKeyProj =
+			ExecBuildProjectionInfo(innerkeys, econtext, keyslot,
+									&nlstate->js.ps, NULL);
+
+		nlstate->nl_HashTupleSlot =
+			ExecInitExtraTupleSlot(estate,
+								   ExecGetResultType(innerPlanState(nlstate)),
+								   &TTSOpsMinimalTuple);
+		nlstate->nl_HashContext =
+			AllocSetContextCreate(CurrentMemoryContext,
+								  "NestLoop hash table",
+								  ALLOCSET_DEFAULT_SIZES);
+
+		nlstate->nl_SwitchRows = Max(outerPlan(node)->plan_rows, 1.0) *
+			NESTLOOP_HASH_SWITCH_FACTOR;
+	}
+
 	/*
 	 * finally, wipe the current outer tuple clean.
 	 */
@@ -369,6 +662,10 @@ ExecEndNestLoop(NestLoopState *node)
 	ExecEndNode(outerPlanState(node));
 	ExecEndNode(innerPlanState(node));
 
+	/* free the hash table, if any */
+	if (node->nl_HashContext)
+		MemoryContextDelete(node->nl_HashContext);
+
 	NL1_printf("ExecEndNestLoop: %s\n",
 			   "node processing ended");
 }
@@ -393,7 +690,17 @@ ExecReScanNestLoop(NestLoopState *node)
 	 * innerPlan is re-scanned for each new outer tuple and MUST NOT be
 	 * re-scanned from here or you'll get troubles from inner index scans when
 	 * outer Vars are used as run-time keys...
+	 *
+	 * However, if we have hashed the inner plan's output and the inner plan
+	 * depends on parameters that have changed, the hash table is stale.
+	 * Otherwise we can keep using it.
 	 */
+	if (node->nl_HashTable != NULL &&
+		innerPlanState(node)->chgParam != NULL)
+		ExecNestLoopResetHash(node);
+	node->nl_HashMatches = NIL;
+	node->nl_HashMatchPos = 0;
+	node->nl_OuterRows = 0;
 
 	node->nl_NeedNewOuter = true;
 	node->nl_MatchedOuter = false;
@@ -78,6 +78,7 @@ ExecSort(PlanState *pstate)
 		PlanState  *outerNode;
 		TupleDesc	tupDesc;
 		int			tuplesortopts = TUPLESORT_NONE;
+		double		ntuples = 0;
 
 		SO1_printf("ExecSort: %s\n",
 				   "sorting subplan");
@@ -140,6 +141,7 @@ ExecSort(PlanState *pstate)
 				tuplesort_putdatum(tuplesortstate,
 								   slot->tts_values[0],
 								   slot->tts_isnull[0]);
+				ntuples++;
 			}
 		}
 		else
@@ -151,6 +153,7 @@ ExecSort(PlanState *pstate)
 				if (TupIsNull(slot))
 					break;
 				tuplesort_puttupleslot(tuplesortstate, slot);
+				ntuples++;
 			}
 		}
 
@@ -158,6 +161,7 @@ ExecSort(PlanState *pstate)
 		 * Complete the sort.
 		 */
 		tuplesort_performsort(tuplesortstate);
+		ExecCheckRowEstimate(&node->ss.ps, ntuples);
 
 		/*
 		 * restore to user specified direction
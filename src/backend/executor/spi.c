@@ -2410,6 +2410,7 @@ _SPI_execute_plan(SPIPlanPtr plan, const SPIExecuteOptions *options,
 	SPICallbackArg spicallbackarg;
 	ErrorContextCallback spierrcontext;
 	CachedPlan *cplan = NULL;
+	int			cplan_generation = 0;
 	ListCell   *lc1;
 
 	/*
@@ -2576,6 +2577,7 @@ _SPI_execute_plan(SPIPlanPtr plan, const SPIExecuteOptions *options,
 		 */
 		cplan = GetCachedPlan(plansource, options->params,
 							  plan_owner, _SPI_current->queryEnv);
+		cplan_generation = cplan->lock_generation;
 
 		stmt_list = cplan->stmt_list;
 
@@ -2696,6 +2698,8 @@ _SPI_execute_plan(SPIPlanPtr plan, const SPIExecuteOptions *options,
 										options->params,
 										_SPI_current->queryEnv,
 										0);
+				qdesc->cplan = cplan;
+				qdesc->cplan_generation = cplan_generation;
 				res = _SPI_pquery(qdesc, fire_triggers,
 								  canSetTag ? options->tcount : 0);
 				FreeQueryDesc(qdesc);
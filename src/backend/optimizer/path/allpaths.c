@@ -47,6 +47,7 @@
 #include "port/pg_bitutils.h"
 #include "rewrite/rewriteManip.h"
 #include "utils/lsyscache.h"
+#include "utils/memutils.h"
 
 
 /* Bitmask flags for pushdown_safety_info.unsafeFlags */
@@ -78,6 +79,8 @@ typedef enum pushdown_safe_type
 /* These parameters are set by GUC */
 bool		enable_geqo = false;	/* just in case GUC doesn't set it */
 int			geqo_threshold;
+int			idp_threshold;
+int			idp_block_size;
 int			min_parallel_table_scan_size;
 int			min_parallel_index_scan_size;
 
@@ -142,6 +145,11 @@ static void set_result_pathlist(PlannerInfo *root, RelOptInfo *rel,
 static void set_worktable_pathlist(PlannerInfo *root, RelOptInfo *rel,
 								   RangeTblEntry *rte);
 static RelOptInfo *make_rel_from_joinlist(PlannerInfo *root, List *joinlist);
+static RelOptInfo *join_search_by_levels(PlannerInfo *root, int levels_needed,
+										 List *initial_rels);
+static RelOptInfo *idp_join_search(PlannerInfo *root, int levels_needed,
+								   List *initial_rels);
+static List *idp_choose_block(PlannerInfo *root, List *rels);
 static bool subquery_is_pushdown_safe(Query *subquery, Query *topquery,
 									  pushdown_safety_info *safetyInfo);
 static bool recurse_pushdown_safe(Node *setOp, Query *topquery,
@@ -3408,6 +3416,8 @@ make_rel_from_joinlist(PlannerInfo *root, List *joinlist)
 
 		if (join_search_hook)
 			return (*join_search_hook) (root, levels_needed, initial_rels);
+		else if (idp_threshold > 0 && levels_needed >= idp_threshold)
+			return idp_join_search(root, levels_needed, initial_rels);
 		else if (enable_geqo && levels_needed >= geqo_threshold)
 			return geqo(root, levels_needed, initial_rels);
 		else
@@ -3446,6 +3456,30 @@ make_rel_from_joinlist(PlannerInfo *root, List *joinlist)
  */
 RelOptInfo *
 standard_join_search(PlannerInfo *root, int levels_needed, List *initial_rels)
+{
+	RelOptInfo *rel;
+
+	rel = join_search_by_levels(root, levels_needed, initial_rels);
+
+	/*
+	 * We should have a single rel at the final level.
+	 */
+	if (rel == NULL)
+		elog(ERROR, "failed to build any %d-way joins", levels_needed);
+
+	return rel;
+}
+
+/*
+ * join_search_by_levels
+ *	  Workhorse for standard_join_search().
+ *
+ * Returns NULL if no way to join all the items was found, which can happen
+ * when outer joins constrain the join order and the items are not the
+ * original jointree items; see idp_join_search().
+ */
+static RelOptInfo *
+join_search_by_levels(PlannerInfo *root, int levels_needed, List *initial_rels)
 {
 	int			lev;
 	RelOptInfo *rel;
@@ -3517,18 +3551,182 @@ standard_join_search(PlannerInfo *root, int levels_needed, List *initial_rels)
 		}
 	}
 
+	if (root->join_rel_level[levels_needed] == NIL)
+		rel = NULL;
+	else
+	{
+		Assert(list_length(root->join_rel_level[levels_needed]) == 1);
+		rel = (RelOptInfo *) linitial(root->join_rel_level[levels_needed]);
+	}
+
+	root->join_rel_level = NULL;
+
+	return rel;
+}
+
+/*
+ * idp_join_search
+ *	  Find a join order for a large number of jointree items by iterative
+ *	  dynamic programming.
+ *
+ * This is the IDP1 algorithm of Kossmann and Stocker.  Rather than
+ * considering all the ways to join all of the items, we only search for
+ * joins of up to idp_block_size items, commit to the cheapest of the largest
+ * joins we found, and treat that join as a single item from then on.  That
+ * is repeated until few enough items remain to join them all in a regular
+ * search.  Each step does about as much work as a regular search for
+ * idp_block_size items, so planning time grows polynomially rather than
+ * exponentially with the number of items, and unlike GEQO the result is
+ * deterministic.
+ *
+ * When outer joins or lateral references constrain the join order, a step
+ * may find no join at all, or commit to a join that turns out not to fit
+ * into any legal join of all the items.  In that case we throw away the
+ * join rels built so far and fall back to GEQO or the regular search over
+ * the original items, as if IDP had not been enabled.
+ */
+static RelOptInfo *
+idp_join_search(PlannerInfo *root, int levels_needed, List *initial_rels)
+{
+	List	   *rels = list_copy(initial_rels);
+	int			savelength = list_length(root->join_rel_list);
+	RelOptInfo *rel = NULL;
+
+	for (;;)
+	{
+		List	   *chosen;
+
+		/* has_legal_joinclause() needs to see the current items */
+		root->initial_rels = rels;
+
+		if (list_length(rels) <= idp_block_size)
+		{
+			rel = join_search_by_levels(root, list_length(rels), rels);
+			break;
+		}
+
+		chosen = idp_choose_block(root, rels);
+		if (chosen == NIL)
+			break;
+
+		/*
+		 * Build the chosen join for real, by a regular search over the items
+		 * it consists of, and replace them with it.
+		 */
+		rel = join_search_by_levels(root, list_length(chosen), chosen);
+		if (rel == NULL)
+			break;
+		rels = list_difference_ptr(rels, chosen);
+		rels = lappend(rels, rel);
+		rel = NULL;
+	}
+
+	root->initial_rels = initial_rels;
+
+	if (rel != NULL)
+		return rel;
+
 	/*
-	 * We should have a single rel at the final level.
+	 * Forget the join rels we built.  The hash table, if any, may contain
+	 * some of them, so just let find_join_rel() build it again.
 	 */
-	if (root->join_rel_level[levels_needed] == NIL)
-		elog(ERROR, "failed to build any %d-way joins", levels_needed);
-	Assert(list_length(root->join_rel_level[levels_needed]) == 1);
+	root->join_rel_list = list_truncate(root->join_rel_list, savelength);
+	if (root->join_rel_hash)
+	{
+		hash_destroy(root->join_rel_hash);
+		root->join_rel_hash = NULL;
+	}
+
+	if (enable_geqo && levels_needed >= geqo_threshold)
+		return geqo(root, levels_needed, initial_rels);
+	return standard_join_search(root, levels_needed, initial_rels);
+}
+
+/*
+ * idp_choose_block
+ *	  Do one step of iterative dynamic programming: search for joins of up to
+ *	  idp_block_size of the given items, and return the items that make up
+ *	  the cheapest of the largest joins, or NIL if no join was possible.
+ *
+ * This builds a lot of join relations we don't want to keep, so as in
+ * geqo_eval() we do it in a temporary memory context and remove them from
+ * join_rel_list again afterwards.  The caller rebuilds the chosen one.
+ */
+static List *
+idp_choose_block(PlannerInfo *root, List *rels)
+{
+	MemoryContext mycontext;
+	MemoryContext oldcxt;
+	int			savelength;
+	struct HTAB *savehash;
+	RelOptInfo *best = NULL;
+	List	   *result = NIL;
+	int			lev;
+	ListCell   *lc;
+
+	Assert(root->join_rel_level == NULL);
+
+	mycontext = AllocSetContextCreate(CurrentMemoryContext,
+									  "IDP",
+									  ALLOCSET_DEFAULT_SIZES);
+	oldcxt = MemoryContextSwitchTo(mycontext);
+
+	savelength = list_length(root->join_rel_list);
+	savehash = root->join_rel_hash;
+	root->join_rel_hash = NULL;
+
+	root->join_rel_level = (List **) palloc0((idp_block_size + 1) * sizeof(List *));
+	root->join_rel_level[1] = rels;
+
+	for (lev = 2; lev <= idp_block_size; lev++)
+	{
+		join_search_one_level(root, lev);
+
+		/* See standard_join_search() */
+		foreach(lc, root->join_rel_level[lev])
+		{
+			RelOptInfo *rel = (RelOptInfo *) lfirst(lc);
+
+			generate_partitionwise_join_paths(root, rel);
+			generate_useful_gather_paths(root, rel, false);
+			set_cheapest(rel);
+		}
+	}
+
+	/* Choose the cheapest rel from the highest level we reached */
+	for (lev = idp_block_size; lev >= 2 && best == NULL; lev--)
+	{
+		foreach(lc, root->join_rel_level[lev])
+		{
+			RelOptInfo *rel = (RelOptInfo *) lfirst(lc);
+
+			if (best == NULL ||
+				rel->cheapest_total_path->total_cost <
+				best->cheapest_total_path->total_cost)
+				best = rel;
+		}
+	}
+
+	MemoryContextSwitchTo(oldcxt);
+
+	if (best != NULL)
+	{
+		foreach(lc, rels)
+		{
+			RelOptInfo *rel = (RelOptInfo *) lfirst(lc);
 
-	rel = (RelOptInfo *) linitial(root->join_rel_level[levels_needed]);
+			if (bms_is_subset(rel->relids, best->relids))
+				result = lappend(result, rel);
+		}
+	}
 
 	root->join_rel_level = NULL;
+	root->join_rel_list = list_truncate(root->join_rel_list, savelength);
+	root->join_rel_hash = savehash;
 
-	return rel;
+	MemoryContextDelete(mycontext);
+
+	return result;
 }
 
 /*****************************************************************************
@@ -154,6 +154,16 @@ clauselist_selectivity_ext(PlannerInfo *root,
 											jointype, sjinfo, rel,
 											&estimatedclauses, false);
 	}
+	else if (use_extended_stats && rel == NULL && varRelid == 0)
+	{
+		/*
+		 * These may be join clauses.  Try to estimate equality clauses that
+		 * join the same pair of relations together, using extended
+		 * statistics on both sides.
+		 */
+		s1 = statext_join_clauselist_selectivity(root, clauses, jointype,
+												 sjinfo, &estimatedclauses);
+	}
 
 	/*
 	 * Apply normal selectivity estimates for remaining clauses. We'll be
@@ -344,8 +344,13 @@ add_paths_to_joinrel(PlannerInfo *root,
 	 * could add new paths (such as CustomPaths) by calling add_path(), or
 	 * add_partial_path() if parallel aware.  They could also delete or modify
 	 * paths added by the core code.
+	 *
+	 * A join to a partially aggregated upper rel is only built to consider
+	 * aggregating below the join (see try_eager_aggregation()), and isn't
+	 * offered to them.
 	 */
-	if (set_join_pathlist_hook)
+	if (set_join_pathlist_hook &&
+		!IS_UPPER_REL(outerrel) && !IS_UPPER_REL(innerrel))
 		set_join_pathlist_hook(root, joinrel, outerrel, innerrel,
 							   save_jointype, &extra);
 }
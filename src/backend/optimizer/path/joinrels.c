@@ -14,6 +14,7 @@
  */
 #include "postgres.h"
 
+#include "common/hashfn.h"
 #include "miscadmin.h"
 #include "optimizer/appendinfo.h"
 #include "optimizer/joininfo.h"
@@ -21,9 +22,23 @@
 #include "optimizer/paths.h"
 #include "optimizer/planner.h"
 #include "partitioning/partbounds.h"
+#include "utils/hsearch.h"
 #include "utils/memutils.h"
 
 
+/* Hash table key and entry for PlannerInfo.child_rinfo_hash */
+typedef struct ChildRinfoKey
+{
+	RestrictInfo *parent_rinfo;
+	Relids		child_relids;	/* translated parent_rinfo->required_relids */
+} ChildRinfoKey;
+
+typedef struct ChildRinfoEntry
+{
+	ChildRinfoKey key;			/* hash key --- MUST BE FIRST */
+	RestrictInfo *child_rinfo;
+} ChildRinfoEntry;
+
 static void make_rels_by_clause_joins(PlannerInfo *root,
 									  RelOptInfo *old_rel,
 									  List *other_rels,
@@ -43,6 +58,13 @@ static void try_partitionwise_join(PlannerInfo *root, RelOptInfo *rel1,
 								   RelOptInfo *rel2, RelOptInfo *joinrel,
 								   SpecialJoinInfo *parent_sjinfo,
 								   List *parent_restrictlist);
+static List *build_child_join_restrictlist(PlannerInfo *root,
+										   List *parent_restrictlist,
+										   int nappinfos,
+										   AppendRelInfo **appinfos);
+static uint32 child_rinfo_hash_fn(const void *key, Size keysize);
+static int	child_rinfo_match_fn(const void *key1, const void *key2,
+								 Size keysize);
 static SpecialJoinInfo *build_child_join_sjinfo(PlannerInfo *root,
 												SpecialJoinInfo *parent_sjinfo,
 												Relids left_relids, Relids right_relids);
@@ -1592,10 +1614,9 @@ try_partitionwise_join(PlannerInfo *root, RelOptInfo *rel1, RelOptInfo *rel2,
 		 * Construct restrictions applicable to the child join from those
 		 * applicable to the parent join.
 		 */
-		child_restrictlist =
-			(List *) adjust_appendrel_attrs(root,
-											(Node *) parent_restrictlist,
-											nappinfos, appinfos);
+		child_restrictlist = build_child_join_restrictlist(root,
+														   parent_restrictlist,
+														   nappinfos, appinfos);
 
 		/* Find or construct the child join's RelOptInfo */
 		child_joinrel = joinrel->part_rels[cnt_parts];
@@ -1632,6 +1653,118 @@ try_partitionwise_join(PlannerInfo *root, RelOptInfo *rel1, RelOptInfo *rel2,
 	}
 }
 
+/*
+ * build_child_join_restrictlist
+ *		Translate the restriction clauses of a parent join for a child join
+ *
+ * The same parent join is usually considered once for each of its join
+ * orders, and with many partitions, translating its restrictlist for every
+ * child join each time accounts for much of the planner's memory use.  So we
+ * remember the translated RestrictInfos in root->child_rinfo_hash and hand
+ * out the same ones again the next time.  Apart from saving memory, that
+ * also lets the child join reuse selectivity and cost estimates that were
+ * already cached in the RestrictInfo.
+ *
+ * A child RestrictInfo depends only on the parent RestrictInfo and on which
+ * of the relations it references get replaced by which children, so we key
+ * the cache on the parent RestrictInfo and its translated required_relids.
+ *
+ * New entries are only made when working in the planner's main memory
+ * context.  In GEQO's (and IDP's) short-lived contexts, the parent clauses
+ * themselves may go away when the context is reset, so there we only look up
+ * translations that were cached earlier.
+ */
+static List *
+build_child_join_restrictlist(PlannerInfo *root, List *parent_restrictlist,
+							  int nappinfos, AppendRelInfo **appinfos)
+{
+	bool		can_cache = (CurrentMemoryContext == root->planner_cxt);
+	List	   *result = NIL;
+	ListCell   *lc;
+
+	if (root->child_rinfo_hash == NULL && can_cache)
+	{
+		HASHCTL		hash_ctl;
+
+		hash_ctl.keysize = sizeof(ChildRinfoKey);
+		hash_ctl.entrysize = sizeof(ChildRinfoEntry);
+		hash_ctl.hash = child_rinfo_hash_fn;
+		hash_ctl.match = child_rinfo_match_fn;
+		hash_ctl.hcxt = root->planner_cxt;
+		root->child_rinfo_hash =
+			hash_create("ChildRestrictInfoHashTable",
+						256L,
+						&hash_ctl,
+						HASH_ELEM | HASH_FUNCTION | HASH_COMPARE | HASH_CONTEXT);
+	}
+
+	foreach(lc, parent_restrictlist)
+	{
+		RestrictInfo *rinfo = lfirst_node(RestrictInfo, lc);
+		RestrictInfo *child_rinfo;
+		ChildRinfoEntry *hentry = NULL;
+		ChildRinfoKey key;
+		bool		found = false;
+
+		key.parent_rinfo = rinfo;
+		key.child_relids = adjust_child_relids(rinfo->required_relids,
+											   nappinfos, appinfos);
+
+		if (root->child_rinfo_hash)
+			hentry = (ChildRinfoEntry *)
+				hash_search(root->child_rinfo_hash, &key,
+							can_cache ? HASH_ENTER : HASH_FIND,
+							&found);
+
+		if (found)
+		{
+			result = lappend(result, hentry->child_rinfo);
+			if (key.child_relids != rinfo->required_relids)
+				bms_free(key.child_relids);
+			continue;
+		}
+
+		child_rinfo = (RestrictInfo *)
+			adjust_appendrel_attrs(root, (Node *) rinfo, nappinfos, appinfos);
+		result = lappend(result, child_rinfo);
+
+		/* The entry keeps key.child_relids, if we made one */
+		if (hentry)
+			hentry->child_rinfo = child_rinfo;
+		else if (key.child_relids != rinfo->required_relids)
+			bms_free(key.child_relids);
+	}
+
+	return result;
+}
+
+/*
+ * Hash function and match function for root->child_rinfo_hash
+ */
+static uint32
+child_rinfo_hash_fn(const void *key, Size keysize)
+{
+	const ChildRinfoKey *k = (const ChildRinfoKey *) key;
+
+	Assert(keysize == sizeof(ChildRinfoKey));
+	return hash_combine(hash_bytes((const unsigned char *) &k->parent_rinfo,
+								   sizeof(RestrictInfo *)),
+						bms_hash_value(k->child_relids));
+}
+
+static int
+child_rinfo_match_fn(const void *key1, const void *key2, Size keysize)
+{
+	const ChildRinfoKey *k1 = (const ChildRinfoKey *) key1;
+	const ChildRinfoKey *k2 = (const ChildRinfoKey *) key2;
+
+	Assert(keysize == sizeof(ChildRinfoKey));
+	if (k1->parent_rinfo == k2->parent_rinfo &&
+		bms_equal(k1->child_relids, k2->child_relids))
+		return 0;
+	return 1;
+}
+
 /*
  * Construct the SpecialJoinInfo for a child-join by translating
  * SpecialJoinInfo for the join between parents. left_relids and right_relids
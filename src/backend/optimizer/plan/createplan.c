@@ -18,6 +18,7 @@
 
 #include <math.h>
 
+#include "access/htup_details.h"
 #include "access/sysattr.h"
 #include "catalog/pg_class.h"
 #include "foreign/fdwapi.h"
@@ -172,6 +173,9 @@ static Node *fix_indexqual_clause(PlannerInfo *root,
 								  Node *clause, List *indexcolnos);
 static Node *fix_indexqual_operand(Node *node, IndexOptInfo *index, int indexcol);
 static List *get_switched_clauses(List *clauses, Relids outerrelids);
+static List *get_nestloop_hashclauses(PlannerInfo *root, NestPath *best_path,
+									  List *joinrestrictclauses,
+									  Plan *inner_plan, List *nestParams);
 static List *order_qual_clauses(PlannerInfo *root, List *clauses);
 static void copy_generic_path_info(Plan *dest, Path *src);
 static void copy_plan_costsize(Plan *dest, Plan *src);
@@ -231,6 +235,8 @@ static BitmapAnd *make_bitmap_and(List *bitmapplans);
 static BitmapOr *make_bitmap_or(List *bitmapplans);
 static NestLoop *make_nestloop(List *tlist,
 							   List *joinclauses, List *otherclauses, List *nestParams,
+							   List *hashclauses, List *hashoperators,
+							   List *hashcollations,
 							   Plan *lefttree, Plan *righttree,
 							   JoinType jointype, bool inner_unique);
 static HashJoin *make_hashjoin(List *tlist,
@@ -4204,6 +4210,9 @@ create_nestloop_plan(PlannerInfo *root,
 	List	   *joinclauses;
 	List	   *otherclauses;
 	List	   *nestParams;
+	List	   *hashclauses;
+	List	   *hashoperators = NIL;
+	List	   *hashcollations = NIL;
 	List	   *outer_tlist;
 	bool		outer_parallel_safe;
 	Relids		saveOuterRels = root->curOuterRels;
@@ -4328,11 +4337,30 @@ create_nestloop_plan(PlannerInfo *root,
 		outer_plan = change_plan_targetlist(outer_plan, outer_tlist,
 											outer_parallel_safe);
 
+	/*
+	 * Find the join clauses that would allow the executor to switch to
+	 * hashing the inner plan, and collect their operators and collations.
+	 * These clauses remain part of joinclauses, too.
+	 */
+	hashclauses = get_nestloop_hashclauses(root, best_path,
+										   joinrestrictclauses,
+										   inner_plan, nestParams);
+	foreach(lc, hashclauses)
+	{
+		OpExpr	   *hclause = lfirst_node(OpExpr, lc);
+
+		hashoperators = lappend_oid(hashoperators, hclause->opno);
+		hashcollations = lappend_oid(hashcollations, hclause->inputcollid);
+	}
+
 	/* And finally, we can build the join plan node */
 	join_plan = make_nestloop(tlist,
 							  joinclauses,
 							  otherclauses,
 							  nestParams,
+							  hashclauses,
+							  hashoperators,
+							  hashcollations,
 							  outer_plan,
 							  inner_plan,
 							  best_path->jpath.jointype,
@@ -5178,6 +5206,80 @@ fix_indexqual_operand(Node *node, IndexOptInfo *index, int indexcol)
 	return NULL;				/* keep compiler quiet */
 }
 
+/*
+ * get_nestloop_hashclauses
+ *	  Identify the join clauses of a nestloop join that the executor could
+ *	  use to hash the inner plan, if the outer plan returns many more rows
+ *	  than estimated.  The result is a list of plain OpExprs with the outer
+ *	  argument on the left, or NIL if switching to hashing isn't possible.
+ *
+ * The inner plan must not depend on the outer one, and it must be expected
+ * to fit in hash_mem; the executor checks the latter again at run time.
+ */
+static List *
+get_nestloop_hashclauses(PlannerInfo *root, NestPath *best_path,
+						 List *joinrestrictclauses, Plan *inner_plan,
+						 List *nestParams)
+{
+	Relids		outerrelids = best_path->jpath.outerjoinpath->parent->relids;
+	Relids		innerrelids = best_path->jpath.innerjoinpath->parent->relids;
+	Relids		joinrelids = best_path->jpath.path.parent->relids;
+	List	   *hashrinfos = NIL;
+	double		inner_bytes;
+	ListCell   *lc;
+
+	if (!enable_adaptive_nestloop)
+		return NIL;
+
+	/*
+	 * If the inner plan takes parameters from the outer one, or the join
+	 * itself is parameterized and thus likely to be rescanned with new
+	 * parameter values, a hashed copy of the inner plan's output wouldn't
+	 * stay valid for long enough to be useful.
+	 */
+	if (nestParams != NIL || best_path->jpath.path.param_info != NULL)
+		return NIL;
+
+	inner_bytes = inner_plan->plan_rows *
+		(MAXALIGN(inner_plan->plan_width) + MAXALIGN(SizeofMinimalTupleHeader));
+	if (inner_bytes > get_hash_memory_limit())
+		return NIL;
+
+	foreach(lc, joinrestrictclauses)
+	{
+		RestrictInfo *rinfo = lfirst_node(RestrictInfo, lc);
+		Oid			left_hashfn;
+		Oid			right_hashfn;
+
+		if (rinfo->pseudoconstant ||
+			!rinfo->can_join ||
+			!OidIsValid(rinfo->hashjoinoperator))
+			continue;
+
+		/* In an outer join, only the join's own clauses can be used */
+		if (IS_OUTER_JOIN(best_path->jpath.jointype) &&
+			RINFO_IS_PUSHED_DOWN(rinfo, joinrelids))
+			continue;
+
+		/* Each side of the clause must come from one input */
+		if (!(bms_is_subset(rinfo->left_relids, outerrelids) &&
+			  bms_is_subset(rinfo->right_relids, innerrelids)) &&
+			!(bms_is_subset(rinfo->left_relids, innerrelids) &&
+			  bms_is_subset(rinfo->right_relids, outerrelids)))
+			continue;
+
+		/* The executor's hash table doesn't support cross-type hashing */
+		if (!get_op_hash_functions(rinfo->hashjoinoperator,
+								   &left_hashfn, &right_hashfn) ||
+			left_hashfn != right_hashfn)
+			continue;
+
+		hashrinfos = lappend(hashrinfos, rinfo);
+	}
+
+	return get_switched_clauses(hashrinfos, outerrelids);
+}
+
 /*
  * get_switched_clauses
  *	  Given a list of merge or hash joinclauses (as RestrictInfo nodes),
@@ -5932,6 +6034,9 @@ make_nestloop(List *tlist,
 			  List *joinclauses,
 			  List *otherclauses,
 			  List *nestParams,
+			  List *hashclauses,
+			  List *hashoperators,
+			  List *hashcollations,
 			  Plan *lefttree,
 			  Plan *righttree,
 			  JoinType jointype,
@@ -5948,6 +6053,9 @@ make_nestloop(List *tlist,
 	node->join.inner_unique = inner_unique;
 	node->join.joinqual = joinclauses;
 	node->nestParams = nestParams;
+	node->hashclauses = hashclauses;
+	node->hashoperators = hashoperators;
+	node->hashcollations = hashcollations;
 
 	return node;
 }
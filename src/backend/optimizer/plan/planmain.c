@@ -66,6 +66,7 @@ query_planner(PlannerInfo *root,
 	 */
 	root->join_rel_list = NIL;
 	root->join_rel_hash = NULL;
+	root->child_rinfo_hash = NULL;
 	root->join_rel_level = NULL;
 	root->join_cur_level = 0;
 	root->canon_pathkeys = NIL;
@@ -19,6 +19,7 @@
 #include <math.h>
 
 #include "access/genam.h"
+#include "access/nbtree.h"
 #include "access/parallel.h"
 #include "access/sysattr.h"
 #include "access/table.h"
@@ -63,6 +64,7 @@
 #include "utils/lsyscache.h"
 #include "utils/rel.h"
 #include "utils/selfuncs.h"
+#include "utils/typcache.h"
 
 /* GUC parameters */
 double		cursor_tuple_fraction = DEFAULT_CURSOR_TUPLE_FRACTION;
@@ -240,6 +242,16 @@ static RelOptInfo *create_partial_grouping_paths(PlannerInfo *root,
 												 grouping_sets_data *gd,
 												 GroupPathExtraData *extra,
 												 bool force_rel_creation);
+static void add_eager_aggregation_paths(PlannerInfo *root,
+										RelOptInfo *input_rel,
+										RelOptInfo *partially_grouped_rel,
+										GroupPathExtraData *extra);
+static void try_eager_aggregation(PlannerInfo *root, RelOptInfo *input_rel,
+								  RelOptInfo *agg_rel, RelOptInfo *other_rel,
+								  RelOptInfo *partially_grouped_rel,
+								  GroupPathExtraData *extra);
+static bool eager_group_key_is_equalimage(TypeCacheEntry *typentry,
+										  Oid collation);
 static Path *make_ordered_path(PlannerInfo *root,
 							   RelOptInfo *rel,
 							   Path *path,
@@ -4014,6 +4026,7 @@ create_ordinary_grouping_paths(PlannerInfo *root, RelOptInfo *input_rel,
 	RelOptInfo *partially_grouped_rel = NULL;
 	double		dNumGroups;
 	PartitionwiseAggregateType patype = PARTITIONWISE_AGGREGATE_NONE;
+	bool		try_eager_agg;
 
 	/*
 	 * If this is the topmost grouping relation or if the parent relation is
@@ -4047,6 +4060,17 @@ create_ordinary_grouping_paths(PlannerInfo *root, RelOptInfo *input_rel,
 			patype = PARTITIONWISE_AGGREGATE_NONE;
 	}
 
+	/*
+	 * If the input is a join of two relations, we may be able to do the
+	 * partial aggregation below the join.  See add_eager_aggregation_paths.
+	 */
+	try_eager_agg = (enable_eager_aggregate &&
+					 (extra->flags & GROUPING_CAN_PARTIAL_AGG) != 0 &&
+					 root->parse->hasAggs &&
+					 root->parse->groupingSets == NIL &&
+					 input_rel->reloptkind == RELOPT_JOINREL &&
+					 bms_num_members(input_rel->relids) == 2);
+
 	/*
 	 * Before generating paths for grouped_rel, we first generate any possible
 	 * partially grouped paths; that way, later code can easily consider both
@@ -4057,11 +4081,12 @@ create_ordinary_grouping_paths(PlannerInfo *root, RelOptInfo *input_rel,
 		bool		force_rel_creation;
 
 		/*
-		 * If we're doing partitionwise aggregation at this level, force
-		 * creation of a partially_grouped_rel so we can add partitionwise
-		 * paths to it.
+		 * If we're doing partitionwise aggregation or eager aggregation at
+		 * this level, force creation of a partially_grouped_rel so we can add
+		 * those paths to it.
 		 */
-		force_rel_creation = (patype == PARTITIONWISE_AGGREGATE_PARTIAL);
+		force_rel_creation = (patype == PARTITIONWISE_AGGREGATE_PARTIAL ||
+							  try_eager_agg);
 
 		partially_grouped_rel =
 			create_partial_grouping_paths(root,
@@ -4081,6 +4106,15 @@ create_ordinary_grouping_paths(PlannerInfo *root, RelOptInfo *input_rel,
 											partially_grouped_rel, agg_costs,
 											gd, patype, extra);
 
+	/* Consider partially aggregating one side of the join. */
+	if (try_eager_agg)
+	{
+		add_eager_aggregation_paths(root, input_rel, partially_grouped_rel,
+									extra);
+		if (partially_grouped_rel->pathlist)
+			set_cheapest(partially_grouped_rel);
+	}
+
 	/* If we are doing partial aggregation only, return. */
 	if (extra->patype == PARTITIONWISE_AGGREGATE_PARTIAL)
 	{
@@ -7575,6 +7609,288 @@ create_partial_grouping_paths(PlannerInfo *root,
 	return partially_grouped_rel;
 }
 
+/*
+ * add_eager_aggregation_paths
+ *
+ * Add paths to partially_grouped_rel that perform the partial aggregation
+ * below the join, rather than on top of it.  For example, in
+ *
+ *		SELECT d.name, sum(f.amount) FROM fact f JOIN dim d ON f.dim_id = d.id
+ *		GROUP BY d.name
+ *
+ * we can partially aggregate the rows of "fact" grouped by dim_id, join the
+ * result to "dim", and finalize the aggregation grouped by d.name.  If there
+ * are many fact rows per dim_id, this greatly reduces the number of rows that
+ * go through the join.  The caller considers finalizing these paths just like
+ * any other partially aggregated path, so whether to aggregate eagerly is
+ * decided on cost.
+ *
+ * Currently we only handle inner joins of two base relations, with no
+ * placeholders or lateral references involved.
+ */
+static void
+add_eager_aggregation_paths(PlannerInfo *root, RelOptInfo *input_rel,
+							RelOptInfo *partially_grouped_rel,
+							GroupPathExtraData *extra)
+{
+	RelOptInfo *rel1;
+	RelOptInfo *rel2;
+	int			relid1;
+	int			relid2;
+
+	Assert(input_rel->reloptkind == RELOPT_JOINREL);
+	Assert(bms_num_members(input_rel->relids) == 2);
+
+	if (root->join_info_list != NIL ||
+		root->placeholder_list != NIL ||
+		root->hasLateralRTEs)
+		return;
+
+	relid1 = bms_next_member(input_rel->relids, -1);
+	relid2 = bms_next_member(input_rel->relids, relid1);
+	rel1 = find_base_rel(root, relid1);
+	rel2 = find_base_rel(root, relid2);
+
+	try_eager_aggregation(root, input_rel, rel1, rel2,
+						  partially_grouped_rel, extra);
+	try_eager_aggregation(root, input_rel, rel2, rel1,
+						  partially_grouped_rel, extra);
+}
+
+/*
+ * try_eager_aggregation
+ *
+ * Try to build a path that partially aggregates agg_rel, joins the result to
+ * other_rel and emits the partially grouped target, and add it to
+ * partially_grouped_rel.
+ *
+ * This requires all of the aggregates to depend on agg_rel only.  The rows
+ * of agg_rel are grouped by all of its columns that are needed above the
+ * join, including the ones used in the join clauses, so each partial group
+ * stands for rows that join to exactly the same rows of other_rel and end up
+ * in the same final group.  Combining the partial aggregates of all the
+ * joined rows therefore gives the same result as aggregating the joined
+ * rows of agg_rel.  Since the values of a partial group's columns are taken
+ * from one of its rows, we insist that the grouping equality implies image
+ * equality, so that it doesn't matter which one.
+ */
+static void
+try_eager_aggregation(PlannerInfo *root, RelOptInfo *input_rel,
+					  RelOptInfo *agg_rel, RelOptInfo *other_rel,
+					  RelOptInfo *partially_grouped_rel,
+					  GroupPathExtraData *extra)
+{
+	PathTarget *partial_target = partially_grouped_rel->reltarget;
+	List	   *aggrefs = NIL;
+	List	   *group_vars = NIL;
+	List	   *groupClause = NIL;
+	List	   *restrictlist;
+	SpecialJoinInfo sjinfo;
+	PathTarget *input_target;
+	PathTarget *agg_target;
+	PathTarget *join_target;
+	RelOptInfo *grouped_rel;
+	RelOptInfo *joinrel;
+	Path	   *path;
+	double		dNumGroups;
+	ListCell   *lc;
+	Index		sortgroupref;
+
+	/*
+	 * Collect the aggregates, which must be computable from agg_rel alone,
+	 * and the Vars of agg_rel that are needed above the aggregation.
+	 */
+	foreach(lc, partial_target->exprs)
+	{
+		Node	   *expr = (Node *) lfirst(lc);
+
+		if (IsA(expr, Aggref))
+		{
+			if (!bms_is_subset(pull_varnos(root, expr), agg_rel->relids))
+				return;
+			aggrefs = lappend(aggrefs, expr);
+		}
+		else
+		{
+			ListCell   *lc2;
+
+			foreach(lc2, pull_var_clause(expr, 0))
+			{
+				Var		   *var = lfirst_node(Var, lc2);
+
+				if (var->varno == agg_rel->relid)
+					group_vars = list_append_unique(group_vars, var);
+			}
+		}
+	}
+
+	/*
+	 * Likewise the Vars of agg_rel needed to evaluate the join clauses.  We
+	 * build the join rel for the partially aggregated rows now to get them.
+	 */
+	init_dummy_sjinfo(&sjinfo, agg_rel->relids, other_rel->relids);
+	joinrel = build_grouped_join_rel(root, input_rel->relids,
+									 agg_rel, other_rel,
+									 &sjinfo, &restrictlist);
+	foreach(lc, restrictlist)
+	{
+		RestrictInfo *rinfo = lfirst_node(RestrictInfo, lc);
+		ListCell   *lc2;
+
+		foreach(lc2, pull_var_clause((Node *) rinfo->clause, 0))
+		{
+			Var		   *var = lfirst_node(Var, lc2);
+
+			if (var->varno == agg_rel->relid)
+				group_vars = list_append_unique(group_vars, var);
+		}
+	}
+
+	if (group_vars == NIL)
+		return;
+
+	/*
+	 * Build the grouping clauses.  The partial aggregation is always done by
+	 * hashing, so the columns must be hashable.
+	 */
+	sortgroupref = 0;
+	foreach(lc, group_vars)
+	{
+		Var		   *var = lfirst_node(Var, lc);
+		TypeCacheEntry *typentry;
+		SortGroupClause *sgc;
+
+		typentry = lookup_type_cache(var->vartype,
+									 TYPECACHE_EQ_OPR | TYPECACHE_LT_OPR |
+									 TYPECACHE_HASH_PROC |
+									 TYPECACHE_BTREE_OPFAMILY);
+		if (!OidIsValid(typentry->eq_opr) ||
+			!OidIsValid(typentry->hash_proc) ||
+			!eager_group_key_is_equalimage(typentry, var->varcollid))
+			return;
+
+		sgc = makeNode(SortGroupClause);
+		sgc->tleSortGroupRef = ++sortgroupref;
+		sgc->eqop = typentry->eq_opr;
+		sgc->sortop = typentry->lt_opr;
+		sgc->reverse_sort = false;
+		sgc->nulls_first = false;
+		sgc->hashable = true;
+		groupClause = lappend(groupClause, sgc);
+	}
+
+	/* Not worth it if it doesn't reduce the number of rows at all */
+	dNumGroups = estimate_num_groups(root, group_vars, agg_rel->rows,
+									 NULL, NULL);
+	if (dNumGroups >= agg_rel->rows)
+		return;
+
+	/* Label the grouping columns in the input to the partial aggregation */
+	input_target = copy_pathtarget(agg_rel->reltarget);
+	input_target->sortgrouprefs = (Index *)
+		palloc0(list_length(input_target->exprs) * sizeof(Index));
+	sortgroupref = 0;
+	foreach(lc, group_vars)
+	{
+		int			i = 0;
+		ListCell   *lc2;
+
+		sortgroupref++;
+		foreach(lc2, input_target->exprs)
+		{
+			if (equal(lfirst(lc2), lfirst(lc)))
+				break;
+			i++;
+		}
+		if (lc2 == NULL)
+			return;				/* shouldn't happen */
+		input_target->sortgrouprefs[i] = sortgroupref;
+	}
+
+	/* The partial aggregation emits the grouping columns and the aggregates */
+	agg_target = create_empty_pathtarget();
+	sortgroupref = 0;
+	foreach(lc, group_vars)
+		add_column_to_pathtarget(agg_target, (Expr *) lfirst(lc),
+								 ++sortgroupref);
+	foreach(lc, aggrefs)
+		add_column_to_pathtarget(agg_target, (Expr *) lfirst(lc), 0);
+	set_pathtarget_cost_width(root, agg_target);
+
+	/* The partially aggregated rows of agg_rel get an upper rel of their own */
+	grouped_rel = build_upper_rel(root, agg_rel->relids);
+	grouped_rel->rows = dNumGroups;
+	grouped_rel->reltarget = agg_target;
+
+	path = (Path *) create_projection_path(root, agg_rel,
+										   agg_rel->cheapest_total_path,
+										   input_target);
+	path = (Path *) create_agg_path(root,
+									grouped_rel,
+									path,
+									agg_target,
+									AGG_HASHED,
+									AGGSPLIT_INITIAL_SERIAL,
+									groupClause,
+									NIL,
+									&extra->agg_partial_costs,
+									dNumGroups);
+	add_path(grouped_rel, path);
+	set_cheapest(grouped_rel);
+
+	/*
+	 * Now join the partially aggregated rows to other_rel.  The join rel has
+	 * no FDW, and since one side of the join is an upper rel,
+	 * add_paths_to_joinrel() doesn't offer it to set_join_pathlist_hook
+	 * either.
+	 */
+	join_target = joinrel->reltarget;
+	foreach(lc, other_rel->reltarget->exprs)
+		add_column_to_pathtarget(join_target, (Expr *) lfirst(lc), 0);
+	foreach(lc, agg_target->exprs)
+		add_column_to_pathtarget(join_target, (Expr *) lfirst(lc), 0);
+	set_pathtarget_cost_width(root, join_target);
+
+	set_joinrel_size_estimates(root, joinrel, grouped_rel, other_rel,
+							   &sjinfo, restrictlist);
+	add_paths_to_joinrel(root, joinrel, grouped_rel, other_rel,
+						 JOIN_INNER, &sjinfo, restrictlist);
+	add_paths_to_joinrel(root, joinrel, other_rel, grouped_rel,
+						 JOIN_INNER, &sjinfo, restrictlist);
+	if (joinrel->pathlist == NIL)
+		return;
+	set_cheapest(joinrel);
+
+	/* Finally, compute the partially grouped target on top of the join */
+	path = (Path *) create_projection_path(root, partially_grouped_rel,
+										   joinrel->cheapest_total_path,
+										   partial_target);
+	add_path(partially_grouped_rel, path);
+}
+
+/*
+ * eager_group_key_is_equalimage
+ *		Does the type's default equality imply that the values are identical?
+ */
+static bool
+eager_group_key_is_equalimage(TypeCacheEntry *typentry, Oid collation)
+{
+	Oid			proc;
+
+	if (!OidIsValid(typentry->btree_opf))
+		return false;
+
+	proc = get_opfamily_proc(typentry->btree_opf,
+							 typentry->btree_opintype,
+							 typentry->btree_opintype,
+							 BTEQUALIMAGE_PROC);
+	if (!OidIsValid(proc))
+		return false;
+
+	return DatumGetBool(OidFunctionCall1Coll(proc, collation,
+											 ObjectIdGetDatum(typentry->btree_opintype)));
+}
+
 /*
  * make_ordered_path
  *		Return a path ordered by 'pathkeys' based on the given 'path'.  May
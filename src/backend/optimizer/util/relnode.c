@@ -65,6 +65,8 @@ static List *subbuild_joinrel_joinlist(RelOptInfo *joinrel,
 static void set_foreign_rel_properties(RelOptInfo *joinrel,
 									   RelOptInfo *outer_rel, RelOptInfo *inner_rel);
 static void add_join_rel(PlannerInfo *root, RelOptInfo *joinrel);
+static RelOptInfo *init_join_rel(PlannerInfo *root, Relids joinrelids,
+								 RelOptInfo *outer_rel, RelOptInfo *inner_rel);
 static void build_joinrel_partition_info(PlannerInfo *root,
 										 RelOptInfo *joinrel,
 										 RelOptInfo *outer_rel, RelOptInfo *inner_rel,
@@ -647,60 +649,18 @@ add_join_rel(PlannerInfo *root, RelOptInfo *joinrel)
 }
 
 /*
- * build_join_rel
- *	  Returns relation entry corresponding to the union of two given rels,
- *	  creating a new relation entry if none already exists.
- *
- * 'joinrelids' is the Relids set that uniquely identifies the join
- * 'outer_rel' and 'inner_rel' are relation nodes for the relations to be
- *		joined
- * 'sjinfo': join context info
- * 'pushed_down_joins': any pushed-down outer joins that are now completed
- * 'restrictlist_ptr': result variable.  If not NULL, *restrictlist_ptr
- *		receives the list of RestrictInfo nodes that apply to this
- *		particular pair of joinable relations.
+ * init_join_rel
+ *	  Create a RelOptInfo for a join of the given relations, with its fields
+ *	  initialized to the values that don't depend on the join clauses.
  *
- * restrictlist_ptr makes the routine's API a little grotty, but it saves
- * duplicated calculation of the restrictlist...
+ * The caller must fill in the target list, the sizes and the rest.
  */
-RelOptInfo *
-build_join_rel(PlannerInfo *root,
-			   Relids joinrelids,
-			   RelOptInfo *outer_rel,
-			   RelOptInfo *inner_rel,
-			   SpecialJoinInfo *sjinfo,
-			   List *pushed_down_joins,
-			   List **restrictlist_ptr)
+static RelOptInfo *
+init_join_rel(PlannerInfo *root, Relids joinrelids,
+			  RelOptInfo *outer_rel, RelOptInfo *inner_rel)
 {
 	RelOptInfo *joinrel;
-	List	   *restrictlist;
-
-	/* This function should be used only for join between parents. */
-	Assert(!IS_OTHER_REL(outer_rel) && !IS_OTHER_REL(inner_rel));
-
-	/*
-	 * See if we already have a joinrel for this set of base rels.
-	 */
-	joinrel = find_join_rel(root, joinrelids);
-
-	if (joinrel)
-	{
-		/*
-		 * Yes, so we only need to figure the restrictlist for this particular
-		 * pair of component relations.
-		 */
-		if (restrictlist_ptr)
-			*restrictlist_ptr = build_joinrel_restrictlist(root,
-														   joinrel,
-														   outer_rel,
-														   inner_rel,
-														   sjinfo);
-		return joinrel;
-	}
 
-	/*
-	 * Nope, so make one.
-	 */
 	joinrel = makeNode(RelOptInfo);
 	joinrel->reloptkind = RELOPT_JOINREL;
 	joinrel->relids = bms_copy(joinrelids);
@@ -716,7 +676,7 @@ build_join_rel(PlannerInfo *root,
 	joinrel->cheapest_startup_path = NULL;
 	joinrel->cheapest_total_path = NULL;
 	joinrel->cheapest_parameterized_paths = NIL;
-	/* init direct_lateral_relids from children; we'll finish it up below */
+	/* init direct_lateral_relids from children; the caller finishes it */
 	joinrel->direct_lateral_relids =
 		bms_union(outer_rel->direct_lateral_relids,
 				  inner_rel->direct_lateral_relids);
@@ -773,6 +733,66 @@ build_join_rel(PlannerInfo *root,
 	joinrel->partexprs = NULL;
 	joinrel->nullable_partexprs = NULL;
 
+	return joinrel;
+}
+
+/*
+ * build_join_rel
+ *	  Returns relation entry corresponding to the union of two given rels,
+ *	  creating a new relation entry if none already exists.
+ *
+ * 'joinrelids' is the Relids set that uniquely identifies the join
+ * 'outer_rel' and 'inner_rel' are relation nodes for the relations to be
+ *		joined
+ * 'sjinfo': join context info
+ * 'pushed_down_joins': any pushed-down outer joins that are now completed
+ * 'restrictlist_ptr': result variable.  If not NULL, *restrictlist_ptr
+ *		receives the list of RestrictInfo nodes that apply to this
+ *		particular pair of joinable relations.
+ *
+ * restrictlist_ptr makes the routine's API a little grotty, but it saves
+ * duplicated calculation of the restrictlist...
+ */
+RelOptInfo *
+build_join_rel(PlannerInfo *root,
+			   Relids joinrelids,
+			   RelOptInfo *outer_rel,
+			   RelOptInfo *inner_rel,
+			   SpecialJoinInfo *sjinfo,
+			   List *pushed_down_joins,
+			   List **restrictlist_ptr)
+{
+	RelOptInfo *joinrel;
+	List	   *restrictlist;
+
+	/* This function should be used only for join between parents. */
+	Assert(!IS_OTHER_REL(outer_rel) && !IS_OTHER_REL(inner_rel));
+
+	/*
+	 * See if we already have a joinrel for this set of base rels.
+	 */
+	joinrel = find_join_rel(root, joinrelids);
+
+	if (joinrel)
+	{
+		/*
+		 * Yes, so we only need to figure the restrictlist for this particular
+		 * pair of component relations.
+		 */
+		if (restrictlist_ptr)
+			*restrictlist_ptr = build_joinrel_restrictlist(root,
+														   joinrel,
+														   outer_rel,
+														   inner_rel,
+														   sjinfo);
+		return joinrel;
+	}
+
+	/*
+	 * Nope, so make one.
+	 */
+	joinrel = init_join_rel(root, joinrelids, outer_rel, inner_rel);
+
 	/* Compute information relevant to the foreign relations. */
 	set_foreign_rel_properties(joinrel, outer_rel, inner_rel);
 
@@ -868,6 +888,48 @@ build_join_rel(PlannerInfo *root,
 	return joinrel;
 }
 
+/*
+ * build_grouped_join_rel
+ *	  Builds a RelOptInfo for joining the partially aggregated rows of
+ *	  'agg_rel' to 'other_rel', for eager aggregation.
+ *
+ * The join is between the same base relations as the ordinary join rel for
+ * their union, but it produces different rows, so it can't share that rel's
+ * paths.  The new rel is therefore not entered into the join rel list or
+ * hash, and the caller must add its paths itself.  Its join clauses are the
+ * same, and are computed from the base relations, since the rel of the
+ * aggregated rows has none of its own; *restrictlist_ptr receives them.
+ *
+ * The caller fills in the target list and sets the size estimates.  The rel
+ * gets no FDW and no partitioning information, so it's not considered for
+ * foreign or partitionwise joins.
+ */
+RelOptInfo *
+build_grouped_join_rel(PlannerInfo *root,
+					   Relids joinrelids,
+					   RelOptInfo *agg_rel,
+					   RelOptInfo *other_rel,
+					   SpecialJoinInfo *sjinfo,
+					   List **restrictlist_ptr)
+{
+	RelOptInfo *joinrel;
+
+	Assert(IS_SIMPLE_REL(agg_rel) && IS_SIMPLE_REL(other_rel));
+	Assert(sjinfo->jointype == JOIN_INNER);
+
+	joinrel = init_join_rel(root, joinrelids, agg_rel, other_rel);
+	joinrel->direct_lateral_relids =
+		bms_del_members(joinrel->direct_lateral_relids, joinrel->relids);
+
+	*restrictlist_ptr = build_joinrel_restrictlist(root, joinrel,
+												   agg_rel, other_rel,
+												   sjinfo);
+	build_joinrel_joinlist(joinrel, agg_rel, other_rel);
+	joinrel->has_eclass_joins = has_relevant_eclass_joinclause(root, joinrel);
+
+	return joinrel;
+}
+
 /*
  * build_child_join_rel
  *	  Builds RelOptInfo representing join between given two child relations.
@@ -1482,6 +1544,26 @@ fetch_upper_rel(PlannerInfo *root, UpperRelationKind kind, Relids relids)
 			return upperrel;
 	}
 
+	upperrel = build_upper_rel(root, relids);
+
+	root->upper_rels[kind] = lappend(root->upper_rels[kind], upperrel);
+
+	return upperrel;
+}
+
+/*
+ * build_upper_rel
+ *		Build an upper relation that is not remembered in the PlannerInfo.
+ *
+ * This is the constructor behind fetch_upper_rel(), for callers that need an
+ * upper relation of their own, such as eager aggregation, which builds one
+ * for the partially aggregated rows of each base relation it tries.
+ */
+RelOptInfo *
+build_upper_rel(PlannerInfo *root, Relids relids)
+{
+	RelOptInfo *upperrel;
+
 	upperrel = makeNode(RelOptInfo);
 	upperrel->reloptkind = RELOPT_UPPER_REL;
 	upperrel->relids = bms_copy(relids);
@@ -1496,8 +1578,6 @@ fetch_upper_rel(PlannerInfo *root, UpperRelationKind kind, Relids relids)
 	upperrel->cheapest_total_path = NULL;
 	upperrel->cheapest_parameterized_paths = NIL;
 
-	root->upper_rels[kind] = lappend(root->upper_rels[kind], upperrel);
-
 	return upperrel;
 }
 
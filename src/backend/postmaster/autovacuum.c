@@ -271,6 +271,32 @@ typedef struct AutoVacuumWorkItem
 
 #define NUM_WORKITEMS	256
 
+/* Work items for a single heap page, requested from DML */
+#define AVW_IS_HEAP_PAGE(type) \
+	((type) == AVW_HeapPrunePage || (type) == AVW_HeapFreezePage)
+#define AVW_HEAP_PAGE_INDEX(type) ((type) == AVW_HeapPrunePage ? 0 : 1)
+
+/* Maximum number of work items of each heap page type */
+#define MAX_HEAP_PAGE_WORKITEMS	(NUM_WORKITEMS / 4)
+
+/*
+ * The heap page work items this backend queued most recently, so that it can
+ * tell that a page is still queued without taking AutovacuumLock.  An entry
+ * is only valid as long as av_heapPageItemsTaken hasn't changed since.
+ */
+typedef struct RecentHeapPageRequest
+{
+	AutoVacuumWorkItemType type;
+	Oid			relation;
+	BlockNumber blkno;
+	uint32		taken;
+} RecentHeapPageRequest;
+
+#define NUM_RECENT_HEAP_PAGE_REQUESTS	8
+
+static RecentHeapPageRequest recent_heap_page_requests[NUM_RECENT_HEAP_PAGE_REQUESTS];
+static int	next_recent_heap_page_request = 0;
+
 /*-------------
  * The main autovacuum shmem struct.  On shared memory we store this main
  * struct and the array of WorkerInfo structs.  This struct keeps:
@@ -284,9 +310,13 @@ typedef struct AutoVacuumWorkItem
  * av_workItems		work item array
  * av_nworkersForBalance the number of autovacuum workers to use when
  * 					calculating the per worker cost limit
+ * av_nHeapPageItems	number of used work items of each heap page type
+ * av_heapPageItemsTaken number of heap page work items claimed by workers so
+ *					far
  *
  * This struct is protected by AutovacuumLock, except for av_signal and parts
- * of the worker list (see above).
+ * of the worker list (see above).  The heap page work item counters are only
+ * changed while holding AutovacuumLock, but may be read without it.
  *-------------
  */
 typedef struct
@@ -298,6 +328,8 @@ typedef struct
 	WorkerInfo	av_startingWorker;
 	AutoVacuumWorkItem av_workItems[NUM_WORKITEMS];
 	pg_atomic_uint32 av_nworkersForBalance;
+	pg_atomic_uint32 av_nHeapPageItems[2];
+	pg_atomic_uint32 av_heapPageItemsTaken;
 } AutoVacuumShmemStruct;
 
 static AutoVacuumShmemStruct *AutoVacuumShmem;
@@ -356,6 +388,9 @@ static void autovacuum_do_vac_analyze(autovac_table *tab,
 									  BufferAccessStrategy bstrategy);
 static AutoVacOpts *extract_autovac_opts(HeapTuple tup,
 										 TupleDesc pg_class_desc);
+static void release_orphaned_heap_page_items(List *dblist);
+static void remember_heap_page_request(AutoVacuumWorkItemType type, Oid relationId,
+									   BlockNumber blkno, uint32 taken);
 static void perform_work_item(AutoVacuumWorkItem *workitem);
 static void autovac_report_activity(autovac_table *tab);
 static void autovac_report_workitem(AutoVacuumWorkItem *workitem,
@@ -1136,6 +1171,9 @@ do_start_worker(void)
 	/* Get a list of databases */
 	dblist = get_database_list();
 
+	/* Forget heap page work items for databases that no longer exist */
+	release_orphaned_heap_page_items(dblist);
+
 	/*
 	 * Determine the oldest datfrozenxid/relfrozenxid that we will allow to
 	 * pass without forcing a vacuum.  (This limit can be tightened for
@@ -2553,6 +2591,8 @@ deleted:
 
 		/* claim this one, and release lock while performing it */
 		workitem->avw_active = true;
+		if (AVW_IS_HEAP_PAGE(workitem->avw_type))
+			pg_atomic_fetch_add_u32(&AutoVacuumShmem->av_heapPageItemsTaken, 1);
 		LWLockRelease(AutovacuumLock);
 
 		perform_work_item(workitem);
@@ -2571,6 +2611,9 @@ deleted:
 		LWLockAcquire(AutovacuumLock, LW_EXCLUSIVE);
 
 		/* and mark it done */
+		if (AVW_IS_HEAP_PAGE(workitem->avw_type))
+			pg_atomic_fetch_sub_u32(&AutoVacuumShmem->av_nHeapPageItems[AVW_HEAP_PAGE_INDEX(workitem->avw_type)],
+									1);
 		workitem->avw_active = false;
 		workitem->avw_used = false;
 	}
@@ -2673,6 +2716,14 @@ perform_work_item(AutoVacuumWorkItem *workitem)
 									ObjectIdGetDatum(workitem->avw_relation),
 									Int64GetDatum((int64) workitem->avw_blockNumber));
 				break;
+			case AVW_HeapPrunePage:
+				heap_page_prune_deferred(workitem->avw_relation,
+										 workitem->avw_blockNumber);
+				break;
+			case AVW_HeapFreezePage:
+				heap_page_freeze_deferred(workitem->avw_relation,
+										  workitem->avw_blockNumber);
+				break;
 			default:
 				elog(WARNING, "unrecognized work item found: type %d",
 					 workitem->avw_type);
@@ -3278,6 +3329,14 @@ autovac_report_workitem(AutoVacuumWorkItem *workitem,
 			snprintf(activity, MAX_AUTOVAC_ACTIV_LEN,
 					 "autovacuum: BRIN summarize");
 			break;
+		case AVW_HeapPrunePage:
+			snprintf(activity, MAX_AUTOVAC_ACTIV_LEN,
+					 "autovacuum: prune page");
+			break;
+		case AVW_HeapFreezePage:
+			snprintf(activity, MAX_AUTOVAC_ACTIV_LEN,
+					 "autovacuum: freeze page");
+			break;
 	}
 
 	/*
@@ -3315,43 +3374,181 @@ AutoVacuumingActive(void)
 /*
  * Request one work item to the next autovacuum run processing our database.
  * Return false if the request can't be recorded.
+ *
+ * Page pruning and freezing requests are made much more often than others,
+ * so we don't let either kind take more than a quarter of the work items,
+ * which leaves room for the other kind and for everything else, and a page
+ * that is already queued isn't queued again (which counts as success).  They
+ * can come from every page access, so we first check without the lock
+ * whether the cap has been reached or whether we queued the same page
+ * ourselves recently, and it hasn't been taken by a worker yet.
  */
 bool
 AutoVacuumRequestWork(AutoVacuumWorkItemType type, Oid relationId,
 					  BlockNumber blkno)
 {
+	AutoVacuumWorkItem *freeitem = NULL;
+	int			npages = 0;
 	int			i;
 	bool		result = false;
+	uint32		taken = 0;
+
+	if (AVW_IS_HEAP_PAGE(type))
+	{
+		/* must read this before looking at the work items, see above */
+		taken = pg_atomic_read_u32(&AutoVacuumShmem->av_heapPageItemsTaken);
+		pg_read_barrier();
+
+		for (i = 0; i < NUM_RECENT_HEAP_PAGE_REQUESTS; i++)
+		{
+			RecentHeapPageRequest *recent = &recent_heap_page_requests[i];
+
+			if (recent->taken == taken &&
+				recent->type == type &&
+				recent->relation == relationId &&
+				recent->blkno == blkno)
+				return true;
+		}
+
+		if (pg_atomic_read_u32(&AutoVacuumShmem->av_nHeapPageItems[AVW_HEAP_PAGE_INDEX(type)]) >=
+			MAX_HEAP_PAGE_WORKITEMS)
+			return false;
+	}
 
 	LWLockAcquire(AutovacuumLock, LW_EXCLUSIVE);
 
 	/*
-	 * Locate an unused work item and fill it with the given data.
+	 * Locate an unused work item.
 	 */
 	for (i = 0; i < NUM_WORKITEMS; i++)
 	{
 		AutoVacuumWorkItem *workitem = &AutoVacuumShmem->av_workItems[i];
 
-		if (workitem->avw_used)
+		if (!workitem->avw_used)
+		{
+			if (freeitem == NULL)
+				freeitem = workitem;
+
+			/* only heap page requests need to look at the rest */
+			if (!AVW_IS_HEAP_PAGE(type))
+				break;
 			continue;
+		}
 
-		workitem->avw_used = true;
-		workitem->avw_active = false;
-		workitem->avw_type = type;
-		workitem->avw_database = MyDatabaseId;
-		workitem->avw_relation = relationId;
-		workitem->avw_blockNumber = blkno;
-		result = true;
+		if (AVW_IS_HEAP_PAGE(type) && workitem->avw_type == type)
+		{
+			if (!workitem->avw_active &&
+				workitem->avw_database == MyDatabaseId &&
+				workitem->avw_relation == relationId &&
+				workitem->avw_blockNumber == blkno)
+			{
+				LWLockRelease(AutovacuumLock);
+				remember_heap_page_request(type, relationId, blkno, taken);
+				return true;
+			}
+			npages++;
+		}
+	}
 
-		/* done */
-		break;
+	if (AVW_IS_HEAP_PAGE(type))
+	{
+		/*
+		 * We just counted the items of this type, so correct the counter that
+		 * the unlocked check above looks at, in case it has drifted.
+		 */
+		pg_atomic_write_u32(&AutoVacuumShmem->av_nHeapPageItems[AVW_HEAP_PAGE_INDEX(type)],
+							npages);
+		if (npages >= MAX_HEAP_PAGE_WORKITEMS)
+			freeitem = NULL;
+	}
+
+	/*
+	 * Fill it with the given data.
+	 */
+	if (freeitem != NULL)
+	{
+		freeitem->avw_used = true;
+		freeitem->avw_active = false;
+		freeitem->avw_type = type;
+		freeitem->avw_database = MyDatabaseId;
+		freeitem->avw_relation = relationId;
+		freeitem->avw_blockNumber = blkno;
+		if (AVW_IS_HEAP_PAGE(type))
+			pg_atomic_fetch_add_u32(&AutoVacuumShmem->av_nHeapPageItems[AVW_HEAP_PAGE_INDEX(type)],
+									1);
+		result = true;
 	}
 
 	LWLockRelease(AutovacuumLock);
 
+	if (result && AVW_IS_HEAP_PAGE(type))
+		remember_heap_page_request(type, relationId, blkno, taken);
+
 	return result;
 }
 
+/*
+ * Release the heap page work items that belong to a database not in 'dblist',
+ * which is the launcher's current list of databases.  Nobody will ever
+ * process those once the database has been dropped, and they would otherwise
+ * keep their share of MAX_HEAP_PAGE_WORKITEMS forever.  Other kinds of work
+ * items are left alone, as before.
+ */
+static void
+release_orphaned_heap_page_items(List *dblist)
+{
+	int			i;
+
+	LWLockAcquire(AutovacuumLock, LW_EXCLUSIVE);
+	for (i = 0; i < NUM_WORKITEMS; i++)
+	{
+		AutoVacuumWorkItem *workitem = &AutoVacuumShmem->av_workItems[i];
+		ListCell   *cell;
+		bool		found = false;
+
+		if (!workitem->avw_used || workitem->avw_active ||
+			!AVW_IS_HEAP_PAGE(workitem->avw_type))
+			continue;
+
+		foreach(cell, dblist)
+		{
+			avw_dbase  *db = lfirst(cell);
+
+			if (db->adw_datid == workitem->avw_database)
+			{
+				found = true;
+				break;
+			}
+		}
+		if (found)
+			continue;
+
+		pg_atomic_fetch_sub_u32(&AutoVacuumShmem->av_nHeapPageItems[AVW_HEAP_PAGE_INDEX(workitem->avw_type)],
+								1);
+		workitem->avw_used = false;
+	}
+	LWLockRelease(AutovacuumLock);
+}
+
+/*
+ * Remember that we queued a heap page work item, or found it queued, at a
+ * time when av_heapPageItemsTaken was 'taken'.
+ */
+static void
+remember_heap_page_request(AutoVacuumWorkItemType type, Oid relationId,
+						   BlockNumber blkno, uint32 taken)
+{
+	RecentHeapPageRequest *recent;
+
+	recent = &recent_heap_page_requests[next_recent_heap_page_request];
+	recent->type = type;
+	recent->relation = relationId;
+	recent->blkno = blkno;
+	recent->taken = taken;
+	next_recent_heap_page_request = (next_recent_heap_page_request + 1) %
+		NUM_RECENT_HEAP_PAGE_REQUESTS;
+}
+
 /*
  * autovac_init
  *		This is called at postmaster initialization.
@@ -3430,6 +3627,9 @@ AutoVacuumShmemInit(void)
 		}
 
 		pg_atomic_init_u32(&AutoVacuumShmem->av_nworkersForBalance, 0);
+		pg_atomic_init_u32(&AutoVacuumShmem->av_nHeapPageItems[0], 0);
+		pg_atomic_init_u32(&AutoVacuumShmem->av_nHeapPageItems[1], 0);
+		pg_atomic_init_u32(&AutoVacuumShmem->av_heapPageItemsTaken, 0);
 
 	}
 	else
@@ -22,14 +22,18 @@
 #include <unistd.h>
 #include <sys/time.h>
 
+#include "access/xlog.h"
 #include "common/connect.h"
 #include "funcapi.h"
 #include "libpq-fe.h"
 #include "libpq/libpq-be-fe-helpers.h"
+#include "libpq/protocol.h"
 #include "mb/pg_wchar.h"
 #include "miscadmin.h"
 #include "pgstat.h"
+#include "port/pg_bswap.h"
 #include "pqexpbuffer.h"
+#include "replication/walcompress.h"
 #include "replication/walreceiver.h"
 #include "storage/latch.h"
 #include "utils/builtins.h"
@@ -50,6 +54,11 @@ struct WalReceiverConn
 	bool		logical;
 	/* Buffer for currently read records */
 	char	   *recvBuf;
+	/* Decompressor for the WAL stream, if compression was requested */
+	WalStreamCompressor *decompressor;
+	/* Buffer for decompressed WAL data messages */
+	char	   *decompBuf;
+	int			decompBufSize;
 };
 
 /* Prototypes for interface functions */
@@ -75,6 +84,8 @@ static void libpqrcv_endstreaming(WalReceiverConn *conn,
 								  TimeLineID *next_tli);
 static int	libpqrcv_receive(WalReceiverConn *conn, char **buffer,
 							 pgsocket *wait_fd);
+static int	libpqrcv_decompress(WalReceiverConn *conn, char **buffer,
+								int rawlen);
 static void libpqrcv_send(WalReceiverConn *conn, const char *buffer,
 						  int nbytes);
 static char *libpqrcv_create_slot(WalReceiverConn *conn,
@@ -583,9 +594,30 @@ libpqrcv_startstreaming(WalReceiverConn *conn,
 		appendStringInfoChar(&cmd, ')');
 	}
 	else
+	{
 		appendStringInfo(&cmd, " TIMELINE %u",
 						 options->proto.physical.startpointTLI);
 
+		/*
+		 * Ask for compression of the stream.  Older servers don't know about
+		 * it, in which case we silently stream uncompressed WAL.
+		 */
+		if (conn->decompressor != NULL)
+		{
+			WalStreamCompressorFree(conn->decompressor);
+			conn->decompressor = NULL;
+		}
+		if (options->proto.physical.compression != PG_COMPRESSION_NONE &&
+			PQserverVersion(conn->streamConn) >= 190000)
+		{
+			conn->decompressor =
+				WalStreamCompressorCreate(options->proto.physical.compression,
+										  wal_segment_size, true);
+			appendStringInfo(&cmd, " (compression '%s')",
+							 get_compress_algorithm_name(options->proto.physical.compression));
+		}
+	}
+
 	/* Start streaming. */
 	res = libpqsrv_exec(conn->streamConn,
 						cmd.data,
@@ -736,6 +768,10 @@ libpqrcv_disconnect(WalReceiverConn *conn)
 {
 	libpqsrv_disconnect(conn->streamConn);
 	PQfreemem(conn->recvBuf);
+	if (conn->decompressor)
+		WalStreamCompressorFree(conn->decompressor);
+	if (conn->decompBuf)
+		pfree(conn->decompBuf);
 	pfree(conn);
 }
 
@@ -834,11 +870,79 @@ libpqrcv_receive(WalReceiverConn *conn, char **buffer,
 				 errmsg("could not receive data from WAL stream: %s",
 						pchomp(PQerrorMessage(conn->streamConn)))));
 
+	/* Decompress WAL data if the stream is compressed */
+	if (conn->decompressor != NULL && rawlen > 0)
+		return libpqrcv_decompress(conn, buffer, rawlen);
+
 	/* Return received messages to caller */
 	*buffer = conn->recvBuf;
 	return rawlen;
 }
 
+/*
+ * Process a message received on a compressed physical replication stream.
+ *
+ * Compressed WAL data messages are turned back into plain WAL data messages,
+ * so that the caller doesn't need to know about compression.  Uncompressed
+ * WAL data is passed through as is, but still needs to be remembered by the
+ * decompressor because the sender uses it as a dictionary for later data.
+ */
+static int
+libpqrcv_decompress(WalReceiverConn *conn, char **buffer, int rawlen)
+{
+	const int	hdrlen = 1 + sizeof(int64) * 3;
+	XLogRecPtr	dataStart;
+	uint32		datalen;
+	int			msglen;
+
+	*buffer = conn->recvBuf;
+
+	if (conn->recvBuf[0] == PqReplMsg_WALData && rawlen >= hdrlen)
+	{
+		memcpy(&dataStart, &conn->recvBuf[1], sizeof(int64));
+		dataStart = pg_ntoh64(dataStart);
+		WalStreamRemember(conn->decompressor, dataStart,
+						  &conn->recvBuf[hdrlen], rawlen - hdrlen);
+		return rawlen;
+	}
+	if (conn->recvBuf[0] != PqReplMsg_CompressedWALData)
+		return rawlen;
+
+	if (rawlen < hdrlen + sizeof(int32))
+		ereport(ERROR,
+				(errcode(ERRCODE_PROTOCOL_VIOLATION),
+				 errmsg_internal("invalid compressed WAL message received from primary")));
+
+	memcpy(&dataStart, &conn->recvBuf[1], sizeof(int64));
+	dataStart = pg_ntoh64(dataStart);
+	memcpy(&datalen, &conn->recvBuf[hdrlen], sizeof(int32));
+	datalen = pg_ntoh32(datalen);
+	if (datalen > MaxAllocSize - hdrlen)
+		ereport(ERROR,
+				(errcode(ERRCODE_PROTOCOL_VIOLATION),
+				 errmsg_internal("invalid compressed WAL message received from primary")));
+
+	msglen = hdrlen + datalen;
+	if (conn->decompBufSize < msglen)
+	{
+		if (conn->decompBuf)
+			pfree(conn->decompBuf);
+		conn->decompBuf = MemoryContextAlloc(TopMemoryContext, msglen);
+		conn->decompBufSize = msglen;
+	}
+
+	/* Same header as a plain WAL data message, then the decompressed data */
+	memcpy(conn->decompBuf, conn->recvBuf, hdrlen);
+	conn->decompBuf[0] = PqReplMsg_WALData;
+	WalStreamDecompress(conn->decompressor, dataStart,
+						&conn->recvBuf[hdrlen + sizeof(int32)],
+						rawlen - hdrlen - sizeof(int32),
+						&conn->decompBuf[hdrlen], datalen);
+
+	*buffer = conn->decompBuf;
+	return msglen;
+}
+
 /*
  * Send a message to XLOG stream.
  *
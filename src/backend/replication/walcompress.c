@@ -0,0 +1,310 @@
+/*-------------------------------------------------------------------------
+ *
+ * walcompress.c
+ *	  Compression of WAL data in the physical replication stream.
+ *
+ * When a standby asks for it, the walsender compresses each chunk of WAL it
+ * ships, and libpqwalreceiver decompresses it again before handing it to the
+ * walreceiver.  WAL compresses much better when the compressor can refer back
+ * to data it has seen before, so both sides keep the last
+ * WAL_COMPRESS_HISTORY_SIZE bytes of WAL that went through the stream and use
+ * them as a dictionary for the next chunk.  The history is discarded whenever
+ * a chunk starts in a different WAL segment than the previous one, or doesn't
+ * continue where the previous one ended.  Both sides apply that rule to the
+ * dataStart of each message independently, so no extra protocol is needed to
+ * keep them in sync, and a chunk never depends on data from a previous
+ * segment.
+ *
+ * Portions Copyright (c) 2025, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *	  src/backend/replication/walcompress.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#ifdef USE_LZ4
+#include <lz4.h>
+#endif
+#ifdef USE_ZSTD
+#include <zstd.h>
+#endif
+
+#include "access/xlog_internal.h"
+#include "replication/walcompress.h"
+
+struct WalStreamCompressor
+{
+	pg_compress_algorithm algorithm;
+	int			segsize;
+	bool		decompress;
+
+	/* Recently streamed WAL, used as a dictionary for the next chunk */
+	char	   *history;
+	int			histlen;
+	XLogSegNo	histSegNo;		/* segment the history belongs to */
+	XLogRecPtr	histEnd;		/* LSN just past the end of the history */
+
+#ifdef USE_LZ4
+	LZ4_stream_t *lz4_stream;
+#endif
+#ifdef USE_ZSTD
+	ZSTD_CCtx  *zstd_cctx;
+	ZSTD_DCtx  *zstd_dctx;
+#endif
+};
+
+static void WalStreamPrepareHistory(WalStreamCompressor *wsc,
+									XLogRecPtr dataStart);
+
+/*
+ * Create a compressor (or, if 'decompress' is true, a decompressor) for a
+ * physical replication stream.
+ *
+ * The result is allocated in the current memory context.
+ */
+WalStreamCompressor *
+WalStreamCompressorCreate(pg_compress_algorithm algorithm, int segsize,
+						  bool decompress)
+{
+	WalStreamCompressor *wsc;
+
+	wsc = palloc0(sizeof(WalStreamCompressor));
+	wsc->algorithm = algorithm;
+	wsc->segsize = segsize;
+	wsc->decompress = decompress;
+	wsc->history = palloc(WAL_COMPRESS_HISTORY_SIZE);
+	wsc->histlen = 0;
+	wsc->histEnd = InvalidXLogRecPtr;
+
+	switch (algorithm)
+	{
+		case PG_COMPRESSION_LZ4:
+#ifdef USE_LZ4
+			if (!decompress)
+			{
+				wsc->lz4_stream = LZ4_createStream();
+				if (wsc->lz4_stream == NULL)
+					ereport(ERROR,
+							(errcode(ERRCODE_OUT_OF_MEMORY),
+							 errmsg("out of memory")));
+			}
+#else
+			ereport(ERROR,
+					(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+					 errmsg("compression method %s not supported", "lz4"),
+					 errdetail("This functionality requires the server to be built with %s support.", "lz4")));
+#endif
+			break;
+		case PG_COMPRESSION_ZSTD:
+#ifdef USE_ZSTD
+			if (decompress)
+				wsc->zstd_dctx = ZSTD_createDCtx();
+			else
+			{
+				wsc->zstd_cctx = ZSTD_createCCtx();
+				if (wsc->zstd_cctx != NULL)
+					ZSTD_CCtx_setParameter(wsc->zstd_cctx,
+										   ZSTD_c_compressionLevel, 1);
+			}
+			if (wsc->zstd_cctx == NULL && wsc->zstd_dctx == NULL)
+				ereport(ERROR,
+						(errcode(ERRCODE_OUT_OF_MEMORY),
+						 errmsg("out of memory")));
+#else
+			ereport(ERROR,
+					(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+					 errmsg("compression method %s not supported", "zstd"),
+					 errdetail("This functionality requires the server to be built with %s support.", "zstd")));
+#endif
+			break;
+		default:
+			ereport(ERROR,
+					(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+					 errmsg("compression method %s is not supported for WAL streaming",
+							get_compress_algorithm_name(algorithm))));
+	}
+
+	return wsc;
+}
+
+/*
+ * Release all resources held by a compressor.
+ */
+void
+WalStreamCompressorFree(WalStreamCompressor *wsc)
+{
+#ifdef USE_LZ4
+	if (wsc->lz4_stream)
+		LZ4_freeStream(wsc->lz4_stream);
+#endif
+#ifdef USE_ZSTD
+	if (wsc->zstd_cctx)
+		ZSTD_freeCCtx(wsc->zstd_cctx);
+	if (wsc->zstd_dctx)
+		ZSTD_freeDCtx(wsc->zstd_dctx);
+#endif
+	pfree(wsc->history);
+	pfree(wsc);
+}
+
+/*
+ * Discard the history if the chunk starting at dataStart cannot use it.
+ */
+static void
+WalStreamPrepareHistory(WalStreamCompressor *wsc, XLogRecPtr dataStart)
+{
+	XLogSegNo	segno;
+
+	XLByteToSeg(dataStart, segno, wsc->segsize);
+	if (wsc->histlen > 0 &&
+		(segno != wsc->histSegNo || dataStart != wsc->histEnd))
+		wsc->histlen = 0;
+	wsc->histSegNo = segno;
+}
+
+/*
+ * Add a chunk of WAL starting at dataStart to the history.
+ *
+ * The receiving side must call this for every chunk that arrived
+ * uncompressed, so that its history stays identical to the sender's.
+ */
+void
+WalStreamRemember(WalStreamCompressor *wsc, XLogRecPtr dataStart,
+				  const char *data, int len)
+{
+	WalStreamPrepareHistory(wsc, dataStart);
+
+	if (len >= WAL_COMPRESS_HISTORY_SIZE)
+	{
+		memcpy(wsc->history, data + len - WAL_COMPRESS_HISTORY_SIZE,
+			   WAL_COMPRESS_HISTORY_SIZE);
+		wsc->histlen = WAL_COMPRESS_HISTORY_SIZE;
+	}
+	else
+	{
+		int			keep = Min(wsc->histlen, WAL_COMPRESS_HISTORY_SIZE - len);
+
+		memmove(wsc->history, wsc->history + wsc->histlen - keep, keep);
+		memcpy(wsc->history + keep, data, len);
+		wsc->histlen = keep + len;
+	}
+	wsc->histEnd = dataStart + len;
+}
+
+/*
+ * Compress a chunk of WAL starting at dataStart, appending the result to
+ * 'dst'.
+ *
+ * Returns false, leaving 'dst' unchanged, if the compressed form wouldn't be
+ * smaller than the input; the caller should then send the chunk as is.  The
+ * chunk becomes part of the history either way.
+ */
+bool
+WalStreamCompress(WalStreamCompressor *wsc, XLogRecPtr dataStart,
+				  const char *src, int srclen, StringInfo dst)
+{
+	int			len = -1;
+
+	Assert(!wsc->decompress);
+
+	WalStreamPrepareHistory(wsc, dataStart);
+
+	switch (wsc->algorithm)
+	{
+		case PG_COMPRESSION_LZ4:
+#ifdef USE_LZ4
+			{
+				int			bound = LZ4_compressBound(srclen);
+
+				enlargeStringInfo(dst, bound);
+				LZ4_loadDict(wsc->lz4_stream, wsc->history, wsc->histlen);
+				len = LZ4_compress_fast_continue(wsc->lz4_stream, src,
+												 dst->data + dst->len,
+												 srclen, bound, 1);
+				if (len <= 0)
+					len = -1;	/* failure */
+			}
+#endif
+			break;
+		case PG_COMPRESSION_ZSTD:
+#ifdef USE_ZSTD
+			{
+				size_t		bound = ZSTD_compressBound(srclen);
+				size_t		ret;
+
+				enlargeStringInfo(dst, bound);
+				ZSTD_CCtx_reset(wsc->zstd_cctx, ZSTD_reset_session_only);
+				ZSTD_CCtx_refPrefix(wsc->zstd_cctx, wsc->history, wsc->histlen);
+				ret = ZSTD_compress2(wsc->zstd_cctx, dst->data + dst->len,
+									 bound, src, srclen);
+				if (!ZSTD_isError(ret))
+					len = (int) ret;
+			}
+#endif
+			break;
+		default:
+			Assert(false);		/* cannot happen */
+			break;
+	}
+
+	WalStreamRemember(wsc, dataStart, src, srclen);
+
+	if (len < 0 || len >= srclen)
+		return false;
+
+	dst->len += len;
+	dst->data[dst->len] = '\0';
+	return true;
+}
+
+/*
+ * Decompress a chunk of WAL starting at dataStart into 'dst', which must have
+ * room for 'rawlen' bytes, the size of the chunk before compression.
+ */
+void
+WalStreamDecompress(WalStreamCompressor *wsc, XLogRecPtr dataStart,
+					const char *src, int srclen, char *dst, int rawlen)
+{
+	int			len = -1;
+
+	Assert(wsc->decompress);
+
+	WalStreamPrepareHistory(wsc, dataStart);
+
+	switch (wsc->algorithm)
+	{
+		case PG_COMPRESSION_LZ4:
+#ifdef USE_LZ4
+			len = LZ4_decompress_safe_usingDict(src, dst, srclen, rawlen,
+												wsc->history, wsc->histlen);
+#endif
+			break;
+		case PG_COMPRESSION_ZSTD:
+#ifdef USE_ZSTD
+			{
+				size_t		ret;
+
+				ZSTD_DCtx_reset(wsc->zstd_dctx, ZSTD_reset_session_only);
+				ZSTD_DCtx_refPrefix(wsc->zstd_dctx, wsc->history, wsc->histlen);
+				ret = ZSTD_decompressDCtx(wsc->zstd_dctx, dst, rawlen,
+										  src, srclen);
+				if (!ZSTD_isError(ret))
+					len = (int) ret;
+			}
+#endif
+			break;
+		default:
+			Assert(false);		/* cannot happen */
+			break;
+	}
+
+	if (len != rawlen)
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg_internal("could not decompress WAL data starting at %X/%08X received from primary",
+								 LSN_FORMAT_ARGS(dataStart))));
+
+	WalStreamRemember(wsc, dataStart, dst, rawlen);
+}
@@ -76,6 +76,7 @@
 #include "replication/slot.h"
 #include "replication/snapbuild.h"
 #include "replication/syncrep.h"
+#include "replication/walcompress.h"
 #include "replication/walreceiver.h"
 #include "replication/walsender.h"
 #include "replication/walsender_private.h"
@@ -172,8 +173,15 @@ static XLogRecPtr sendTimeLineValidUpto = InvalidXLogRecPtr;
  */
 static XLogRecPtr sentPtr = InvalidXLogRecPtr;
 
+/*
+ * Compressor for the WAL data sent in physical replication, if the standby
+ * requested compression in START_REPLICATION.  NULL otherwise.
+ */
+static WalStreamCompressor *wal_compressor = NULL;
+
 /* Buffers for constructing outgoing messages and processing reply messages. */
 static StringInfoData output_message;
+static StringInfoData compressed_message;
 static StringInfoData reply_message;
 static StringInfoData tmpbuf;
 
@@ -257,6 +265,8 @@ static void ReadReplicationSlot(ReadReplicationSlotCmd *cmd);
 static void CreateReplicationSlot(CreateReplicationSlotCmd *cmd);
 static void DropReplicationSlot(DropReplicationSlotCmd *cmd);
 static void StartReplication(StartReplicationCmd *cmd);
+static void parseStartReplicationOptions(StartReplicationCmd *cmd,
+										 pg_compress_algorithm *compression);
 static void StartLogicalReplication(StartReplicationCmd *cmd);
 static void ProcessStandbyMessage(void);
 static void ProcessStandbyReplyMessage(void);
@@ -801,6 +811,9 @@ StartReplication(StartReplicationCmd *cmd)
 	StringInfoData buf;
 	XLogRecPtr	FlushPtr;
 	TimeLineID	FlushTLI;
+	pg_compress_algorithm compression = PG_COMPRESSION_NONE;
+
+	parseStartReplicationOptions(cmd, &compression);
 
 	/* create xlogreader for physical replication */
 	xlogreader =
@@ -951,9 +964,28 @@ StartReplication(StartReplicationCmd *cmd)
 		/* Start streaming from the requested point */
 		sentPtr = cmd->startpoint;
 
+		/* Set up compression of the stream, if requested */
+		if (wal_compressor != NULL)
+		{
+			WalStreamCompressorFree(wal_compressor);
+			wal_compressor = NULL;
+		}
+		if (compression != PG_COMPRESSION_NONE)
+		{
+			MemoryContext oldcxt = MemoryContextSwitchTo(TopMemoryContext);
+
+			wal_compressor = WalStreamCompressorCreate(compression,
+													   wal_segment_size,
+													   false);
+			MemoryContextSwitchTo(oldcxt);
+		}
+
 		/* Initialize shared memory status, too */
 		SpinLockAcquire(&MyWalSnd->mutex);
 		MyWalSnd->sentPtr = sentPtr;
+		MyWalSnd->compression = compression;
+		MyWalSnd->sentBytes = 0;
+		MyWalSnd->sentCompressedBytes = 0;
 		SpinLockRelease(&MyWalSnd->mutex);
 
 		SyncRepInitConfig();
@@ -1097,6 +1129,43 @@ logical_read_xlog_page(XLogReaderState *state, XLogRecPtr targetPagePtr, int req
 	return count;
 }
 
+/*
+ * Process extra options given to START_REPLICATION for physical replication.
+ */
+static void
+parseStartReplicationOptions(StartReplicationCmd *cmd,
+							 pg_compress_algorithm *compression)
+{
+	ListCell   *lc;
+	bool		compression_given = false;
+
+	foreach(lc, cmd->options)
+	{
+		DefElem    *defel = (DefElem *) lfirst(lc);
+
+		if (strcmp(defel->defname, "compression") == 0)
+		{
+			char	   *algorithm;
+
+			if (compression_given)
+				ereport(ERROR,
+						(errcode(ERRCODE_SYNTAX_ERROR),
+						 errmsg("conflicting or redundant options")));
+			compression_given = true;
+
+			algorithm = defGetString(defel);
+			if (!parse_compress_algorithm(algorithm, compression) ||
+				*compression == PG_COMPRESSION_GZIP)
+				ereport(ERROR,
+						(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+						 errmsg("unrecognized value for START_REPLICATION option \"%s\": \"%s\"",
+								defel->defname, algorithm)));
+		}
+		else
+			elog(ERROR, "unrecognized option: %s", defel->defname);
+	}
+}
+
 /*
  * Process extra options given to CREATE_REPLICATION_SLOT.
  */
@@ -2100,6 +2169,7 @@ exec_replication_command(const char *cmd_string)
 	 * message.  We do this just once per command to reduce palloc overhead.
 	 */
 	initStringInfo(&output_message);
+	initStringInfo(&compressed_message);
 	initStringInfo(&reply_message);
 	initStringInfo(&tmpbuf);
 
@@ -3041,6 +3111,9 @@ InitWalSenderSlot(void)
 			walsnd->applyLag = -1;
 			walsnd->sync_standby_priority = 0;
 			walsnd->replyTime = 0;
+			walsnd->compression = PG_COMPRESSION_NONE;
+			walsnd->sentBytes = 0;
+			walsnd->sentCompressedBytes = 0;
 
 			/*
 			 * The kind assignment is done here and not in StartReplication()
@@ -3177,6 +3250,8 @@ XLogSendPhysical(void)
 	XLogSegNo	segno;
 	WALReadError errinfo;
 	Size		rbytes;
+	Size		wirebytes;
+	StringInfo	msg = &output_message;
 
 	/* If requested switch the WAL sender to the stopping state. */
 	if (got_STOPPING)
@@ -3442,15 +3517,43 @@ retry:
 	output_message.len += nbytes;
 	output_message.data[output_message.len] = '\0';
 
+	nbytes = endptr - sentPtr;
+	wirebytes = nbytes;
+
+	/*
+	 * If the standby asked for compression, try to compress the data.  The
+	 * compressed message has the same header as the plain one, followed by
+	 * the uncompressed length.  If compression doesn't make the data any
+	 * smaller, send it as is; the standby accepts both kinds of message.
+	 */
+	if (wal_compressor != NULL)
+	{
+		int			hdrlen = 1 + sizeof(int64) * 3;
+
+		resetStringInfo(&compressed_message);
+		pq_sendbyte(&compressed_message, PqReplMsg_CompressedWALData);
+		appendBinaryStringInfo(&compressed_message,
+							   &output_message.data[1], sizeof(int64) * 3);
+		pq_sendint32(&compressed_message, (int32) nbytes);
+
+		if (WalStreamCompress(wal_compressor, sentPtr,
+							  &output_message.data[hdrlen], nbytes,
+							  &compressed_message))
+		{
+			msg = &compressed_message;
+			wirebytes = compressed_message.len - hdrlen - sizeof(int32);
+		}
+	}
+
 	/*
 	 * Fill the send timestamp last, so that it is taken as late as possible.
 	 */
 	resetStringInfo(&tmpbuf);
 	pq_sendint64(&tmpbuf, GetCurrentTimestamp());
-	memcpy(&output_message.data[1 + sizeof(int64) + sizeof(int64)],
+	memcpy(&msg->data[1 + sizeof(int64) + sizeof(int64)],
 		   tmpbuf.data, sizeof(int64));
 
-	pq_putmessage_noblock(PqMsg_CopyData, output_message.data, output_message.len);
+	pq_putmessage_noblock(PqMsg_CopyData, msg->data, msg->len);
 
 	sentPtr = endptr;
 
@@ -3460,6 +3563,8 @@ retry:
 
 		SpinLockAcquire(&walsnd->mutex);
 		walsnd->sentPtr = sentPtr;
+		walsnd->sentBytes += nbytes;
+		walsnd->sentCompressedBytes += wirebytes;
 		SpinLockRelease(&walsnd->mutex);
 	}
 
@@ -3975,7 +4080,7 @@ offset_to_interval(TimeOffset offset)
 Datum
 pg_stat_get_wal_senders(PG_FUNCTION_ARGS)
 {
-#define PG_STAT_GET_WAL_SENDERS_COLS	12
+#define PG_STAT_GET_WAL_SENDERS_COLS	15
 	ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
 	SyncRepStandbyData *sync_standbys;
 	int			num_standbys;
@@ -4003,6 +4108,9 @@ pg_stat_get_wal_senders(PG_FUNCTION_ARGS)
 		int			pid;
 		WalSndState state;
 		TimestampTz replyTime;
+		pg_compress_algorithm compression;
+		uint64		sentBytes;
+		uint64		sentCompressedBytes;
 		bool		is_sync_standby;
 		Datum		values[PG_STAT_GET_WAL_SENDERS_COLS];
 		bool		nulls[PG_STAT_GET_WAL_SENDERS_COLS] = {0};
@@ -4026,6 +4134,9 @@ pg_stat_get_wal_senders(PG_FUNCTION_ARGS)
 		applyLag = walsnd->applyLag;
 		priority = walsnd->sync_standby_priority;
 		replyTime = walsnd->replyTime;
+		compression = walsnd->compression;
+		sentBytes = walsnd->sentBytes;
+		sentCompressedBytes = walsnd->sentCompressedBytes;
 		SpinLockRelease(&walsnd->mutex);
 
 		/*
@@ -4122,6 +4233,19 @@ pg_stat_get_wal_senders(PG_FUNCTION_ARGS)
 				nulls[11] = true;
 			else
 				values[11] = TimestampTzGetDatum(replyTime);
+
+			values[13] = Int64GetDatum((int64) sentBytes);
+
+			if (compression == PG_COMPRESSION_NONE)
+			{
+				nulls[12] = true;
+				nulls[14] = true;
+			}
+			else
+			{
+				values[12] = CStringGetTextDatum(get_compress_algorithm_name(compression));
+				values[14] = Int64GetDatum((int64) sentCompressedBytes);
+			}
 		}
 
 		tuplestore_putvalues(rsinfo->setResult, rsinfo->setDesc,
@@ -72,6 +72,25 @@ typedef struct StatExtEntry
 	List	   *exprs;			/* expressions */
 } StatExtEntry;
 
+/*
+ * An equality join clause "rel1.attnum1 = rel2.attnum2" that might be
+ * estimated by statext_join_clauselist_selectivity.  The relids are ordered
+ * so that relid1 < relid2; 'reversed' is true if rel1's Var is the right
+ * operand of the operator.
+ */
+typedef struct StatExtJoinClause
+{
+	int			listidx;		/* position in the clause list */
+	Index		relid1;
+	Index		relid2;
+	AttrNumber	attnum1;
+	AttrNumber	attnum2;
+	Oid			opno;			/* equality operator */
+	Oid			inputcollid;	/* collation the operator uses */
+	bool		reversed;
+	bool		done;			/* already processed as part of a group? */
+} StatExtJoinClause;
+
 
 static List *fetch_statentries_for_relation(Relation pg_statext, Oid relid);
 static VacAttrStats **lookup_var_attr_stats(Bitmapset *attrs, List *exprs,
@@ -95,6 +114,15 @@ static Datum serialize_expr_stats(AnlExprData *exprdata, int nexprs);
 static Datum expr_fetch_func(VacAttrStatsP stats, int rownum, bool *isNull);
 static AnlExprData *build_expr_data(List *exprs, int stattarget);
 
+static bool statext_is_compatible_join_clause(PlannerInfo *root, Node *clause,
+											  StatExtJoinClause *jc);
+static bool statext_join_group_selectivity(PlannerInfo *root,
+										   StatExtJoinClause **group,
+										   int nclauses, Selectivity *sel);
+static double statext_join_ndistinct(PlannerInfo *root, RelOptInfo *rel,
+									 Bitmapset *attnums);
+static MCVList *statext_join_mcv(PlannerInfo *root, RelOptInfo *rel,
+								 Bitmapset *attnums);
 static StatsBuildData *make_build_data(Relation rel, StatExtEntry *stat,
 									   int numrows, HeapTuple *rows,
 									   VacAttrStats **stats, int stattarget);
@@ -2017,6 +2045,491 @@ statext_clauselist_selectivity(PlannerInfo *root, List *clauses, int varRelid,
 	return sel;
 }
 
+/*
+ * statext_join_clauselist_selectivity
+ *		Estimate groups of equality join clauses using extended statistics.
+ *
+ * Without extended statistics, the selectivities of join clauses such as
+ * "a.x = b.x AND a.y = b.y" are simply multiplied together, which badly
+ * underestimates the join size when the columns are correlated, as is
+ * typical for composite keys.  If two or more such clauses connect the same
+ * pair of base relations, and both relations have ndistinct statistics
+ * covering the columns on their side of the join, we estimate the group of
+ * clauses as a single equality on the combined key, the same way eqjoinsel()
+ * estimates a single-column equality: using the number of distinct key
+ * combinations on each side and, if both sides have multivariate MCV lists
+ * on exactly the join columns, by matching the MCV items.
+ *
+ * Only inner and outer joins are handled; eqjoinsel() uses different logic
+ * for semijoins and antijoins.
+ *
+ * 'estimatedclauses' is populated with the 0-based list positions of the
+ * clauses estimated here, and the combined selectivity of those clauses is
+ * returned.
+ */
+Selectivity
+statext_join_clauselist_selectivity(PlannerInfo *root, List *clauses,
+									JoinType jointype,
+									SpecialJoinInfo *sjinfo,
+									Bitmapset **estimatedclauses)
+{
+	Selectivity sel = 1.0;
+	StatExtJoinClause *jclauses;
+	StatExtJoinClause **group;
+	int			njclauses;
+	int			listidx;
+	ListCell   *lc;
+
+	if (jointype != JOIN_INNER && jointype != JOIN_LEFT &&
+		jointype != JOIN_FULL)
+		return sel;
+
+	/* collect the clauses we might be able to estimate */
+	jclauses = palloc(sizeof(StatExtJoinClause) * list_length(clauses));
+	njclauses = 0;
+	listidx = 0;
+	foreach(lc, clauses)
+	{
+		Node	   *clause = (Node *) lfirst(lc);
+
+		if (!bms_is_member(listidx, *estimatedclauses) &&
+			statext_is_compatible_join_clause(root, clause,
+											  &jclauses[njclauses]))
+		{
+			jclauses[njclauses].listidx = listidx;
+			njclauses++;
+		}
+		listidx++;
+	}
+
+	if (njclauses < 2)
+	{
+		pfree(jclauses);
+		return sel;
+	}
+
+	/* process clauses grouped by the pair of relations they join */
+	group = palloc(sizeof(StatExtJoinClause *) * njclauses);
+	for (int i = 0; i < njclauses; i++)
+	{
+		int			ngroup = 0;
+		Selectivity s;
+
+		if (jclauses[i].done)
+			continue;
+
+		for (int j = i; j < njclauses; j++)
+		{
+			if (jclauses[j].relid1 == jclauses[i].relid1 &&
+				jclauses[j].relid2 == jclauses[i].relid2)
+			{
+				jclauses[j].done = true;
+				group[ngroup++] = &jclauses[j];
+			}
+		}
+
+		if (ngroup < 2)
+			continue;
+
+		if (statext_join_group_selectivity(root, group, ngroup, &s))
+		{
+			sel *= s;
+			for (int j = 0; j < ngroup; j++)
+				*estimatedclauses = bms_add_member(*estimatedclauses,
+												   group[j]->listidx);
+		}
+	}
+
+	pfree(group);
+	pfree(jclauses);
+
+	return sel;
+}
+
+/*
+ * statext_is_compatible_join_clause
+ *		Determine if a clause is an equality between plain columns of two
+ *		different base relations, and if so, fill *jc with its details.
+ */
+static bool
+statext_is_compatible_join_clause(PlannerInfo *root, Node *clause,
+								  StatExtJoinClause *jc)
+{
+	RestrictInfo *rinfo;
+	OpExpr	   *expr;
+	Node	   *leftop;
+	Node	   *rightop;
+	Var		   *var1;
+	Var		   *var2;
+
+	if (!IsA(clause, RestrictInfo))
+		return false;
+	rinfo = (RestrictInfo *) clause;
+
+	if (rinfo->pseudoconstant)
+		return false;
+
+	if (!is_opclause(rinfo->clause))
+		return false;
+	expr = (OpExpr *) rinfo->clause;
+	if (list_length(expr->args) != 2)
+		return false;
+
+	/* must be an equality operator that eqjoinsel() would estimate */
+	if (get_oprjoin(expr->opno) != F_EQJOINSEL)
+		return false;
+
+	leftop = linitial(expr->args);
+	rightop = lsecond(expr->args);
+	if (IsA(leftop, RelabelType))
+		leftop = (Node *) ((RelabelType *) leftop)->arg;
+	if (IsA(rightop, RelabelType))
+		rightop = (Node *) ((RelabelType *) rightop)->arg;
+
+	if (!IsA(leftop, Var) || !IsA(rightop, Var))
+		return false;
+	var1 = (Var *) leftop;
+	var2 = (Var *) rightop;
+
+	if (var1->varlevelsup != 0 || var2->varlevelsup != 0 ||
+		var1->varno == var2->varno)
+		return false;
+
+	/* we don't support statistics on system attributes */
+	if (!AttrNumberIsForUserDefinedAttr(var1->varattno) ||
+		!AttrNumberIsForUserDefinedAttr(var2->varattno))
+		return false;
+
+	jc->reversed = (var1->varno > var2->varno);
+	if (jc->reversed)
+	{
+		Var		   *tmp = var1;
+
+		var1 = var2;
+		var2 = tmp;
+	}
+
+	jc->relid1 = var1->varno;
+	jc->relid2 = var2->varno;
+	jc->attnum1 = var1->varattno;
+	jc->attnum2 = var2->varattno;
+	jc->opno = expr->opno;
+	jc->inputcollid = expr->inputcollid;
+	jc->done = false;
+
+	return true;
+}
+
+/*
+ * statext_join_group_selectivity
+ *		Estimate a group of equality clauses joining the same two relations
+ *		as a single equality on the combined key.
+ *
+ * Returns false if the relations don't have suitable statistics.
+ */
+static bool
+statext_join_group_selectivity(PlannerInfo *root, StatExtJoinClause **group,
+							   int nclauses, Selectivity *sel)
+{
+	Index		relid1 = group[0]->relid1;
+	Index		relid2 = group[0]->relid2;
+	RelOptInfo *rel1;
+	RelOptInfo *rel2;
+	Bitmapset  *attnums1 = NULL;
+	Bitmapset  *attnums2 = NULL;
+	double		nd1;
+	double		nd2;
+	MCVList    *mcv1;
+	MCVList    *mcv2;
+	Selectivity selec;
+
+	if (relid1 >= root->simple_rel_array_size ||
+		relid2 >= root->simple_rel_array_size)
+		return false;
+	rel1 = root->simple_rel_array[relid1];
+	rel2 = root->simple_rel_array[relid2];
+	if (rel1 == NULL || rel2 == NULL ||
+		rel1->rtekind != RTE_RELATION || rel2->rtekind != RTE_RELATION ||
+		rel1->statlist == NIL || rel2->statlist == NIL)
+		return false;
+
+	for (int i = 0; i < nclauses; i++)
+	{
+		attnums1 = bms_add_member(attnums1, group[i]->attnum1);
+		attnums2 = bms_add_member(attnums2, group[i]->attnum2);
+	}
+
+	/*
+	 * Give up if the same column appears in more than one clause; the
+	 * clauses then don't describe a simple composite key.
+	 */
+	if (bms_num_members(attnums1) != nclauses ||
+		bms_num_members(attnums2) != nclauses)
+		return false;
+
+	nd1 = statext_join_ndistinct(root, rel1, attnums1);
+	if (nd1 <= 0)
+		return false;
+	nd2 = statext_join_ndistinct(root, rel2, attnums2);
+	if (nd2 <= 0)
+		return false;
+
+	/* Without MCV lists, this is what eqjoinsel_inner() would do */
+	selec = 1.0 / Max(nd1, nd2);
+
+	mcv1 = statext_join_mcv(root, rel1, attnums1);
+	mcv2 = mcv1 ? statext_join_mcv(root, rel2, attnums2) : NULL;
+
+	if (mcv1 && mcv2)
+	{
+		FmgrInfo   *eqprocs;
+		int		   *dim1;
+		int		   *dim2;
+		bool	   *hasmatch1;
+		bool	   *hasmatch2;
+		double		nullfrac1 = 0.0;
+		double		nullfrac2 = 0.0;
+		double		sumcommon1 = 0.0;
+		double		sumcommon2 = 0.0;
+		double		matchprodfreq = 0.0;
+		double		matchfreq1 = 0.0;
+		double		matchfreq2 = 0.0;
+		double		unmatchfreq1;
+		double		unmatchfreq2;
+		double		otherfreq1;
+		double		otherfreq2;
+		double		totalsel1;
+		double		totalsel2;
+		int			nvalues1 = 0;
+		int			nvalues2 = 0;
+		int			nmatches = 0;
+
+		/*
+		 * Both MCV lists are on exactly the join columns and have no
+		 * expressions, so their dimensions are the join columns in attnum
+		 * order.
+		 */
+		eqprocs = palloc(sizeof(FmgrInfo) * nclauses);
+		dim1 = palloc(sizeof(int) * nclauses);
+		dim2 = palloc(sizeof(int) * nclauses);
+		for (int i = 0; i < nclauses; i++)
+		{
+			fmgr_info(get_opcode(group[i]->opno), &eqprocs[i]);
+			dim1[i] = bms_member_index(attnums1, group[i]->attnum1);
+			dim2[i] = bms_member_index(attnums2, group[i]->attnum2);
+		}
+
+		hasmatch1 = palloc0(sizeof(bool) * mcv1->nitems);
+		hasmatch2 = palloc0(sizeof(bool) * mcv2->nitems);
+
+		/*
+		 * Match the MCV items the same way eqjoinsel_inner() does.  Items
+		 * with NULL in any of the columns can't match anything.
+		 */
+		for (int j = 0; j < mcv2->nitems; j++)
+		{
+			MCVItem    *item2 = &mcv2->items[j];
+			bool		isnull = false;
+
+			for (int d = 0; d < mcv2->ndimensions; d++)
+				isnull |= item2->isnull[d];
+
+			if (isnull)
+				nullfrac2 += item2->frequency;
+			else
+			{
+				sumcommon2 += item2->frequency;
+				nvalues2++;
+			}
+		}
+
+		for (int i = 0; i < mcv1->nitems; i++)
+		{
+			MCVItem    *item1 = &mcv1->items[i];
+			bool		isnull = false;
+
+			for (int d = 0; d < mcv1->ndimensions; d++)
+				isnull |= item1->isnull[d];
+
+			if (isnull)
+			{
+				nullfrac1 += item1->frequency;
+				continue;
+			}
+			sumcommon1 += item1->frequency;
+			nvalues1++;
+
+			for (int j = 0; j < mcv2->nitems; j++)
+			{
+				MCVItem    *item2 = &mcv2->items[j];
+				bool		match = true;
+
+				if (hasmatch2[j])
+					continue;
+
+				for (int c = 0; c < nclauses && match; c++)
+				{
+					Datum		v1 = item1->values[dim1[c]];
+					Datum		v2 = item2->values[dim2[c]];
+
+					if (item2->isnull[dim2[c]])
+						match = false;
+					else if (group[c]->reversed)
+						match = DatumGetBool(FunctionCall2Coll(&eqprocs[c],
+															   group[c]->inputcollid,
+															   v2, v1));
+					else
+						match = DatumGetBool(FunctionCall2Coll(&eqprocs[c],
+															   group[c]->inputcollid,
+															   v1, v2));
+				}
+
+				if (match)
+				{
+					hasmatch1[i] = hasmatch2[j] = true;
+					matchprodfreq += item1->frequency * item2->frequency;
+					matchfreq1 += item1->frequency;
+					matchfreq2 += item2->frequency;
+					nmatches++;
+					break;
+				}
+			}
+		}
+
+		CLAMP_PROBABILITY(matchprodfreq);
+		unmatchfreq1 = Max(sumcommon1 - matchfreq1, 0.0);
+		unmatchfreq2 = Max(sumcommon2 - matchfreq2, 0.0);
+		otherfreq1 = 1.0 - nullfrac1 - sumcommon1;
+		otherfreq2 = 1.0 - nullfrac2 - sumcommon2;
+		CLAMP_PROBABILITY(otherfreq1);
+		CLAMP_PROBABILITY(otherfreq2);
+
+		/* see eqjoinsel_inner() for the reasoning behind these formulas */
+		totalsel1 = matchprodfreq;
+		if (nd2 > nvalues2)
+			totalsel1 += unmatchfreq1 * otherfreq2 / (nd2 - nvalues2);
+		if (nd2 > nmatches)
+			totalsel1 += otherfreq1 * (otherfreq2 + unmatchfreq2) /
+				(nd2 - nmatches);
+		totalsel2 = matchprodfreq;
+		if (nd1 > nvalues1)
+			totalsel2 += unmatchfreq2 * otherfreq1 / (nd1 - nvalues1);
+		if (nd1 > nmatches)
+			totalsel2 += otherfreq2 * (otherfreq1 + unmatchfreq1) /
+				(nd1 - nmatches);
+
+		selec = Min(totalsel1, totalsel2);
+
+		pfree(eqprocs);
+		pfree(dim1);
+		pfree(dim2);
+		pfree(hasmatch1);
+		pfree(hasmatch2);
+	}
+
+	CLAMP_PROBABILITY(selec);
+	*sel = selec;
+
+	return true;
+}
+
+/*
+ * statext_join_ndistinct
+ *		Look up the number of distinct combinations of the given columns of
+ *		the relation in its ndistinct statistics.
+ *
+ * Returns -1 if there are no suitable statistics.
+ */
+static double
+statext_join_ndistinct(PlannerInfo *root, RelOptInfo *rel, Bitmapset *attnums)
+{
+	RangeTblEntry *rte = planner_rt_fetch(rel->relid, root);
+	ListCell   *lc;
+
+	foreach(lc, rel->statlist)
+	{
+		StatisticExtInfo *info = (StatisticExtInfo *) lfirst(lc);
+		MVNDistinct *stats;
+		Bitmapset  *matched = NULL;
+		AttrNumber	attnum_offset;
+		int			attnum = -1;
+
+		if (info->kind != STATS_EXT_NDISTINCT || info->inherit != rte->inh)
+			continue;
+		if (!bms_is_subset(attnums, info->keys))
+			continue;
+
+		stats = statext_ndistinct_load(info->statOid, rte->inh);
+		if (!stats)
+			continue;
+
+		/* see estimate_multivariate_ndistinct() */
+		attnum_offset = info->exprs ? list_length(info->exprs) + 1 : 0;
+		while ((attnum = bms_next_member(attnums, attnum)) >= 0)
+			matched = bms_add_member(matched, attnum + attnum_offset);
+
+		for (int i = 0; i < stats->nitems; i++)
+		{
+			MVNDistinctItem *item = &stats->items[i];
+			bool		found = (item->nattributes == bms_num_members(matched));
+
+			for (int j = 0; j < item->nattributes && found; j++)
+				found = bms_is_member(item->attributes[j], matched);
+
+			if (found)
+			{
+				double		nd = item->ndistinct;
+
+				if (rel->tuples > 0)
+					nd = Min(nd, rel->tuples);
+				return Max(nd, 1.0);
+			}
+		}
+	}
+
+	return -1;
+}
+
+/*
+ * statext_join_mcv
+ *		Find a multivariate MCV list on exactly the given columns of the
+ *		relation, if there is one and we are allowed to use it.
+ */
+static MCVList *
+statext_join_mcv(PlannerInfo *root, RelOptInfo *rel, Bitmapset *attnums)
+{
+	RangeTblEntry *rte = planner_rt_fetch(rel->relid, root);
+	ListCell   *lc;
+
+	foreach(lc, rel->statlist)
+	{
+		StatisticExtInfo *info = (StatisticExtInfo *) lfirst(lc);
+		Bitmapset  *clause_attnums = NULL;
+		int			attnum = -1;
+
+		if (info->kind != STATS_EXT_MCV || info->inherit != rte->inh)
+			continue;
+		if (info->exprs != NIL || !bms_equal(attnums, info->keys))
+			continue;
+
+		/*
+		 * Matching the MCV items calls the join operators on values from
+		 * the lists, which might reveal them.  As for restriction clauses
+		 * (see statext_is_compatible_clause), we require that the user can
+		 * read all rows of these columns.
+		 */
+		while ((attnum = bms_next_member(attnums, attnum)) >= 0)
+			clause_attnums = bms_add_member(clause_attnums,
+											attnum - FirstLowInvalidHeapAttributeNumber);
+		if (!all_rows_selectable(root, rel->relid, clause_attnums))
+			return NULL;
+
+		return statext_mcv_load(info->statOid, rte->inh);
+	}
+
+	return NULL;
+}
+
 /*
  * examine_opclause_args
  *		Split an operator expression's arguments into Expr and Const parts.
@@ -273,6 +273,18 @@ static AllocateDesc *allocatedDescs = NULL;
  */
 static int	numExternalFDs = 0;
 
+#ifdef HAVE_GETRLIMIT
+/*
+ * If set_max_safe_fds() raised the soft limit on open files, the limit we
+ * were started with and the one we raised it to.  Programs we start via
+ * system() or popen() run with the original limit; see
+ * RestoreOriginalOpenFileLimit().
+ */
+static bool saved_original_max_open_files = false;
+static struct rlimit original_max_open_files;
+static struct rlimit custom_max_open_files;
+#endif
+
 /*
  * Number of temporary files opened during the current session;
  * this is used in generation of tempfile names.
@@ -334,6 +346,7 @@ static void FreeVfd(File file);
 static int	FileAccess(File file);
 static File OpenTemporaryFileInTablespace(Oid tblspcOid, bool rejectError);
 static bool reserveAllocatedDesc(void);
+static bool IncreaseOpenFileLimit(int extra_files);
 static int	FreeDesc(AllocateDesc *desc);
 
 static void BeforeShmemExit_Files(int code, Datum arg);
@@ -1033,6 +1046,99 @@ count_usable_fds(int max_to_probe, int *usable_fds, int *already_open)
 	*already_open = highestfd + 1 - used;
 }
 
+/*
+ * IncreaseOpenFileLimit --- try to raise the soft limit on open files
+ *		by extra_files, but not beyond the hard limit.
+ *
+ * Many systems start processes with a soft RLIMIT_NOFILE of 1024 while
+ * allowing them to raise it much further on their own.  Without this,
+ * max_files_per_process could never take effect above the soft limit, and a
+ * backend touching many relation segments would spend its time closing and
+ * reopening files in the VFD cache.
+ *
+ * Returns true if the limit was raised.
+ */
+static bool
+IncreaseOpenFileLimit(int extra_files)
+{
+#ifdef HAVE_GETRLIMIT
+	struct rlimit rlim;
+	rlim_t		wanted;
+
+	if (getrlimit(RLIMIT_NOFILE, &rlim) != 0)
+		return false;			/* count_usable_fds() complains about this */
+
+	if (rlim.rlim_cur == RLIM_INFINITY ||
+		(rlim.rlim_max != RLIM_INFINITY && rlim.rlim_cur >= rlim.rlim_max))
+		return false;
+
+	wanted = rlim.rlim_cur + extra_files;
+	if (rlim.rlim_max != RLIM_INFINITY && wanted > rlim.rlim_max)
+		wanted = rlim.rlim_max;
+
+	if (!saved_original_max_open_files)
+	{
+		original_max_open_files = rlim;
+		saved_original_max_open_files = true;
+	}
+
+	rlim.rlim_cur = wanted;
+	if (setrlimit(RLIMIT_NOFILE, &rlim) != 0)
+	{
+		ereport(WARNING,
+				(errmsg("could not raise limit on open files to %lu: %m",
+						(unsigned long) wanted)));
+		return false;
+	}
+	custom_max_open_files = rlim;
+
+	return true;
+#else
+	return false;
+#endif
+}
+
+/*
+ * RestoreOriginalOpenFileLimit
+ *		Put back the soft limit on open files that we were started with.
+ *
+ * Programs that we run via system() or popen() may not expect a raised soft
+ * limit; in particular, programs using select() can't deal with file
+ * descriptor numbers at or above FD_SETSIZE.  Callers should bracket such
+ * calls with this and RestoreCustomOpenFileLimit().  We don't open any files
+ * in between, so it doesn't matter that the original limit may be lower than
+ * the number of files we already have open.
+ */
+void
+RestoreOriginalOpenFileLimit(void)
+{
+#ifdef HAVE_GETRLIMIT
+	if (!saved_original_max_open_files)
+		return;
+
+	if (setrlimit(RLIMIT_NOFILE, &original_max_open_files) != 0)
+		ereport(WARNING,
+				(errmsg("could not restore limit on open files: %m")));
+#endif
+}
+
+/*
+ * RestoreCustomOpenFileLimit
+ *		Undo RestoreOriginalOpenFileLimit().
+ */
+void
+RestoreCustomOpenFileLimit(void)
+{
+#ifdef HAVE_GETRLIMIT
+	if (!saved_original_max_open_files)
+		return;
+
+	if (setrlimit(RLIMIT_NOFILE, &custom_max_open_files) != 0)
+		ereport(WARNING,
+				(errmsg("could not restore limit on open files: %m")));
+#endif
+}
+
 /*
  * set_max_safe_fds
  *		Determine number of file descriptors that fd.c is allowed to use
@@ -1055,6 +1161,16 @@ set_max_safe_fds(void)
 	count_usable_fds(max_files_per_process,
 					 &usable_fds, &already_open);
 
+	/*
+	 * If the soft limit on open files is what stops us from reaching
+	 * max_files_per_process, raise it as far as the hard limit allows, and
+	 * count again.
+	 */
+	if (usable_fds < max_files_per_process &&
+		IncreaseOpenFileLimit(max_files_per_process - usable_fds))
+		count_usable_fds(max_files_per_process,
+						 &usable_fds, &already_open);
+
 	max_safe_fds = Min(usable_fds, max_files_per_process);
 
 	/*
@@ -2739,6 +2855,8 @@ OpenTransientFilePerm(const char *fileName, int fileFlags, mode_t fileMode)
  * This function also ensures that the popen'd program is run with default
  * SIGPIPE processing, rather than the SIG_IGN setting the backend normally
  * uses.  This ensures desirable response to, eg, closing a read pipe early.
+ * The program also gets the soft limit on open files that the server was
+ * started with, even if set_max_safe_fds() raised ours.
  */
 FILE *
 OpenPipeStream(const char *command, const char *mode)
@@ -2762,9 +2880,11 @@ OpenPipeStream(const char *command, const char *mode)
 TryAgain:
 	fflush(NULL);
 	pqsignal(SIGPIPE, SIG_DFL);
+	RestoreOriginalOpenFileLimit();
 	errno = 0;
 	file = popen(command, mode);
 	save_errno = errno;
+	RestoreCustomOpenFileLimit();
 	pqsignal(SIGPIPE, SIG_IGN);
 	errno = save_errno;
 	if (file != NULL)
@@ -107,8 +107,9 @@ static Size fsm_space_cat_to_avail(uint8 cat);
 
 /* workhorse functions for various operations */
 static int	fsm_set_and_search(Relation rel, FSMAddress addr, uint16 slot,
-							   uint8 newValue, uint8 minValue);
-static BlockNumber fsm_search(Relation rel, uint8 min_cat);
+							   uint8 newValue, uint8 minValue,
+							   int start_offset);
+static BlockNumber fsm_search(Relation rel, uint8 min_cat, int start_offset);
 static uint8 fsm_vacuum_page(Relation rel, FSMAddress addr,
 							 BlockNumber start, BlockNumber end,
 							 bool *eof_p);
@@ -135,10 +136,24 @@ static bool fsm_does_block_exist(Relation rel, BlockNumber blknumber);
  */
 BlockNumber
 GetPageWithFreeSpace(Relation rel, Size spaceNeeded)
+{
+	return GetPageWithFreeSpaceExtended(rel, spaceNeeded, 0);
+}
+
+/*
+ * GetPageWithFreeSpaceExtended - like GetPageWithFreeSpace, but start
+ *		searching start_offset pages to the right of where we otherwise would.
+ *
+ * Concurrent callers that pass different offsets are likely to get different
+ * pages, even if they ask at the same moment.  start_offset only applies
+ * within the FSM page that the search ends up in.
+ */
+BlockNumber
+GetPageWithFreeSpaceExtended(Relation rel, Size spaceNeeded, int start_offset)
 {
 	uint8		min_cat = fsm_space_needed_to_cat(spaceNeeded);
 
-	return fsm_search(rel, min_cat);
+	return fsm_search(rel, min_cat, start_offset);
 }
 
 /*
@@ -153,6 +168,19 @@ GetPageWithFreeSpace(Relation rel, Size spaceNeeded)
 BlockNumber
 RecordAndGetPageWithFreeSpace(Relation rel, BlockNumber oldPage,
 							  Size oldSpaceAvail, Size spaceNeeded)
+{
+	return RecordAndGetPageWithFreeSpaceExtended(rel, oldPage, oldSpaceAvail,
+												 spaceNeeded, 0);
+}
+
+/*
+ * RecordAndGetPageWithFreeSpaceExtended - like RecordAndGetPageWithFreeSpace,
+ *		with a start_offset as for GetPageWithFreeSpaceExtended.
+ */
+BlockNumber
+RecordAndGetPageWithFreeSpaceExtended(Relation rel, BlockNumber oldPage,
+									  Size oldSpaceAvail, Size spaceNeeded,
+									  int start_offset)
 {
 	int			old_cat = fsm_space_avail_to_cat(oldSpaceAvail);
 	int			search_cat = fsm_space_needed_to_cat(spaceNeeded);
@@ -163,7 +191,8 @@ RecordAndGetPageWithFreeSpace(Relation rel, BlockNumber oldPage,
 	/* Get the location of the FSM byte representing the heap block */
 	addr = fsm_get_location(oldPage, &slot);
 
-	search_slot = fsm_set_and_search(rel, addr, slot, old_cat, search_cat);
+	search_slot = fsm_set_and_search(rel, addr, slot, old_cat, search_cat,
+									 start_offset);
 
 	/*
 	 * If fsm_set_and_search found a suitable new block, return that.
@@ -180,7 +209,7 @@ RecordAndGetPageWithFreeSpace(Relation rel, BlockNumber oldPage,
 		if (fsm_does_block_exist(rel, blknum))
 			return blknum;
 	}
-	return fsm_search(rel, search_cat);
+	return fsm_search(rel, search_cat, start_offset);
 }
 
 /*
@@ -200,7 +229,7 @@ RecordPageWithFreeSpace(Relation rel, BlockNumber heapBlk, Size spaceAvail)
 	/* Get the location of the FSM byte representing the heap block */
 	addr = fsm_get_location(heapBlk, &slot);
 
-	fsm_set_and_search(rel, addr, slot, new_cat, 0);
+	fsm_set_and_search(rel, addr, slot, new_cat, 0, 0);
 }
 
 /*
@@ -644,7 +673,7 @@ fsm_extend(Relation rel, BlockNumber fsm_nblocks)
  */
 static int
 fsm_set_and_search(Relation rel, FSMAddress addr, uint16 slot,
-				   uint8 newValue, uint8 minValue)
+				   uint8 newValue, uint8 minValue, int start_offset)
 {
 	Buffer		buf;
 	Page		page;
@@ -663,7 +692,7 @@ fsm_set_and_search(Relation rel, FSMAddress addr, uint16 slot,
 		/* Search while we still hold the lock */
 		newslot = fsm_search_avail(buf, minValue,
 								   addr.level == FSM_BOTTOM_LEVEL,
-								   true);
+								   true, start_offset);
 	}
 
 	UnlockReleaseBuffer(buf);
@@ -675,7 +704,7 @@ fsm_set_and_search(Relation rel, FSMAddress addr, uint16 slot,
  * Search the tree for a heap page with at least min_cat of free space
  */
 static BlockNumber
-fsm_search(Relation rel, uint8 min_cat)
+fsm_search(Relation rel, uint8 min_cat, int start_offset)
 {
 	int			restarts = 0;
 	FSMAddress	addr = FSM_ROOT_ADDRESS;
@@ -695,7 +724,9 @@ fsm_search(Relation rel, uint8 min_cat)
 			LockBuffer(buf, BUFFER_LOCK_SHARE);
 			slot = fsm_search_avail(buf, min_cat,
 									(addr.level == FSM_BOTTOM_LEVEL),
-									false);
+									false,
+									(addr.level == FSM_BOTTOM_LEVEL) ?
+									start_offset : 0);
 			if (slot == -1)
 			{
 				max_avail = fsm_get_max_avail(BufferGetPage(buf));
@@ -776,7 +807,7 @@ fsm_search(Relation rel, uint8 min_cat)
 			 * rarely, and will be fixed by the next vacuum.
 			 */
 			parent = fsm_get_parent(addr, &parentslot);
-			fsm_set_and_search(rel, parent, parentslot, max_avail, 0);
+			fsm_set_and_search(rel, parent, parentslot, max_avail, 0, 0);
 
 			/*
 			 * If the upper pages are badly out of date, we might need to loop
@@ -153,10 +153,14 @@ fsm_get_max_avail(Page page)
  *
  * If advancenext is false, fp_next_slot is set to point to the returned
  * slot, and if it's true, to the slot after the returned slot.
+ *
+ * start_offset is added to fp_next_slot to get the slot where the search
+ * starts.  Callers that pass different offsets tend to get different slots
+ * even if they search at the same time, before fp_next_slot is advanced.
  */
 int
 fsm_search_avail(Buffer buf, uint8 minvalue, bool advancenext,
-				 bool exclusive_lock_held)
+				 bool exclusive_lock_held, int start_offset)
 {
 	Page		page = BufferGetPage(buf);
 	FSMPage		fsmpage = (FSMPage) PageGetContents(page);
@@ -181,6 +185,7 @@ restart:
 	target = fsmpage->fp_next_slot;
 	if (target < 0 || target >= LeafNodesPerPage)
 		target = 0;
+	target = (target + start_offset) % LeafNodesPerPage;
 	target += NonLeafNodesPerPage;
 
 	/*----------
@@ -99,6 +99,41 @@ typedef struct ProcArrayStruct
 	int			pgprocnos[FLEXIBLE_ARRAY_MEMBER];
 } ProcArrayStruct;
 
+/*
+ * Shared snapshot cache.
+ *
+ * Building a snapshot requires scanning the XIDs of all backends in the
+ * procarray, which gets expensive with many connections.  But as long as
+ * TransamVariables->xactCompletionCount doesn't change, neither does the
+ * result of that scan (see GetSnapshotDataReuse()).  So, if
+ * shared_snapshot_cache is enabled, a backend that had to scan the procarray
+ * publishes the result here, and other backends copy it while it's still
+ * current, instead of scanning the procarray themselves.
+ *
+ * Snapshots don't include the XID of the backend building them, so only
+ * snapshots built by backends without an XID are published, and only
+ * backends without an XID use them.
+ *
+ * Readers don't take any lock on the cache, so that they don't contend with
+ * each other.  Instead, a writer makes 'seq' odd while it updates the
+ * contents, and even again afterwards; a reader that sees 'seq' odd, or
+ * changed while it was copying the contents, just scans the procarray.  Only
+ * one writer at a time is allowed; the others don't bother publishing.
+ */
+typedef struct SnapshotCacheStruct
+{
+	pg_atomic_uint64 seq;		/* odd while the contents are being updated */
+	pg_atomic_uint32 writer;	/* 1 while somebody is updating */
+	uint64		xactCompletionCount;	/* what the snapshot is valid for, or
+										 * 0 if there's none */
+	TransactionId xmin;
+	int			xcnt;
+	int			subxcnt;
+	bool		suboverflowed;
+	/* xip array (procArray->maxProcs entries), then the subxip array */
+	TransactionId xids[FLEXIBLE_ARRAY_MEMBER];
+} SnapshotCacheStruct;
+
 /*
  * State for the GlobalVisTest* family of functions. Those functions can
  * e.g. be used to decide if a deleted row can be removed without violating
@@ -268,6 +303,11 @@ typedef enum KAXCompressReason
 
 static ProcArrayStruct *procArray;
 
+static SnapshotCacheStruct *snapshotCache;
+
+/* GUC parameter */
+bool		shared_snapshot_cache = false;
+
 static PGPROC *allProcs;
 
 /*
@@ -367,7 +407,14 @@ static void MaintainLatestCompletedXidRecovery(TransactionId latestXid);
 
 static inline FullTransactionId FullXidRelativeTo(FullTransactionId rel,
 												  TransactionId xid);
+static Size SnapshotCacheShmemSize(void);
 static void GlobalVisUpdateApply(ComputeXidHorizonsResult *horizons);
+static bool SnapshotCacheFetch(Snapshot snapshot, uint64 xactCompletionCount,
+							   TransactionId *xmin, int *xcnt, int *subxcnt,
+							   bool *suboverflowed);
+static void SnapshotCachePublish(Snapshot snapshot, uint64 xactCompletionCount,
+								 TransactionId xmin, int xcnt, int subxcnt,
+								 bool suboverflowed);
 
 /*
  * Report shared-memory space needed by ProcArrayShmemInit
@@ -408,9 +455,24 @@ ProcArrayShmemSize(void)
 						mul_size(sizeof(bool), TOTAL_MAX_CACHED_SUBXIDS));
 	}
 
+	/* The shared snapshot cache, which has room for a whole snapshot */
+	size = add_size(size, SnapshotCacheShmemSize());
+
 	return size;
 }
 
+/*
+ * Size of the shared snapshot cache
+ */
+static Size
+SnapshotCacheShmemSize(void)
+{
+	return add_size(offsetof(SnapshotCacheStruct, xids),
+					mul_size(sizeof(TransactionId),
+							 add_size(PROCARRAY_MAXPROCS,
+									  TOTAL_MAX_CACHED_SUBXIDS)));
+}
+
 /*
  * Initialize the shared PGPROC array during postmaster startup.
  */
@@ -446,6 +508,16 @@ ProcArrayShmemInit(void)
 
 	allProcs = ProcGlobal->allProcs;
 
+	snapshotCache = (SnapshotCacheStruct *)
+		ShmemInitStruct("Shared Snapshot Cache", SnapshotCacheShmemSize(),
+						&found);
+	if (!found)
+	{
+		pg_atomic_init_u64(&snapshotCache->seq, 0);
+		pg_atomic_init_u32(&snapshotCache->writer, 0);
+		snapshotCache->xactCompletionCount = 0;
+	}
+
 	/* Create or attach to the KnownAssignedXids arrays too, if needed */
 	if (EnableHotStandby)
 	{
@@ -2087,6 +2159,104 @@ GetSnapshotDataReuse(Snapshot snapshot)
 	return true;
 }
 
+/*
+ * Helper function for GetSnapshotData() that copies the running XIDs from the
+ * shared snapshot cache, if it has a snapshot for the given
+ * xactCompletionCount.  Returns false, leaving the output arguments alone, if
+ * not.
+ *
+ * Caller must hold ProcArrayLock, so that xactCompletionCount can't change.
+ */
+static bool
+SnapshotCacheFetch(Snapshot snapshot, uint64 xactCompletionCount,
+				   TransactionId *xmin, int *xcnt, int *subxcnt,
+				   bool *suboverflowed)
+{
+	SnapshotCacheStruct *cache = snapshotCache;
+	uint64		seq;
+	TransactionId cached_xmin;
+	int			nxids;
+	int			nsubxids;
+	bool		cached_suboverflowed;
+
+	Assert(LWLockHeldByMe(ProcArrayLock));
+
+	seq = pg_atomic_read_u64(&cache->seq);
+	if (seq & 1)
+		return false;			/* being updated right now */
+	pg_read_barrier();
+
+	if (cache->xactCompletionCount != xactCompletionCount)
+		return false;
+
+	cached_xmin = cache->xmin;
+	nxids = cache->xcnt;
+	nsubxids = cache->subxcnt;
+	cached_suboverflowed = cache->suboverflowed;
+
+	/*
+	 * If a writer got in after we read 'seq', these might be garbage.  We'll
+	 * detect that below, but mustn't overrun our arrays in the meantime.
+	 */
+	if (nxids < 0 || nxids > GetMaxSnapshotXidCount() ||
+		nsubxids < 0 || nsubxids > GetMaxSnapshotSubxidCount())
+		return false;
+
+	memcpy(snapshot->xip, cache->xids, nxids * sizeof(TransactionId));
+	memcpy(snapshot->subxip, cache->xids + procArray->maxProcs,
+		   nsubxids * sizeof(TransactionId));
+
+	pg_read_barrier();
+	if (pg_atomic_read_u64(&cache->seq) != seq)
+		return false;
+
+	*xmin = cached_xmin;
+	*xcnt = nxids;
+	*subxcnt = nsubxids;
+	*suboverflowed = cached_suboverflowed;
+
+	return true;
+}
+
+/*
+ * Helper function for GetSnapshotData() that stores a snapshot it built in
+ * the shared snapshot cache, unless the cache already has one that's at
+ * least as new, or somebody else is updating it.
+ */
+static void
+SnapshotCachePublish(Snapshot snapshot, uint64 xactCompletionCount,
+					 TransactionId xmin, int xcnt, int subxcnt,
+					 bool suboverflowed)
+{
+	SnapshotCacheStruct *cache = snapshotCache;
+	uint32		expected = 0;
+
+	if (!pg_atomic_compare_exchange_u32(&cache->writer, &expected, 1))
+		return;
+
+	/* xactCompletionCount never goes backwards */
+	if (cache->xactCompletionCount < xactCompletionCount)
+	{
+		/* make seq odd; this is a full barrier */
+		pg_atomic_fetch_add_u64(&cache->seq, 1);
+
+		cache->xactCompletionCount = xactCompletionCount;
+		cache->xmin = xmin;
+		cache->xcnt = xcnt;
+		cache->subxcnt = subxcnt;
+		cache->suboverflowed = suboverflowed;
+		memcpy(cache->xids, snapshot->xip, xcnt * sizeof(TransactionId));
+		memcpy(cache->xids + procArray->maxProcs, snapshot->subxip,
+			   subxcnt * sizeof(TransactionId));
+
+		/* make seq even again */
+		pg_write_barrier();
+		pg_atomic_fetch_add_u64(&cache->seq, 1);
+	}
+
+	pg_atomic_exchange_u32(&cache->writer, 0);
+}
+
 /*
  * GetSnapshotData -- returns information about running transactions.
  *
@@ -2134,6 +2304,8 @@ GetSnapshotData(Snapshot snapshot)
 	int			mypgxactoff;
 	TransactionId myxid;
 	uint64		curXactCompletionCount;
+	bool		use_cache;
+	bool		from_cache = false;
 
 	TransactionId replication_slot_xmin = InvalidTransactionId;
 	TransactionId replication_slot_catalog_xmin = InvalidTransactionId;
@@ -2206,7 +2378,18 @@ GetSnapshotData(Snapshot snapshot)
 
 	snapshot->takenDuringRecovery = RecoveryInProgress();
 
-	if (!snapshot->takenDuringRecovery)
+	/* see comments at SnapshotCacheStruct */
+	use_cache = shared_snapshot_cache && !TransactionIdIsValid(myxid) &&
+		!snapshot->takenDuringRecovery;
+
+	if (use_cache &&
+		SnapshotCacheFetch(snapshot, curXactCompletionCount,
+						   &xmin, &count, &subcount, &suboverflowed))
+	{
+		/* Another backend already collected the running XIDs for us */
+		from_cache = true;
+	}
+	else if (!snapshot->takenDuringRecovery)
 	{
 		int			numProcs = arrayP->numProcs;
 		TransactionId *xip = snapshot->xip;
@@ -2363,6 +2546,15 @@ GetSnapshotData(Snapshot snapshot)
 
 	LWLockRelease(ProcArrayLock);
 
+	/*
+	 * Let other backends use what we found.  It's fine to do this after
+	 * releasing the lock, as the snapshot is tagged with the
+	 * xactCompletionCount it was built for.
+	 */
+	if (use_cache && !from_cache)
+		SnapshotCachePublish(snapshot, curXactCompletionCount,
+							 xmin, count, subcount, suboverflowed);
+
 	/* maintain state for GlobalVis* */
 	{
 		TransactionId def_vis_xid;
@@ -37,6 +37,7 @@
 #include "access/twophase_rmgr.h"
 #include "access/xlog.h"
 #include "access/xlogutils.h"
+#include "common/hashfn.h"
 #include "miscadmin.h"
 #include "pg_trace.h"
 #include "storage/lmgr.h"
@@ -217,6 +218,28 @@ int			FastPathLockGroupsPerBackend = 0;
 #define FAST_PATH_REL_GROUP(rel) \
 	(((uint64) (rel) * 49157) & (FastPathLockGroupsPerBackend - 1))
 
+/*
+ * A relation's fast-path lock may also be stored in a second group, chosen
+ * by an independent hash function.  Queries locking many relations (such as
+ * the partitions of a partitioned table) would otherwise often find the
+ * relation's group full and fall back to the primary lock table while other
+ * groups still have free slots.  Having two candidate groups spreads the
+ * locks much more evenly.  With a single group, both are the same.
+ */
+#define FAST_PATH_REL_GROUP2(rel) \
+	(murmurhash32((uint32) (rel)) & (FastPathLockGroupsPerBackend - 1))
+
+/*
+ * Might there be a free slot for the relation (respectively, might we hold a
+ * fast-path lock on it), according to FastPathLocalUseCounts?
+ */
+#define FAST_PATH_REL_MAY_GRANT(rel) \
+	(FastPathLocalUseCounts[FAST_PATH_REL_GROUP(rel)] < FP_LOCK_SLOTS_PER_GROUP || \
+	 FastPathLocalUseCounts[FAST_PATH_REL_GROUP2(rel)] < FP_LOCK_SLOTS_PER_GROUP)
+#define FAST_PATH_REL_MAY_HOLD(rel) \
+	(FastPathLocalUseCounts[FAST_PATH_REL_GROUP(rel)] > 0 || \
+	 FastPathLocalUseCounts[FAST_PATH_REL_GROUP2(rel)] > 0)
+
 /*
  * Given the group/slot indexes, calculate the slot index in the whole array
  * of fast-path lock slots.
@@ -276,6 +299,7 @@ int			FastPathLockGroupsPerBackend = 0;
 	(locktag)->locktag_field1 != InvalidOid && \
 	(mode) > ShareUpdateExclusiveLock)
 
+static inline int FastPathRelGroups(Oid relid, uint32 *groups);
 static bool FastPathGrantRelationLock(Oid relid, LOCKMODE lockmode);
 static bool FastPathUnGrantRelationLock(Oid relid, LOCKMODE lockmode);
 static bool FastPathTransferRelationLocks(LockMethod lockMethodTable,
@@ -985,7 +1009,7 @@ LockAcquireExtended(const LOCKTAG *locktag,
 	 * for now we don't worry about that case either.
 	 */
 	if (EligibleForRelationFastPath(locktag, lockmode) &&
-		FastPathLocalUseCounts[FAST_PATH_REL_GROUP(locktag->locktag_field2)] < FP_LOCK_SLOTS_PER_GROUP)
+		FAST_PATH_REL_MAY_GRANT(locktag->locktag_field2))
 	{
 		uint32		fasthashcode = FastPathStrongLockHashPartition(hashcode);
 		bool		acquired;
@@ -2204,7 +2228,7 @@ LockRelease(const LOCKTAG *locktag, LOCKMODE lockmode, bool sessionLock)
 
 	/* Attempt fast release of any lock eligible for the fast path. */
 	if (EligibleForRelationFastPath(locktag, lockmode) &&
-		FastPathLocalUseCounts[FAST_PATH_REL_GROUP(locktag->locktag_field2)] > 0)
+		FAST_PATH_REL_MAY_HOLD(locktag->locktag_field2))
 	{
 		bool		released;
 
@@ -2774,6 +2798,20 @@ LockReassignOwner(LOCALLOCK *locallock, ResourceOwner parent)
 	ResourceOwnerForgetLock(CurrentResourceOwner, locallock);
 }
 
+/*
+ * FastPathRelGroups
+ *		Get the fast-path groups a lock on the given relation may be stored
+ *		in, and return how many there are (1 or 2).
+ */
+static inline int
+FastPathRelGroups(Oid relid, uint32 *groups)
+{
+	groups[0] = FAST_PATH_REL_GROUP(relid);
+	groups[1] = FAST_PATH_REL_GROUP2(relid);
+
+	return (groups[0] == groups[1]) ? 1 : 2;
+}
+
 /*
  * FastPathGrantRelationLock
  *		Grant lock using per-backend fast-path array, if there is space.
@@ -2783,23 +2821,40 @@ FastPathGrantRelationLock(Oid relid, LOCKMODE lockmode)
 {
 	uint32		i;
 	uint32		unused_slot = FastPathLockSlotsPerBackend();
+	uint32		unused_group = 0;
 
-	/* fast-path group the lock belongs to */
-	uint32		group = FAST_PATH_REL_GROUP(relid);
+	/* fast-path groups the lock may belong to */
+	uint32		groups[2];
+	int			ngroups = FastPathRelGroups(relid, groups);
 
-	/* Scan for existing entry for this relid, remembering empty slot. */
-	for (i = 0; i < FP_LOCK_SLOTS_PER_GROUP; i++)
+	/*
+	 * Scan for existing entry for this relid, remembering an empty slot,
+	 * preferably in the less used group.
+	 */
+	for (int g = 0; g < ngroups; g++)
 	{
-		/* index into the whole per-backend array */
-		uint32		f = FAST_PATH_SLOT(group, i);
+		uint32		group = groups[g];
 
-		if (FAST_PATH_GET_BITS(MyProc, f) == 0)
-			unused_slot = f;
-		else if (MyProc->fpRelId[f] == relid)
+		for (i = 0; i < FP_LOCK_SLOTS_PER_GROUP; i++)
 		{
-			Assert(!FAST_PATH_CHECK_LOCKMODE(MyProc, f, lockmode));
-			FAST_PATH_SET_LOCKMODE(MyProc, f, lockmode);
-			return true;
+			/* index into the whole per-backend array */
+			uint32		f = FAST_PATH_SLOT(group, i);
+
+			if (FAST_PATH_GET_BITS(MyProc, f) == 0)
+			{
+				if (unused_slot == FastPathLockSlotsPerBackend() ||
+					FastPathLocalUseCounts[group] < FastPathLocalUseCounts[unused_group])
+				{
+					unused_slot = f;
+					unused_group = group;
+				}
+			}
+			else if (MyProc->fpRelId[f] == relid)
+			{
+				Assert(!FAST_PATH_CHECK_LOCKMODE(MyProc, f, lockmode));
+				FAST_PATH_SET_LOCKMODE(MyProc, f, lockmode);
+				return true;
+			}
 		}
 	}
 
@@ -2808,7 +2863,7 @@ FastPathGrantRelationLock(Oid relid, LOCKMODE lockmode)
 	{
 		MyProc->fpRelId[unused_slot] = relid;
 		FAST_PATH_SET_LOCKMODE(MyProc, unused_slot, lockmode);
-		++FastPathLocalUseCounts[group];
+		++FastPathLocalUseCounts[unused_group];
 		return true;
 	}
 
@@ -2819,7 +2874,7 @@ FastPathGrantRelationLock(Oid relid, LOCKMODE lockmode)
 /*
  * FastPathUnGrantRelationLock
  *		Release fast-path lock, if present.  Update backend-private local
- *		use count, while we're at it.
+ *		use counts, while we're at it.
  */
 static bool
 FastPathUnGrantRelationLock(Oid relid, LOCKMODE lockmode)
@@ -2827,25 +2882,31 @@ FastPathUnGrantRelationLock(Oid relid, LOCKMODE lockmode)
 	uint32		i;
 	bool		result = false;
 
-	/* fast-path group the lock belongs to */
-	uint32		group = FAST_PATH_REL_GROUP(relid);
+	/* fast-path groups the lock may belong to */
+	uint32		groups[2];
+	int			ngroups = FastPathRelGroups(relid, groups);
 
-	FastPathLocalUseCounts[group] = 0;
-	for (i = 0; i < FP_LOCK_SLOTS_PER_GROUP; i++)
+	for (int g = 0; g < ngroups; g++)
 	{
-		/* index into the whole per-backend array */
-		uint32		f = FAST_PATH_SLOT(group, i);
+		uint32		group = groups[g];
 
-		if (MyProc->fpRelId[f] == relid
-			&& FAST_PATH_CHECK_LOCKMODE(MyProc, f, lockmode))
+		FastPathLocalUseCounts[group] = 0;
+		for (i = 0; i < FP_LOCK_SLOTS_PER_GROUP; i++)
 		{
-			Assert(!result);
-			FAST_PATH_CLEAR_LOCKMODE(MyProc, f, lockmode);
-			result = true;
-			/* we continue iterating so as to update FastPathLocalUseCount */
+			/* index into the whole per-backend array */
+			uint32		f = FAST_PATH_SLOT(group, i);
+
+			if (MyProc->fpRelId[f] == relid
+				&& FAST_PATH_CHECK_LOCKMODE(MyProc, f, lockmode))
+			{
+				Assert(!result);
+				FAST_PATH_CLEAR_LOCKMODE(MyProc, f, lockmode);
+				result = true;
+				/* we continue iterating so as to update FastPathLocalUseCount */
+			}
+			if (FAST_PATH_GET_BITS(MyProc, f) != 0)
+				++FastPathLocalUseCounts[group];
 		}
-		if (FAST_PATH_GET_BITS(MyProc, f) != 0)
-			++FastPathLocalUseCounts[group];
 	}
 	return result;
 }
@@ -2865,8 +2926,9 @@ FastPathTransferRelationLocks(LockMethod lockMethodTable, const LOCKTAG *locktag
 	Oid			relid = locktag->locktag_field2;
 	uint32		i;
 
-	/* fast-path group the lock belongs to */
-	uint32		group = FAST_PATH_REL_GROUP(relid);
+	/* fast-path groups the lock may belong to */
+	uint32		groups[2];
+	int			ngroups = FastPathRelGroups(relid, groups);
 
 	/*
 	 * Every PGPROC that can potentially hold a fast-path lock is present in
@@ -2877,7 +2939,7 @@ FastPathTransferRelationLocks(LockMethod lockMethodTable, const LOCKTAG *locktag
 	for (i = 0; i < ProcGlobal->allProcCount; i++)
 	{
 		PGPROC	   *proc = &ProcGlobal->allProcs[i];
-		uint32		j;
+		bool		found = false;
 
 		LWLockAcquire(&proc->fpInfoLock, LW_EXCLUSIVE);
 
@@ -2895,52 +2957,60 @@ FastPathTransferRelationLocks(LockMethod lockMethodTable, const LOCKTAG *locktag
 		 * less clear that our backend is certain to have performed a memory
 		 * fencing operation since the other backend set proc->databaseId.  So
 		 * for now, we test it after acquiring the LWLock just to be safe.
-		 *
-		 * Also skip groups without any registered fast-path locks.
 		 */
-		if (proc->databaseId != locktag->locktag_field1 ||
-			proc->fpLockBits[group] == 0)
+		if (proc->databaseId != locktag->locktag_field1)
 		{
 			LWLockRelease(&proc->fpInfoLock);
 			continue;
 		}
 
-		for (j = 0; j < FP_LOCK_SLOTS_PER_GROUP; j++)
+		for (int g = 0; g < ngroups && !found; g++)
 		{
-			uint32		lockmode;
-
-			/* index into the whole per-backend array */
-			uint32		f = FAST_PATH_SLOT(group, j);
+			uint32		group = groups[g];
+			uint32		j;
 
-			/* Look for an allocated slot matching the given relid. */
-			if (relid != proc->fpRelId[f] || FAST_PATH_GET_BITS(proc, f) == 0)
+			/* Skip groups without any registered fast-path locks. */
+			if (proc->fpLockBits[group] == 0)
 				continue;
 
-			/* Find or create lock object. */
-			LWLockAcquire(partitionLock, LW_EXCLUSIVE);
-			for (lockmode = FAST_PATH_LOCKNUMBER_OFFSET;
-				 lockmode < FAST_PATH_LOCKNUMBER_OFFSET + FAST_PATH_BITS_PER_SLOT;
-				 ++lockmode)
+			for (j = 0; j < FP_LOCK_SLOTS_PER_GROUP; j++)
 			{
-				PROCLOCK   *proclock;
+				uint32		lockmode;
 
-				if (!FAST_PATH_CHECK_LOCKMODE(proc, f, lockmode))
+				/* index into the whole per-backend array */
+				uint32		f = FAST_PATH_SLOT(group, j);
+
+				/* Look for an allocated slot matching the given relid. */
+				if (relid != proc->fpRelId[f] || FAST_PATH_GET_BITS(proc, f) == 0)
 					continue;
-				proclock = SetupLockInTable(lockMethodTable, proc, locktag,
-											hashcode, lockmode);
-				if (!proclock)
+
+				/* Find or create lock object. */
+				LWLockAcquire(partitionLock, LW_EXCLUSIVE);
+				for (lockmode = FAST_PATH_LOCKNUMBER_OFFSET;
+					 lockmode < FAST_PATH_LOCKNUMBER_OFFSET + FAST_PATH_BITS_PER_SLOT;
+					 ++lockmode)
 				{
-					LWLockRelease(partitionLock);
-					LWLockRelease(&proc->fpInfoLock);
-					return false;
+					PROCLOCK   *proclock;
+
+					if (!FAST_PATH_CHECK_LOCKMODE(proc, f, lockmode))
+						continue;
+					proclock = SetupLockInTable(lockMethodTable, proc, locktag,
+												hashcode, lockmode);
+					if (!proclock)
+					{
+						LWLockRelease(partitionLock);
+						LWLockRelease(&proc->fpInfoLock);
+						return false;
+					}
+					GrantLock(proclock->tag.myLock, proclock, lockmode);
+					FAST_PATH_CLEAR_LOCKMODE(proc, f, lockmode);
 				}
-				GrantLock(proclock->tag.myLock, proclock, lockmode);
-				FAST_PATH_CLEAR_LOCKMODE(proc, f, lockmode);
-			}
-			LWLockRelease(partitionLock);
+				LWLockRelease(partitionLock);
 
-			/* No need to examine remaining slots. */
-			break;
+				/* No need to examine remaining slots. */
+				found = true;
+				break;
+			}
 		}
 		LWLockRelease(&proc->fpInfoLock);
 	}
@@ -2962,51 +3032,60 @@ FastPathGetRelationLockEntry(LOCALLOCK *locallock)
 	PROCLOCK   *proclock = NULL;
 	LWLock	   *partitionLock = LockHashPartitionLock(locallock->hashcode);
 	Oid			relid = locktag->locktag_field2;
-	uint32		i,
-				group;
+	uint32		i;
+	bool		found = false;
 
-	/* fast-path group the lock belongs to */
-	group = FAST_PATH_REL_GROUP(relid);
+	/* fast-path groups the lock may belong to */
+	uint32		groups[2];
+	int			ngroups = FastPathRelGroups(relid, groups);
 
 	LWLockAcquire(&MyProc->fpInfoLock, LW_EXCLUSIVE);
 
-	for (i = 0; i < FP_LOCK_SLOTS_PER_GROUP; i++)
+	for (int g = 0; g < ngroups && !found; g++)
 	{
-		uint32		lockmode;
+		uint32		group = groups[g];
 
-		/* index into the whole per-backend array */
-		uint32		f = FAST_PATH_SLOT(group, i);
+		for (i = 0; i < FP_LOCK_SLOTS_PER_GROUP; i++)
+		{
+			uint32		lockmode;
 
-		/* Look for an allocated slot matching the given relid. */
-		if (relid != MyProc->fpRelId[f] || FAST_PATH_GET_BITS(MyProc, f) == 0)
-			continue;
+			/* index into the whole per-backend array */
+			uint32		f = FAST_PATH_SLOT(group, i);
 
-		/* If we don't have a lock of the given mode, forget it! */
-		lockmode = locallock->tag.mode;
-		if (!FAST_PATH_CHECK_LOCKMODE(MyProc, f, lockmode))
-			break;
+			/* Look for an allocated slot matching the given relid. */
+			if (relid != MyProc->fpRelId[f] || FAST_PATH_GET_BITS(MyProc, f) == 0)
+				continue;
 
-		/* Find or create lock object. */
-		LWLockAcquire(partitionLock, LW_EXCLUSIVE);
+			/* There can only be one entry per relation. */
+			found = true;
 
-		proclock = SetupLockInTable(lockMethodTable, MyProc, locktag,
-									locallock->hashcode, lockmode);
-		if (!proclock)
-		{
-			LWLockRelease(partitionLock);
-			LWLockRelease(&MyProc->fpInfoLock);
-			ereport(ERROR,
-					(errcode(ERRCODE_OUT_OF_MEMORY),
-					 errmsg("out of shared memory"),
-					 errhint("You might need to increase \"%s\".", "max_locks_per_transaction")));
-		}
-		GrantLock(proclock->tag.myLock, proclock, lockmode);
-		FAST_PATH_CLEAR_LOCKMODE(MyProc, f, lockmode);
+			/* If we don't have a lock of the given mode, forget it! */
+			lockmode = locallock->tag.mode;
+			if (!FAST_PATH_CHECK_LOCKMODE(MyProc, f, lockmode))
+				break;
 
-		LWLockRelease(partitionLock);
+			/* Find or create lock object. */
+			LWLockAcquire(partitionLock, LW_EXCLUSIVE);
+
+			proclock = SetupLockInTable(lockMethodTable, MyProc, locktag,
+										locallock->hashcode, lockmode);
+			if (!proclock)
+			{
+				LWLockRelease(partitionLock);
+				LWLockRelease(&MyProc->fpInfoLock);
+				ereport(ERROR,
+						(errcode(ERRCODE_OUT_OF_MEMORY),
+						 errmsg("out of shared memory"),
+						 errhint("You might need to increase \"%s\".", "max_locks_per_transaction")));
+			}
+			GrantLock(proclock->tag.myLock, proclock, lockmode);
+			FAST_PATH_CLEAR_LOCKMODE(MyProc, f, lockmode);
 
-		/* No need to examine remaining slots. */
-		break;
+			LWLockRelease(partitionLock);
+
+			/* No need to examine remaining slots. */
+			break;
+		}
 	}
 
 	LWLockRelease(&MyProc->fpInfoLock);
@@ -3120,8 +3199,9 @@ GetLockConflicts(const LOCKTAG *locktag, LOCKMODE lockmode, int *countp)
 		Oid			relid = locktag->locktag_field2;
 		VirtualTransactionId vxid;
 
-		/* fast-path group the lock belongs to */
-		uint32		group = FAST_PATH_REL_GROUP(relid);
+		/* fast-path groups the lock may belong to */
+		uint32		groups[2];
+		int			ngroups = FastPathRelGroups(relid, groups);
 
 		/*
 		 * Iterate over relevant PGPROCs.  Anything held by a prepared
@@ -3136,7 +3216,7 @@ GetLockConflicts(const LOCKTAG *locktag, LOCKMODE lockmode, int *countp)
 		for (i = 0; i < ProcGlobal->allProcCount; i++)
 		{
 			PGPROC	   *proc = &ProcGlobal->allProcs[i];
-			uint32		j;
+			bool		found = false;
 
 			/* A backend never blocks itself */
 			if (proc == MyProc)
@@ -3151,47 +3231,55 @@ GetLockConflicts(const LOCKTAG *locktag, LOCKMODE lockmode, int *countp)
 			 *
 			 * See FastPathTransferRelationLocks() for discussion of why we do
 			 * this test after acquiring the lock.
-			 *
-			 * Also skip groups without any registered fast-path locks.
 			 */
-			if (proc->databaseId != locktag->locktag_field1 ||
-				proc->fpLockBits[group] == 0)
+			if (proc->databaseId != locktag->locktag_field1)
 			{
 				LWLockRelease(&proc->fpInfoLock);
 				continue;
 			}
 
-			for (j = 0; j < FP_LOCK_SLOTS_PER_GROUP; j++)
+			for (int g = 0; g < ngroups && !found; g++)
 			{
-				uint32		lockmask;
-
-				/* index into the whole per-backend array */
-				uint32		f = FAST_PATH_SLOT(group, j);
+				uint32		group = groups[g];
+				uint32		j;
 
-				/* Look for an allocated slot matching the given relid. */
-				if (relid != proc->fpRelId[f])
-					continue;
-				lockmask = FAST_PATH_GET_BITS(proc, f);
-				if (!lockmask)
+				/* Skip groups without any registered fast-path locks. */
+				if (proc->fpLockBits[group] == 0)
 					continue;
-				lockmask <<= FAST_PATH_LOCKNUMBER_OFFSET;
 
-				/*
-				 * There can only be one entry per relation, so if we found it
-				 * and it doesn't conflict, we can skip the rest of the slots.
-				 */
-				if ((lockmask & conflictMask) == 0)
-					break;
-
-				/* Conflict! */
-				GET_VXID_FROM_PGPROC(vxid, *proc);
-
-				if (VirtualTransactionIdIsValid(vxid))
-					vxids[count++] = vxid;
-				/* else, xact already committed or aborted */
+				for (j = 0; j < FP_LOCK_SLOTS_PER_GROUP; j++)
+				{
+					uint32		lockmask;
+
+					/* index into the whole per-backend array */
+					uint32		f = FAST_PATH_SLOT(group, j);
+
+					/* Look for an allocated slot matching the given relid. */
+					if (relid != proc->fpRelId[f])
+						continue;
+					lockmask = FAST_PATH_GET_BITS(proc, f);
+					if (!lockmask)
+						continue;
+					lockmask <<= FAST_PATH_LOCKNUMBER_OFFSET;
+
+					/*
+					 * There can only be one entry per relation, so once we
+					 * found it we can skip the rest of the slots.
+					 */
+					found = true;
+					if ((lockmask & conflictMask) == 0)
+						break;
+
+					/* Conflict! */
+					GET_VXID_FROM_PGPROC(vxid, *proc);
+
+					if (VirtualTransactionIdIsValid(vxid))
+						vxids[count++] = vxid;
+					/* else, xact already committed or aborted */
 
-				/* No need to examine remaining slots. */
-				break;
+					/* No need to examine remaining slots. */
+					break;
+				}
 			}
 
 			LWLockRelease(&proc->fpInfoLock);
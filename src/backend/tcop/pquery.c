@@ -37,6 +37,8 @@ Portal		ActivePortal = NULL;
 
 
 static void ProcessQuery(PlannedStmt *plan,
+						 CachedPlan *cplan,
+						 int cplan_generation,
 						 const char *sourceText,
 						 ParamListInfo params,
 						 QueryEnvironment *queryEnv,
@@ -86,6 +88,8 @@ CreateQueryDesc(PlannedStmt *plannedstmt,
 	qd->params = params;		/* parameter values passed into query */
 	qd->queryEnv = queryEnv;
 	qd->instrument_options = instrument_options;	/* instrumentation wanted? */
+	qd->cplan = NULL;			/* not from a CachedPlan, unless caller says so */
+	qd->cplan_generation = 0;
 
 	/* null these fields until set by ExecutorStart */
 	qd->tupDesc = NULL;
@@ -123,6 +127,8 @@ FreeQueryDesc(QueryDesc *qdesc)
  *		PORTAL_ONE_RETURNING, or PORTAL_ONE_MOD_WITH portal
  *
  *	plan: the plan tree for the query
+ *	cplan: the CachedPlan the plan belongs to, or NULL
+ *	cplan_generation: its lock generation, as saved by the portal
  *	sourceText: the source text of the query
  *	params: any parameters needed
  *	dest: where to send results
@@ -135,6 +141,8 @@ FreeQueryDesc(QueryDesc *qdesc)
  */
 static void
 ProcessQuery(PlannedStmt *plan,
+			 CachedPlan *cplan,
+			 int cplan_generation,
 			 const char *sourceText,
 			 ParamListInfo params,
 			 QueryEnvironment *queryEnv,
@@ -149,6 +157,8 @@ ProcessQuery(PlannedStmt *plan,
 	queryDesc = CreateQueryDesc(plan, sourceText,
 								GetActiveSnapshot(), InvalidSnapshot,
 								dest, params, queryEnv, 0);
+	queryDesc->cplan = cplan;
+	queryDesc->cplan_generation = cplan_generation;
 
 	/*
 	 * Call ExecutorStart to prepare the plan for execution
@@ -501,6 +511,8 @@ PortalStart(Portal portal, ParamListInfo params,
 											params,
 											portal->queryEnv,
 											0);
+				queryDesc->cplan = portal->cplan;
+				queryDesc->cplan_generation = portal->cplan_generation;
 
 				/*
 				 * If it's a scrollable cursor, executor needs to support
@@ -1270,6 +1282,8 @@ PortalRunMulti(Portal portal,
 			{
 				/* statement can set tag string */
 				ProcessQuery(pstmt,
+							 portal->cplan,
+							 portal->cplan_generation,
 							 portal->sourceText,
 							 portal->portalParams,
 							 portal->queryEnv,
@@ -1279,6 +1293,8 @@ PortalRunMulti(Portal portal,
 			{
 				/* stmt added by rewrite cannot set tag */
 				ProcessQuery(pstmt,
+							 portal->cplan,
+							 portal->cplan_generation,
 							 portal->sourceText,
 							 portal->portalParams,
 							 portal->queryEnv,
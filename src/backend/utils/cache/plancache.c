@@ -58,11 +58,13 @@
 
 #include "access/transam.h"
 #include "catalog/namespace.h"
+#include "executor/execPartition.h"
 #include "executor/executor.h"
 #include "miscadmin.h"
 #include "nodes/nodeFuncs.h"
 #include "optimizer/optimizer.h"
 #include "parser/analyze.h"
+#include "parser/parsetree.h"
 #include "rewrite/rewriteHandler.h"
 #include "storage/lmgr.h"
 #include "tcop/pquery.h"
@@ -93,14 +95,21 @@ static bool StmtPlanRequiresRevalidation(CachedPlanSource *plansource);
 static bool BuildingPlanRequiresSnapshot(CachedPlanSource *plansource);
 static List *RevalidateCachedQuery(CachedPlanSource *plansource,
 								   QueryEnvironment *queryEnv);
-static bool CheckCachedPlan(CachedPlanSource *plansource);
+static bool CheckCachedPlan(CachedPlanSource *plansource,
+							ParamListInfo boundParams);
 static CachedPlan *BuildCachedPlan(CachedPlanSource *plansource, List *qlist,
 								   ParamListInfo boundParams, QueryEnvironment *queryEnv);
 static bool choose_custom_plan(CachedPlanSource *plansource,
 							   ParamListInfo boundParams);
 static double cached_plan_cost(CachedPlan *plan, bool include_planner);
 static Query *QueryListGetPrimaryStmt(List *stmts);
-static void AcquireExecutorLocks(List *stmt_list, bool acquire);
+static List *AcquireExecutorLocks(CachedPlan *plan,
+								  ParamListInfo boundParams);
+static Bitmapset *LockUnprunedPartitions(CachedPlan *plan,
+										 PlannedStmt *plannedstmt,
+										 Bitmapset *prunable,
+										 ParamListInfo boundParams);
+static void ReleaseExecutorLocks(List *stmt_list, List *pruned_relids);
 static void AcquirePlannerLocks(List *stmt_list, bool acquire);
 static void ScanQueryForLocks(Query *parsetree, bool acquire);
 static bool ScanQueryWalker(Node *node, bool *acquire);
@@ -134,8 +143,9 @@ ResourceOwnerForgetPlanCacheRef(ResourceOwner owner, CachedPlan *plan)
 }
 
 
-/* GUC parameter */
+/* GUC parameters */
 int			plan_cache_mode = PLAN_CACHE_MODE_AUTO;
+double		plan_cache_misestimate_factor = 0;
 
 /*
  * InitPlanCache: initialize module during InitPostgres.
@@ -947,9 +957,10 @@ RevalidateCachedQuery(CachedPlanSource *plansource,
  * (We must do this for the "true" result to be race-condition-free.)
  */
 static bool
-CheckCachedPlan(CachedPlanSource *plansource)
+CheckCachedPlan(CachedPlanSource *plansource, ParamListInfo boundParams)
 {
 	CachedPlan *plan = plansource->gplan;
+	List	   *pruned_relids;
 
 	/* Assert that caller checked the querytree */
 	Assert(plansource->is_valid);
@@ -981,7 +992,14 @@ CheckCachedPlan(CachedPlanSource *plansource)
 		 */
 		Assert(plan->refcount > 0);
 
-		AcquireExecutorLocks(plan->stmt_list, true);
+		pruned_relids = AcquireExecutorLocks(plan, boundParams);
+
+		/*
+		 * Note that AcquireExecutorLocks() locks the partitions that survive
+		 * initial pruning only after checking which ones those are, so the
+		 * check below is what catches invalidations received while locking
+		 * them.
+		 */
 
 		/*
 		 * If plan was transient, check to see if TransactionXmin has
@@ -1003,7 +1021,8 @@ CheckCachedPlan(CachedPlanSource *plansource)
 		}
 
 		/* Oops, the race case happened.  Release useless locks. */
-		AcquireExecutorLocks(plan->stmt_list, false);
+		ReleaseExecutorLocks(plan->stmt_list, pruned_relids);
+		plan->prune_results = NIL;
 	}
 
 	/*
@@ -1130,6 +1149,8 @@ BuildCachedPlan(CachedPlanSource *plansource, List *qlist,
 	 */
 	plan->planRoleId = GetUserId();
 	plan->dependsOnRole = plansource->dependsOnRLS;
+	plan->num_misestimates = 0;
+	plan->num_misestimate_skips = 0;
 	is_transient = false;
 	foreach(lc, plist)
 	{
@@ -1155,6 +1176,9 @@ BuildCachedPlan(CachedPlanSource *plansource, List *qlist,
 	plan->is_oneshot = plansource->is_oneshot;
 	plan->is_saved = false;
 	plan->is_valid = true;
+	plan->lock_generation = 0;
+	plan->prune_results = NIL;
+	plan->prune_context = NULL;
 
 	/* assign generation number to new plan */
 	plan->generation = ++(plansource->generation);
@@ -1197,6 +1221,21 @@ choose_custom_plan(CachedPlanSource *plansource, ParamListInfo boundParams)
 	if (plansource->cursor_options & CURSOR_OPT_CUSTOM_PLAN)
 		return true;
 
+	/*
+	 * If the generic plan turned out to be built on badly wrong row counts
+	 * in several executions in a row, stop using it for a while.  When we
+	 * give it another chance, a single further misestimate is enough to put
+	 * it aside again, while one good execution clears its record.
+	 */
+	if (plansource->gplan &&
+		plansource->gplan->num_misestimates >= PLAN_CACHE_MISESTIMATE_EXECUTIONS)
+	{
+		if (++plansource->gplan->num_misestimate_skips < PLAN_CACHE_MISESTIMATE_RETRY)
+			return true;
+		plansource->gplan->num_misestimate_skips = 0;
+		plansource->gplan->num_misestimates = PLAN_CACHE_MISESTIMATE_EXECUTIONS - 1;
+	}
+
 	/* Generate custom plans until we have done at least 5 (arbitrary) */
 	if (plansource->num_custom_plans < 5)
 		return true;
@@ -1281,7 +1320,10 @@ cached_plan_cost(CachedPlan *plan, bool include_planner)
  * which it will get.
  *
  * On return, the plan is valid and we have sufficient locks to begin
- * execution.
+ * execution.  A caller that executes the plan should save the plan's
+ * lock_generation right away and pass it to the executor together with the
+ * plan (see QueryDesc), so that the executor can use the initial pruning
+ * results computed while locking it.
  *
  * On return, the refcount of the plan has been incremented; a later
  * ReleaseCachedPlan() call is expected.  If "owner" is not NULL then
@@ -1315,7 +1357,7 @@ GetCachedPlan(CachedPlanSource *plansource, ParamListInfo boundParams,
 
 	if (!customplan)
 	{
-		if (CheckCachedPlan(plansource))
+		if (CheckCachedPlan(plansource, boundParams))
 		{
 			/* We want a generic plan, and we already have a valid one */
 			plan = plansource->gplan;
@@ -1444,6 +1486,62 @@ ReleaseCachedPlan(CachedPlan *plan, ResourceOwner owner)
 	}
 }
 
+/*
+ * CachedPlanNoteEstimate: record whether an execution of a cached plan saw
+ * far more rows than the planner estimated somewhere in the plan tree.
+ *
+ * This is called from ExecutorEnd; see plan_cache_misestimate_factor.  We
+ * count consecutive misestimated executions, which choose_custom_plan()
+ * compares with PLAN_CACHE_MISESTIMATE_EXECUTIONS.
+ */
+void
+CachedPlanNoteEstimate(CachedPlan *plan, bool misestimated)
+{
+	Assert(plan->magic == CACHEDPLAN_MAGIC);
+	if (!misestimated)
+		plan->num_misestimates = 0;
+	else if (plan->num_misestimates < PLAN_CACHE_MISESTIMATE_EXECUTIONS)
+		plan->num_misestimates++;
+}
+
+/*
+ * CachedPlanTakePruneResult: get the result of the initial pruning done for
+ * one of the statements of a generic plan by AcquireExecutorLocks.
+ *
+ * This is called from ExecDoInitialPruning, which uses the result instead of
+ * doing the pruning again.  "generation" is the plan's lock_generation as
+ * GetCachedPlan returned it to the caller that is now executing the plan;
+ * if the plan has been locked again since, for a nested execution, the
+ * results belong to that one and we return NULL.  A result is also only
+ * returned once.  Returns NULL if there's no suitable result, in which case
+ * the executor has to do the pruning itself.
+ */
+InitialPruneResult *
+CachedPlanTakePruneResult(CachedPlan *plan, int generation,
+						  PlannedStmt *plannedstmt)
+{
+	ListCell   *lc;
+
+	Assert(plan->magic == CACHEDPLAN_MAGIC);
+
+	if (plan->lock_generation != generation)
+		return NULL;
+
+	foreach(lc, plan->prune_results)
+	{
+		InitialPruneResult *result = (InitialPruneResult *) lfirst(lc);
+
+		if (result->plannedstmt == plannedstmt)
+		{
+			plan->prune_results = foreach_delete_current(plan->prune_results,
+														 lc);
+			return result;
+		}
+	}
+
+	return NULL;
+}
+
 /*
  * CachedPlanAllowsSimpleValidityCheck: can we use CachedPlanIsSimplyValid?
  *
@@ -1903,18 +2001,36 @@ QueryListGetPrimaryStmt(List *stmts)
 }
 
 /*
- * AcquireExecutorLocks: acquire locks needed for execution of a cached plan;
- * or release them if acquire is false.
+ * AcquireExecutorLocks: acquire locks needed for execution of a cached plan.
+ *
+ * Leaf partitions that the executor may remove by initial pruning are only
+ * locked if they survive that pruning with the given boundParams; see
+ * LockUnprunedPartitions.  Returns a list parallel to plan->stmt_list, with
+ * the set of RT indexes of the pruned partitions of each statement, which
+ * must be passed to ReleaseExecutorLocks to release the locks again.
+ *
+ * The pruning results are saved in the plan, for the executor to pick up with
+ * CachedPlanTakePruneResult.
  */
-static void
-AcquireExecutorLocks(List *stmt_list, bool acquire)
+static List *
+AcquireExecutorLocks(CachedPlan *plan, ParamListInfo boundParams)
 {
+	List	   *pruned_relids = NIL;
 	ListCell   *lc1;
 
-	foreach(lc1, stmt_list)
+	/* Forget the results of the previous execution's pruning */
+	if (plan->prune_context)
+		MemoryContextReset(plan->prune_context);
+	plan->prune_results = NIL;
+	plan->lock_generation++;
+
+	foreach(lc1, plan->stmt_list)
 	{
 		PlannedStmt *plannedstmt = lfirst_node(PlannedStmt, lc1);
+		Bitmapset  *prunable = NULL;
+		Bitmapset  *pruned = NULL;
 		ListCell   *lc2;
+		Index		rti;
 
 		if (plannedstmt->commandType == CMD_UTILITY)
 		{
@@ -1928,28 +2044,159 @@ AcquireExecutorLocks(List *stmt_list, bool acquire)
 			Query	   *query = UtilityContainsQuery(plannedstmt->utilityStmt);
 
 			if (query)
-				ScanQueryForLocks(query, acquire);
+				ScanQueryForLocks(query, true);
+			pruned_relids = lappend(pruned_relids, NULL);
 			continue;
 		}
 
+		rti = 0;
 		foreach(lc2, plannedstmt->rtable)
 		{
 			RangeTblEntry *rte = (RangeTblEntry *) lfirst(lc2);
 
+			rti++;
 			if (!(rte->rtekind == RTE_RELATION ||
 				  (rte->rtekind == RTE_SUBQUERY && OidIsValid(rte->relid))))
 				continue;
 
+			/* Leave partitions that may be pruned for later. */
+			if (!bms_is_member(rti, plannedstmt->unprunableRelids))
+			{
+				prunable = bms_add_member(prunable, rti);
+				continue;
+			}
+
 			/*
 			 * Acquire the appropriate type of lock on each relation OID. Note
 			 * that we don't actually try to open the rel, and hence will not
 			 * fail if it's been dropped entirely --- we'll just transiently
 			 * acquire a non-conflicting lock.
 			 */
-			if (acquire)
-				LockRelationOid(rte->relid, rte->rellockmode);
-			else
-				UnlockRelationOid(rte->relid, rte->rellockmode);
+			LockRelationOid(rte->relid, rte->rellockmode);
+		}
+
+		if (prunable != NULL)
+			pruned = LockUnprunedPartitions(plan, plannedstmt, prunable,
+											boundParams);
+		pruned_relids = lappend(pruned_relids, pruned);
+	}
+
+	return pruned_relids;
+}
+
+/*
+ * LockUnprunedPartitions: lock the prunable leaf partitions of a statement
+ * in a cached plan that survive initial pruning, and return the set of RT
+ * indexes of those that don't.
+ *
+ * A generic plan for a lookup in a table with thousands of partitions
+ * contains all of them, but the executor's initial pruning will usually
+ * throw away all but a few.  The pruned ones are never opened, so there is
+ * no need to lock them, just as a custom plan wouldn't have contained them
+ * in the first place; and taking thousands of locks, which won't all fit in
+ * the fast-path slots, easily dominates the cost of such a query.  We run
+ * the same initial pruning steps as ExecDoInitialPruning() here to find out
+ * which partitions will survive, and add the result to plan->prune_results
+ * so that ExecDoInitialPruning() can use it rather than doing the same work
+ * again.
+ *
+ * That requires the plan to be valid with respect to the relations locked
+ * so far, and an active snapshot.  We also lock all of the partitions if the
+ * pruning steps call stable functions, because the executor will run them
+ * again under its own snapshot and might find other partitions to keep,
+ * which it would then have to lock after the plan's validity was checked.
+ * As it is, the executor never needs a lock we didn't take, so an
+ * invalidation received while locking is always seen by CheckCachedPlan,
+ * which makes GetCachedPlan build a new plan.  If the plan has already been
+ * invalidated, we don't lock any, since the caller is going to throw it away.
+ * Locking the surviving partitions may itself invalidate the plan; the
+ * caller must check plan->is_valid afterwards.
+ */
+static Bitmapset *
+LockUnprunedPartitions(CachedPlan *plan, PlannedStmt *plannedstmt,
+					   Bitmapset *prunable, ParamListInfo boundParams)
+{
+	Bitmapset  *unpruned;
+	int			rti;
+
+	if (!plan->is_valid)
+		return prunable;
+
+	unpruned = prunable;
+	if (ActiveSnapshotSet())
+	{
+		InitialPruneResult *result;
+		MemoryContext oldcxt;
+
+		if (plan->prune_context == NULL)
+			plan->prune_context = AllocSetContextCreate(plan->context,
+														"CachedPlan pruning results",
+														ALLOCSET_SMALL_SIZES);
+		oldcxt = MemoryContextSwitchTo(plan->prune_context);
+		result = ExecGetInitialPruneResult(plannedstmt, boundParams);
+		if (result)
+		{
+			plan->prune_results = lappend(plan->prune_results, result);
+			unpruned = result->unpruned_relids;
+		}
+		MemoryContextSwitchTo(oldcxt);
+	}
+
+	rti = -1;
+	while ((rti = bms_next_member(prunable, rti)) >= 0)
+	{
+		RangeTblEntry *rte;
+
+		if (!bms_is_member(rti, unpruned))
+			continue;
+
+		rte = rt_fetch(rti, plannedstmt->rtable);
+		LockRelationOid(rte->relid, rte->rellockmode);
+	}
+
+	return bms_difference(prunable, unpruned);
+}
+
+/*
+ * ReleaseExecutorLocks: release the locks acquired by AcquireExecutorLocks.
+ *
+ * pruned_relids is the list returned by AcquireExecutorLocks.
+ */
+static void
+ReleaseExecutorLocks(List *stmt_list, List *pruned_relids)
+{
+	ListCell   *lc1;
+	ListCell   *lc2;
+
+	forboth(lc1, stmt_list, lc2, pruned_relids)
+	{
+		PlannedStmt *plannedstmt = lfirst_node(PlannedStmt, lc1);
+		Bitmapset  *pruned = (Bitmapset *) lfirst(lc2);
+		ListCell   *lc3;
+		Index		rti;
+
+		if (plannedstmt->commandType == CMD_UTILITY)
+		{
+			Query	   *query = UtilityContainsQuery(plannedstmt->utilityStmt);
+
+			if (query)
+				ScanQueryForLocks(query, false);
+			continue;
+		}
+
+		rti = 0;
+		foreach(lc3, plannedstmt->rtable)
+		{
+			RangeTblEntry *rte = (RangeTblEntry *) lfirst(lc3);
+
+			rti++;
+			if (!(rte->rtekind == RTE_RELATION ||
+				  (rte->rtekind == RTE_SUBQUERY && OidIsValid(rte->relid))))
+				continue;
+			if (bms_is_member(rti, pruned))
+				continue;
+
+			UnlockRelationOid(rte->relid, rte->rellockmode);
 		}
 	}
 }
@@ -30,6 +30,7 @@
 #endif
 
 #include "access/commit_ts.h"
+#include "access/detoast.h"
 #include "access/gin.h"
 #include "access/slru.h"
 #include "access/toast_compression.h"
@@ -48,6 +49,7 @@
 #include "commands/trigger.h"
 #include "commands/user.h"
 #include "commands/vacuum.h"
+#include "common/compression.h"
 #include "common/file_utils.h"
 #include "common/scram-common.h"
 #include "jit/jit.h"
@@ -84,6 +86,7 @@
 #include "storage/large_object.h"
 #include "storage/pg_shmem.h"
 #include "storage/predicate.h"
+#include "storage/procarray.h"
 #include "storage/procnumber.h"
 #include "storage/standby.h"
 #include "tcop/backend_startup.h"
@@ -378,6 +381,21 @@ static const struct config_enum_entry huge_pages_status_options[] = {
 	{NULL, 0, false}
 };
 
+static const struct config_enum_entry wal_receiver_compression_options[] = {
+	{"off", PG_COMPRESSION_NONE, false},
+#ifdef USE_LZ4
+	{"lz4", PG_COMPRESSION_LZ4, false},
+#endif
+#ifdef USE_ZSTD
+	{"zstd", PG_COMPRESSION_ZSTD, false},
+#endif
+	{"none", PG_COMPRESSION_NONE, true},
+	{"false", PG_COMPRESSION_NONE, true},
+	{"no", PG_COMPRESSION_NONE, true},
+	{"0", PG_COMPRESSION_NONE, true},
+	{NULL, 0, false}
+};
+
 static const struct config_enum_entry recovery_prefetch_options[] = {
 	{"off", RECOVERY_PREFETCH_OFF, false},
 	{"on", RECOVERY_PREFETCH_ON, false},
@@ -460,6 +478,9 @@ static const struct config_enum_entry default_toast_compression_options[] = {
 	{"pglz", TOAST_PGLZ_COMPRESSION, false},
 #ifdef  USE_LZ4
 	{"lz4", TOAST_LZ4_COMPRESSION, false},
+#endif
+#ifdef  USE_ZSTD
+	{"zstd", TOAST_ZSTD_COMPRESSION, false},
 #endif
 	{NULL, 0, false}
 };
@@ -299,6 +299,7 @@ PortalDefineQuery(Portal portal,
 	portal->commandTag = commandTag;
 	portal->stmts = stmts;
 	portal->cplan = cplan;
+	portal->cplan_generation = cplan ? cplan->lock_generation : 0;
 	portal->status = PORTAL_DEFINED;
 }
 
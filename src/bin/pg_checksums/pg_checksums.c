@@ -15,6 +15,7 @@
 #include "postgres_fe.h"
 
 #include <dirent.h>
+#include <fcntl.h>
 #include <limits.h>
 #include <sys/stat.h>
 #include <time.h>
@@ -25,6 +26,7 @@
 #include "common/logging.h"
 #include "common/relpath.h"
 #include "fe_utils/option_utils.h"
+#include "fe_utils/worker_pool.h"
 #include "getopt_long.h"
 #include "pg_getopt.h"
 #include "storage/bufpage.h"
@@ -32,6 +34,11 @@
 #include "storage/checksum_impl.h"
 
 
+/*
+ * How many blocks should we try to read from a file at once?
+ */
+#define READ_CHUNK_BLOCKS	32
+
 static int64 files_scanned = 0;
 static int64 files_written = 0;
 static int64 blocks_scanned = 0;
@@ -43,6 +50,7 @@ static char *only_filenode = NULL;
 static bool do_sync = true;
 static bool verbose = false;
 static bool showprogress = false;
+static int	num_jobs = 1;
 static DataDirSyncMethod sync_method = DATA_DIR_SYNC_METHOD_FSYNC;
 
 typedef enum
@@ -63,6 +71,31 @@ static int64 total_size = 0;
 static int64 current_size = 0;
 static pg_time_t last_progress_report = 0;
 
+/*
+ * A file to be scanned by a worker process, with --jobs.
+ */
+typedef struct scan_job
+{
+	char	   *fn;
+	int			segmentno;
+	int64		size;
+} scan_job;
+
+/*
+ * Counters for a scanned file, sent by a worker process back to the leader.
+ */
+typedef struct scan_result
+{
+	int64		blocks_scanned;
+	int64		blocks_written;
+	int64		badblocks;
+	int64		size;
+} scan_result;
+
+static scan_job *scan_jobs = NULL;
+static int	n_scan_jobs = 0;
+static int	max_scan_jobs = 0;
+
 static void
 usage(void)
 {
@@ -75,6 +108,7 @@ usage(void)
 	printf(_("  -d, --disable            disable data checksums\n"));
 	printf(_("  -e, --enable             enable data checksums\n"));
 	printf(_("  -f, --filenode=FILENODE  check only relation with specified filenode\n"));
+	printf(_("  -j, --jobs=NUM           use this many parallel jobs to scan files\n"));
 	printf(_("  -N, --no-sync            do not wait for changes to be written safely to disk\n"));
 	printf(_("  -P, --progress           show progress information\n"));
 	printf(_("      --sync-method=METHOD set method for syncing files to disk\n"));
@@ -174,10 +208,9 @@ skipfile(const char *fn)
 static void
 scan_file(const char *fn, int segmentno)
 {
-	PGIOAlignedBlock buf;
-	PageHeader	header = (PageHeader) buf.data;
+	static PGIOAlignedBlock buf[READ_CHUNK_BLOCKS];
 	int			f;
-	BlockNumber blockno;
+	BlockNumber blockno = 0;
 	int			flags;
 	int64		blocks_written_in_file = 0;
 
@@ -192,77 +225,91 @@ scan_file(const char *fn, int segmentno)
 
 	files_scanned++;
 
-	for (blockno = 0;; blockno++)
+	for (;;)
 	{
-		uint16		csum;
-		int			r = read(f, buf.data, BLCKSZ);
+		int			r = pg_pread(f, buf, sizeof(buf), (off_t) blockno * BLCKSZ);
+		int			nblocks;
 
 		if (r == 0)
 			break;
-		if (r != BLCKSZ)
-		{
-			if (r < 0)
-				pg_fatal("could not read block %u in file \"%s\": %m",
-						 blockno, fn);
-			else
-				pg_fatal("could not read block %u in file \"%s\": read %d of %d",
-						 blockno, fn, r, BLCKSZ);
-		}
-		blocks_scanned++;
+		if (r < 0)
+			pg_fatal("could not read block %u in file \"%s\": %m",
+					 blockno, fn);
+		nblocks = r / BLCKSZ;
+		if (r % BLCKSZ != 0)
+			pg_fatal("could not read block %u in file \"%s\": read %d of %d",
+					 blockno + nblocks, fn, r % BLCKSZ, BLCKSZ);
+
+#if defined(USE_POSIX_FADVISE) && defined(POSIX_FADV_WILLNEED)
 
 		/*
-		 * Since the file size is counted as total_size for progress status
-		 * information, the sizes of all pages including new ones in the file
-		 * should be counted as current_size. Otherwise the progress reporting
-		 * calculated using those counters may not reach 100%.
+		 * If there is probably more to come, ask the kernel to start reading
+		 * the next chunk while we're busy computing checksums for this one.
 		 */
-		current_size += r;
-
-		/* New pages have no checksum yet */
-		if (PageIsNew(buf.data))
-			continue;
+		if (r == sizeof(buf))
+			(void) posix_fadvise(f, (off_t) (blockno + nblocks) * BLCKSZ,
+								 sizeof(buf), POSIX_FADV_WILLNEED);
+#endif
 
-		csum = pg_checksum_page(buf.data, blockno + segmentno * RELSEG_SIZE);
-		if (mode == PG_MODE_CHECK)
+		for (int i = 0; i < nblocks; i++, blockno++)
 		{
-			if (csum != header->pd_checksum)
-			{
-				if (ControlFile->data_checksum_version == PG_DATA_CHECKSUM_VERSION)
-					pg_log_error("checksum verification failed in file \"%s\", block %u: calculated checksum %X but block contains %X",
-								 fn, blockno, csum, header->pd_checksum);
-				badblocks++;
-			}
-		}
-		else if (mode == PG_MODE_ENABLE)
-		{
-			int			w;
+			char	   *page = buf[i].data;
+			PageHeader	header = (PageHeader) page;
+			uint16		csum;
+
+			blocks_scanned++;
 
 			/*
-			 * Do not rewrite if the checksum is already set to the expected
-			 * value.
+			 * Since the file size is counted as total_size for progress
+			 * status information, the sizes of all pages including new ones
+			 * in the file should be counted as current_size. Otherwise the
+			 * progress reporting calculated using those counters may not
+			 * reach 100%.
 			 */
-			if (header->pd_checksum == csum)
-				continue;
-
-			blocks_written_in_file++;
+			current_size += BLCKSZ;
 
-			/* Set checksum in page header */
-			header->pd_checksum = csum;
-
-			/* Seek back to beginning of block */
-			if (lseek(f, -BLCKSZ, SEEK_CUR) < 0)
-				pg_fatal("seek failed for block %u in file \"%s\": %m", blockno, fn);
+			/* New pages have no checksum yet */
+			if (PageIsNew(page))
+				continue;
 
-			/* Write block with checksum */
-			w = write(f, buf.data, BLCKSZ);
-			if (w != BLCKSZ)
+			csum = pg_checksum_page(page, blockno + segmentno * RELSEG_SIZE);
+			if (mode == PG_MODE_CHECK)
 			{
-				if (w < 0)
-					pg_fatal("could not write block %u in file \"%s\": %m",
-							 blockno, fn);
-				else
-					pg_fatal("could not write block %u in file \"%s\": wrote %d of %d",
-							 blockno, fn, w, BLCKSZ);
+				if (csum != header->pd_checksum)
+				{
+					if (ControlFile->data_checksum_version == PG_DATA_CHECKSUM_VERSION)
+						pg_log_error("checksum verification failed in file \"%s\", block %u: calculated checksum %X but block contains %X",
+									 fn, blockno, csum, header->pd_checksum);
+					badblocks++;
+				}
+			}
+			else if (mode == PG_MODE_ENABLE)
+			{
+				int			w;
+
+				/*
+				 * Do not rewrite if the checksum is already set to the
+				 * expected value.
+				 */
+				if (header->pd_checksum == csum)
+					continue;
+
+				blocks_written_in_file++;
+
+				/* Set checksum in page header */
+				header->pd_checksum = csum;
+
+				/* Write block with checksum */
+				w = pg_pwrite(f, page, BLCKSZ, (off_t) blockno * BLCKSZ);
+				if (w != BLCKSZ)
+				{
+					if (w < 0)
+						pg_fatal("could not write block %u in file \"%s\": %m",
+								 blockno, fn);
+					else
+						pg_fatal("could not write block %u in file \"%s\": wrote %d of %d",
+								 blockno, fn, w, BLCKSZ);
+				}
 			}
 		}
 
@@ -374,9 +421,28 @@ scan_directory(const char *basedir, const char *subdir, bool sizeonly)
 
 			/*
 			 * No need to work on the file when calculating only the size of
-			 * the items in the data folder.
+			 * the items in the data folder.  With --jobs, just remember the
+			 * file for now; it'll be scanned by a worker process once we have
+			 * seen all of them.
 			 */
-			if (!sizeonly)
+			if (sizeonly)
+				continue;
+			if (num_jobs > 1)
+			{
+				scan_job   *job;
+
+				if (n_scan_jobs >= max_scan_jobs)
+				{
+					max_scan_jobs = Max(max_scan_jobs * 2, 1024);
+					scan_jobs = pg_realloc(scan_jobs,
+										   sizeof(scan_job) * max_scan_jobs);
+				}
+				job = &scan_jobs[n_scan_jobs++];
+				job->fn = pstrdup(fn);
+				job->segmentno = segmentno;
+				job->size = st.st_size;
+			}
+			else
 				scan_file(fn, segmentno);
 		}
 		else if (S_ISDIR(st.st_mode) || S_ISLNK(st.st_mode))
@@ -428,6 +494,76 @@ scan_directory(const char *basedir, const char *subdir, bool sizeonly)
 	return dirsize;
 }
 
+#ifndef WIN32
+static void
+scan_pool_worker_start(void *arg)
+{
+	/* Progress is reported by the leader. */
+	showprogress = false;
+}
+
+static void
+scan_pool_run_job(int job, void *result, void *arg)
+{
+	scan_result *res = result;
+
+	blocks_scanned = blocks_written = badblocks = 0;
+	current_size = 0;
+	scan_file(scan_jobs[job].fn, scan_jobs[job].segmentno);
+
+	res->blocks_scanned = blocks_scanned;
+	res->blocks_written = blocks_written;
+	res->badblocks = badblocks;
+	res->size = current_size;
+}
+
+static void
+scan_pool_handle_result(int job, const void *result, void *arg)
+{
+	const scan_result *res = result;
+
+	files_scanned++;
+	blocks_scanned += res->blocks_scanned;
+	badblocks += res->badblocks;
+	if (res->blocks_written > 0)
+	{
+		files_written++;
+		blocks_written += res->blocks_written;
+	}
+	current_size += res->size;
+	if (showprogress)
+		progress_report(false);
+}
+
+/*
+ * Scan the files queued up by scan_directory() using num_jobs worker
+ * processes.
+ *
+ * The workers report their counters after each file, and we accumulate them
+ * here and report progress.
+ */
+static void
+scan_queued_files(void)
+{
+	static const WorkerPoolCallbacks callbacks = {
+		.worker_start = scan_pool_worker_start,
+		.run_job = scan_pool_run_job,
+		.handle_result = scan_pool_handle_result,
+	};
+	uint64	   *sizes;
+
+	sizes = pg_malloc(sizeof(uint64) * n_scan_jobs);
+	for (int i = 0; i < n_scan_jobs; i++)
+		sizes[i] = scan_jobs[i].size;
+
+	if (!run_worker_pool(n_scan_jobs, sizes, num_jobs, sizeof(scan_result),
+						 &callbacks, NULL))
+		exit(1);
+
+	pfree(sizes);
+}
+#endif
+
 int
 main(int argc, char *argv[])
 {
@@ -437,6 +573,7 @@ main(int argc, char *argv[])
 		{"disable", no_argument, NULL, 'd'},
 		{"enable", no_argument, NULL, 'e'},
 		{"filenode", required_argument, NULL, 'f'},
+		{"jobs", required_argument, NULL, 'j'},
 		{"no-sync", no_argument, NULL, 'N'},
 		{"progress", no_argument, NULL, 'P'},
 		{"verbose", no_argument, NULL, 'v'},
@@ -467,7 +604,7 @@ main(int argc, char *argv[])
 		}
 	}
 
-	while ((c = getopt_long(argc, argv, "cdD:ef:NPv", long_options, &option_index)) != -1)
+	while ((c = getopt_long(argc, argv, "cdD:ef:j:NPv", long_options, &option_index)) != -1)
 	{
 		switch (c)
 		{
@@ -490,6 +627,11 @@ main(int argc, char *argv[])
 					exit(1);
 				only_filenode = pstrdup(optarg);
 				break;
+			case 'j':
+				if (!option_parse_int(optarg, "-j/--jobs", 1, INT_MAX,
+									  &num_jobs))
+					exit(1);
+				break;
 			case 'N':
 				do_sync = false;
 				break;
@@ -535,6 +677,11 @@ main(int argc, char *argv[])
 		exit(1);
 	}
 
+#ifdef WIN32
+	if (num_jobs > 1)
+		pg_fatal("option %s is not supported on this platform", "-j/--jobs");
+#endif
+
 	/* filenode checking only works in --check mode */
 	if (mode != PG_MODE_CHECK && only_filenode)
 	{
@@ -599,6 +746,12 @@ main(int argc, char *argv[])
 		(void) scan_directory(DataDir, "base", false);
 		(void) scan_directory(DataDir, PG_TBLSPC_DIR, false);
 
+#ifndef WIN32
+		/* With --jobs, the files have only been queued so far. */
+		if (n_scan_jobs > 0)
+			scan_queued_files();
+#endif
+
 		if (showprogress)
 			progress_report(true);
 
@@ -77,6 +77,22 @@ sub check_relation_corruption
 		[qr/checksum verification failed/],
 		"fails with corrupted data on tablespace $tablespace");
 
+	# Same with parallel workers
+	if (!$windows_os)
+	{
+		$node->command_checks_all(
+			[
+				'pg_checksums', '--check',
+				'--jobs' => 3,
+				'--pgdata' => $pgdata
+			],
+			1,
+			[qr/Bad checksums:.*1/],
+			[qr/checksum verification failed/],
+			"fails with corrupted data on tablespace $tablespace with --jobs"
+		);
+	}
+
 	# Drop corrupted table again and make sure there is no more corruption.
 	$node->start;
 	$node->safe_psql('postgres', "DROP TABLE $table;");
@@ -168,6 +184,10 @@ command_like(
 # Checksums pass on a newly-created cluster
 command_ok([ 'pg_checksums', '--check', '--pgdata' => $pgdata ],
 	"succeeds with offline cluster");
+command_ok(
+	[ 'pg_checksums', '--check', '--jobs' => 4, '--pgdata' => $pgdata ],
+	"succeeds with offline cluster with --jobs")
+  if !$windows_os;
 
 # Checksums are verified if no other arguments are specified
 command_ok(
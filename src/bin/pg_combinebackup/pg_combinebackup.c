@@ -34,6 +34,7 @@
 #include "common/relpath.h"
 #include "copy_file.h"
 #include "fe_utils/option_utils.h"
+#include "fe_utils/worker_pool.h"
 #include "getopt_long.h"
 #include "lib/stringinfo.h"
 #include "load_manifest.h"
@@ -79,6 +80,7 @@ typedef struct cb_options
 	bool		no_manifest;
 	DataDirSyncMethod sync_method;
 	CopyMethod	copy_method;
+	int			jobs;
 } cb_options;
 
 /*
@@ -97,9 +99,45 @@ typedef struct cb_tablespace
 	struct cb_tablespace *next;
 } cb_tablespace;
 
+/*
+ * A regular file that needs to be copied or reconstructed into the output
+ * directory.
+ *
+ * With --jobs, process_directory_recursively() only creates the output
+ * directories and queues up one of these for each file; the files are then
+ * processed by a pool of worker processes.
+ */
+typedef struct cb_file_job
+{
+	char	   *input_path;		/* full path of the input file */
+	char	   *output_path;	/* full path of the output file */
+	char	   *manifest_prefix;	/* prefix for backup manifest lookups */
+	char	   *bare_file_name; /* file name without INCREMENTAL. prefix */
+	char	   *manifest_path;	/* path to use in the backup manifest */
+	char	   *input_directory;	/* top-level input directory */
+	bool		incremental;	/* needs reconstruction? */
+	pg_checksum_type checksum_type;
+	uint64		cost;			/* estimated amount of data to write */
+} cb_file_job;
+
+/*
+ * Result of processing a file, sent by a worker process back to the leader,
+ * which writes the backup manifest.
+ */
+typedef struct cb_file_result
+{
+	int			checksum_length;
+	uint8		checksum_payload[PG_CHECKSUM_MAX_LENGTH];
+} cb_file_result;
+
 /* Directories to be removed if we exit uncleanly. */
 static cb_cleanup_dir *cleanup_dir_list = NULL;
 
+/* Files queued for processing by worker processes, with --jobs. */
+static cb_file_job *file_jobs = NULL;
+static int	n_file_jobs = 0;
+static int	max_file_jobs = 0;
+
 static void add_tablespace_mapping(cb_options *opt, char *arg);
 static StringInfo check_backup_label_files(int n_backups, char **backup_dirs);
 static uint64 check_control_files(int n_backups, char **backup_dirs);
@@ -108,6 +146,24 @@ static void cleanup_directories_atexit(void);
 static void create_output_directory(char *dirname, cb_options *opt);
 static void help(const char *progname);
 static bool parse_oid(char *s, Oid *result);
+static void add_file_to_output_manifest(manifest_writer *mwriter,
+										cb_file_job *job,
+										int checksum_length,
+										uint8 *checksum_payload);
+static void process_file(cb_file_job *job,
+						 int n_prior_backups,
+						 char **prior_backup_dirs,
+						 manifest_data **manifests,
+						 cb_options *opt,
+						 int *checksum_length,
+						 uint8 **checksum_payload);
+#ifndef WIN32
+static void process_queued_files(int n_prior_backups,
+								 char **prior_backup_dirs,
+								 manifest_data **manifests,
+								 manifest_writer *mwriter,
+								 cb_options *opt);
+#endif
 static void process_directory_recursively(Oid tsoid,
 										  char *input_directory,
 										  char *output_directory,
@@ -143,6 +199,7 @@ main(int argc, char *argv[])
 		{"clone", no_argument, NULL, 4},
 		{"copy", no_argument, NULL, 5},
 		{"copy-file-range", no_argument, NULL, 6},
+		{"jobs", required_argument, NULL, 'j'},
 		{NULL, 0, NULL, 0}
 	};
 
@@ -172,9 +229,10 @@ main(int argc, char *argv[])
 	opt.manifest_checksums = CHECKSUM_TYPE_CRC32C;
 	opt.sync_method = DATA_DIR_SYNC_METHOD_FSYNC;
 	opt.copy_method = COPY_METHOD_COPY;
+	opt.jobs = 1;
 
 	/* process command-line options */
-	while ((c = getopt_long(argc, argv, "dknNo:T:",
+	while ((c = getopt_long(argc, argv, "dj:knNo:T:",
 							long_options, &optindex)) != -1)
 	{
 		switch (c)
@@ -183,6 +241,11 @@ main(int argc, char *argv[])
 				opt.debug = true;
 				pg_logging_increase_verbosity();
 				break;
+			case 'j':
+				if (!option_parse_int(optarg, "-j/--jobs", 1, INT_MAX,
+									  &opt.jobs))
+					exit(1);
+				break;
 			case 'k':
 				opt.copy_method = COPY_METHOD_LINK;
 				break;
@@ -237,6 +300,11 @@ main(int argc, char *argv[])
 	if (opt.output == NULL)
 		pg_fatal("no output directory specified");
 
+#ifdef WIN32
+	if (opt.jobs > 1)
+		pg_fatal("option %s is not supported on this platform", "-j/--jobs");
+#endif
+
 	/* If no manifest is needed, no checksums are needed, either. */
 	if (opt.no_manifest)
 		opt.manifest_checksums = CHECKSUM_TYPE_NONE;
@@ -412,6 +480,13 @@ main(int argc, char *argv[])
 									  manifests, mwriter, &opt);
 	}
 
+#ifndef WIN32
+	/* With --jobs, the files have only been queued so far. */
+	if (n_file_jobs > 0)
+		process_queued_files(n_prior_backups, prior_backup_dirs, manifests,
+							 mwriter, &opt);
+#endif
+
 	/* Finalize the backup_manifest, if we're generating one. */
 	if (mwriter != NULL)
 		finalize_manifest(mwriter,
@@ -439,6 +514,38 @@ main(int argc, char *argv[])
 	exit(0);
 }
 
+/*
+ * Add an entry for a file that has been written to the output directory to
+ * the backup manifest.
+ */
+static void
+add_file_to_output_manifest(manifest_writer *mwriter, cb_file_job *job,
+							int checksum_length, uint8 *checksum_payload)
+{
+	struct stat sb;
+
+	/*
+	 * In order to generate a manifest entry, we need the file size and mtime.
+	 * We have no way to know the correct mtime except to stat() the file, so
+	 * just do that and get the size as well.
+	 *
+	 * If we didn't need the mtime here, we could try to obtain the file size
+	 * from the reconstruction or file copy process, although that is actually
+	 * not convenient in all cases. If we write the file ourselves then
+	 * clearly we can keep a count of bytes, but if we use something like
+	 * CopyFile() then it's trickier. Since we have to stat() anyway to get
+	 * the mtime, there's no point in worrying about it.
+	 */
+	if (stat(job->output_path, &sb) < 0)
+		pg_fatal("could not stat file \"%s\": %m", job->output_path);
+
+	/* OK, now do the work. */
+	add_file_to_manifest(mwriter, job->manifest_path,
+						 sb.st_size, sb.st_mtime,
+						 job->checksum_type, checksum_length,
+						 checksum_payload);
+}
+
 /*
  * Process the option argument for the -T, --tablespace-mapping switch.
  */
@@ -770,6 +877,7 @@ help(const char *progname)
 	printf(_("  %s [OPTION]... DIRECTORY...\n"), progname);
 	printf(_("\nOptions:\n"));
 	printf(_("  -d, --debug               generate lots of debugging output\n"));
+	printf(_("  -j, --jobs=NUM            use this many parallel jobs to write files\n"));
 	printf(_("  -k, --link                link files instead of copying\n"));
 	printf(_("  -n, --dry-run             do not actually do anything\n"));
 	printf(_("  -N, --no-sync             do not wait for changes to be written safely to disk\n"));
@@ -848,7 +956,6 @@ process_directory_recursively(Oid tsoid,
 	bool		is_pg_tblspc = false;
 	bool		is_pg_wal = false;
 	bool		is_incremental_dir = false;
-	manifest_data *latest_manifest = manifests[n_prior_backups];
 	pg_checksum_type checksum_type;
 
 	/*
@@ -950,7 +1057,7 @@ process_directory_recursively(Oid tsoid,
 		Oid			oid = InvalidOid;
 		int			checksum_length = 0;
 		uint8	   *checksum_payload = NULL;
-		pg_checksum_context checksum_ctx;
+		cb_file_job job;
 
 		/* Ignore "." and ".." entries. */
 		if (strcmp(de->d_name, ".") == 0 ||
@@ -1017,144 +1124,295 @@ process_directory_recursively(Oid tsoid,
 			 strcmp(de->d_name, "backup_manifest") == 0))
 			continue;
 
-		/*
-		 * If it's an incremental file, hand it off to the reconstruction
-		 * code, which will figure out what to do.
-		 */
-		if (is_incremental_dir &&
+		/* Describe the work to be done for this file. */
+		job.input_path = ifullpath;
+		job.input_directory = input_directory;
+		job.manifest_prefix = manifest_prefix;
+		job.checksum_type = checksum_type;
+		job.incremental = is_incremental_dir &&
 			strncmp(de->d_name, INCREMENTAL_PREFIX,
-					INCREMENTAL_PREFIX_LENGTH) == 0)
+					INCREMENTAL_PREFIX_LENGTH) == 0;
+		if (job.incremental)
 		{
-			/* Output path should not include "INCREMENTAL." prefix. */
-			snprintf(ofullpath, MAXPGPATH, "%s/%s", ofulldir,
-					 de->d_name + INCREMENTAL_PREFIX_LENGTH);
-
-
-			/* Manifest path likewise omits incremental prefix. */
-			snprintf(manifest_path, MAXPGPATH, "%s%s", manifest_prefix,
-					 de->d_name + INCREMENTAL_PREFIX_LENGTH);
-
-			/* Reconstruction logic will do the rest. */
-			reconstruct_from_incremental_file(ifullpath, ofullpath,
-											  manifest_prefix,
-											  de->d_name + INCREMENTAL_PREFIX_LENGTH,
-											  n_prior_backups,
-											  prior_backup_dirs,
-											  manifests,
-											  manifest_path,
-											  checksum_type,
-											  &checksum_length,
-											  &checksum_payload,
-											  opt->copy_method,
-											  opt->debug,
-											  opt->dry_run);
+			/*
+			 * Output path and manifest path should not include "INCREMENTAL."
+			 * prefix.
+			 */
+			job.bare_file_name = de->d_name + INCREMENTAL_PREFIX_LENGTH;
 		}
 		else
+			job.bare_file_name = de->d_name;
+		snprintf(ofullpath, MAXPGPATH, "%s/%s", ofulldir, job.bare_file_name);
+		job.output_path = ofullpath;
+		snprintf(manifest_path, MAXPGPATH, "%s%s", manifest_prefix,
+				 job.bare_file_name);
+		job.manifest_path = manifest_path;
+
+		/*
+		 * With --jobs, just remember the file for now; it'll be processed by
+		 * a worker process once we have seen all of them.
+		 */
+		if (opt->jobs > 1)
 		{
-			/* Construct the path that the backup_manifest will use. */
-			snprintf(manifest_path, MAXPGPATH, "%s%s", manifest_prefix,
-					 de->d_name);
+			cb_file_job *queued;
+			struct stat sb;
 
-			/*
-			 * It's not an incremental file, so we need to copy the entire
-			 * file to the output directory.
-			 *
-			 * If a checksum of the required type already exists in the
-			 * backup_manifest for the final input directory, we can save some
-			 * work by reusing that checksum instead of computing a new one.
-			 */
-			if (checksum_type != CHECKSUM_TYPE_NONE &&
-				latest_manifest != NULL)
+			if (n_file_jobs >= max_file_jobs)
 			{
-				manifest_file *mfile;
-
-				mfile = manifest_files_lookup(latest_manifest->files,
-											  manifest_path);
-				if (mfile == NULL)
-				{
-					char	   *bmpath;
-
-					/*
-					 * The directory is out of sync with the backup_manifest,
-					 * so emit a warning.
-					 */
-					bmpath = psprintf("%s/%s", input_directory,
-									  "backup_manifest");
-					pg_log_warning("manifest file \"%s\" contains no entry for file \"%s\"",
-								   bmpath, manifest_path);
-					pfree(bmpath);
-				}
-				else if (mfile->checksum_type == checksum_type)
-				{
-					checksum_length = mfile->checksum_length;
-					checksum_payload = mfile->checksum_payload;
-				}
+				max_file_jobs = Max(max_file_jobs * 2, 1024);
+				file_jobs = pg_realloc(file_jobs,
+									   sizeof(cb_file_job) * max_file_jobs);
 			}
+			queued = &file_jobs[n_file_jobs++];
+			queued->input_path = pstrdup(ifullpath);
+			queued->output_path = pstrdup(ofullpath);
+			queued->manifest_prefix = pstrdup(manifest_prefix);
+			queued->manifest_path = pstrdup(manifest_path);
+			queued->bare_file_name = queued->manifest_path +
+				strlen(manifest_prefix);
+			queued->input_directory = input_directory;
+			queued->incremental = job.incremental;
+			queued->checksum_type = checksum_type;
 
 			/*
-			 * If we're reusing a checksum, then we don't need copy_file() to
-			 * compute one for us, but otherwise, it needs to compute whatever
-			 * type of checksum we need.
-			 */
-			if (checksum_length != 0)
-				pg_checksum_init(&checksum_ctx, CHECKSUM_TYPE_NONE);
-			else
-				pg_checksum_init(&checksum_ctx, checksum_type);
-
-			/* Actually copy the file. */
-			snprintf(ofullpath, MAXPGPATH, "%s/%s", ofulldir, de->d_name);
-			copy_file(ifullpath, ofullpath, &checksum_ctx,
-					  opt->copy_method, opt->dry_run);
-
-			/*
-			 * If copy_file() performed a checksum calculation for us, then
-			 * save the results (except in dry-run mode, when there's no
-			 * point).
+			 * Estimate how much data we'll have to write, so that the work
+			 * can be spread evenly across the workers.  For an incremental
+			 * file, the size of the file in the oldest backup is a better
+			 * guide than the size of the incremental file itself.
 			 */
-			if (checksum_ctx.type != CHECKSUM_TYPE_NONE && !opt->dry_run)
+			if (stat(ifullpath, &sb) < 0)
+				pg_fatal("could not stat file \"%s\": %m", ifullpath);
+			queued->cost = sb.st_size;
+			if (job.incremental && manifests[0] != NULL)
 			{
-				checksum_payload = pg_malloc(PG_CHECKSUM_MAX_LENGTH);
-				checksum_length = pg_checksum_final(&checksum_ctx,
-													checksum_payload);
+				manifest_file *mfile;
+
+				mfile = manifest_files_lookup(manifests[0]->files,
+											  manifest_path);
+				if (mfile != NULL)
+					queued->cost = Max(queued->cost, mfile->size);
 			}
+			continue;
 		}
 
+		process_file(&job, n_prior_backups, prior_backup_dirs, manifests,
+					 opt, &checksum_length, &checksum_payload);
+
 		/* Generate manifest entry, if needed. */
 		if (mwriter != NULL)
+			add_file_to_output_manifest(mwriter, &job, checksum_length,
+										checksum_payload);
+
+		/* Avoid leaking memory. */
+		if (checksum_payload != NULL)
+			pfree(checksum_payload);
+	}
+
+	closedir(dir);
+}
+
+/*
+ * Copy or reconstruct a single regular file into the output directory.
+ *
+ * On return, *checksum_length and *checksum_payload describe the checksum of
+ * the output file, if one of type job->checksum_type was computed or found
+ * in the backup manifest of the final input directory.
+ */
+static void
+process_file(cb_file_job *job,
+			 int n_prior_backups,
+			 char **prior_backup_dirs,
+			 manifest_data **manifests,
+			 cb_options *opt,
+			 int *checksum_length,
+			 uint8 **checksum_payload)
+{
+	manifest_data *latest_manifest = manifests[n_prior_backups];
+	pg_checksum_context checksum_ctx;
+
+	*checksum_length = 0;
+	*checksum_payload = NULL;
+
+	/*
+	 * If it's an incremental file, hand it off to the reconstruction code,
+	 * which will figure out what to do.
+	 */
+	if (job->incremental)
+	{
+		reconstruct_from_incremental_file(job->input_path,
+										  job->output_path,
+										  job->manifest_prefix,
+										  job->bare_file_name,
+										  n_prior_backups,
+										  prior_backup_dirs,
+										  manifests,
+										  job->manifest_path,
+										  job->checksum_type,
+										  checksum_length,
+										  checksum_payload,
+										  opt->copy_method,
+										  opt->debug,
+										  opt->dry_run);
+		return;
+	}
+
+	/*
+	 * It's not an incremental file, so we need to copy the entire file to the
+	 * output directory.
+	 *
+	 * If a checksum of the required type already exists in the
+	 * backup_manifest for the final input directory, we can save some work by
+	 * reusing that checksum instead of computing a new one.
+	 */
+	if (job->checksum_type != CHECKSUM_TYPE_NONE &&
+		latest_manifest != NULL)
+	{
+		manifest_file *mfile;
+
+		mfile = manifest_files_lookup(latest_manifest->files,
+									  job->manifest_path);
+		if (mfile == NULL)
 		{
-			struct stat sb;
+			char	   *bmpath;
 
 			/*
-			 * In order to generate a manifest entry, we need the file size
-			 * and mtime. We have no way to know the correct mtime except to
-			 * stat() the file, so just do that and get the size as well.
-			 *
-			 * If we didn't need the mtime here, we could try to obtain the
-			 * file size from the reconstruction or file copy process above,
-			 * although that is actually not convenient in all cases. If we
-			 * write the file ourselves then clearly we can keep a count of
-			 * bytes, but if we use something like CopyFile() then it's
-			 * trickier. Since we have to stat() anyway to get the mtime,
-			 * there's no point in worrying about it.
+			 * The directory is out of sync with the backup_manifest, so emit
+			 * a warning.
 			 */
-			if (stat(ofullpath, &sb) < 0)
-				pg_fatal("could not stat file \"%s\": %m", ofullpath);
-
-			/* OK, now do the work. */
-			add_file_to_manifest(mwriter, manifest_path,
-								 sb.st_size, sb.st_mtime,
-								 checksum_type, checksum_length,
-								 checksum_payload);
+			bmpath = psprintf("%s/%s", job->input_directory,
+							  "backup_manifest");
+			pg_log_warning("manifest file \"%s\" contains no entry for file \"%s\"",
+						   bmpath, job->manifest_path);
+			pfree(bmpath);
 		}
+		else if (mfile->checksum_type == job->checksum_type)
+		{
+			*checksum_length = mfile->checksum_length;
+			*checksum_payload = mfile->checksum_payload;
+		}
+	}
 
-		/* Avoid leaking memory. */
-		if (checksum_payload != NULL)
-			pfree(checksum_payload);
+	/*
+	 * If we're reusing a checksum, then we don't need copy_file() to compute
+	 * one for us, but otherwise, it needs to compute whatever type of
+	 * checksum we need.
+	 */
+	if (*checksum_length != 0)
+		pg_checksum_init(&checksum_ctx, CHECKSUM_TYPE_NONE);
+	else
+		pg_checksum_init(&checksum_ctx, job->checksum_type);
+
+	/* Actually copy the file. */
+	copy_file(job->input_path, job->output_path, &checksum_ctx,
+			  opt->copy_method, opt->dry_run);
+
+	/*
+	 * If copy_file() performed a checksum calculation for us, then save the
+	 * results (except in dry-run mode, when there's no point).
+	 */
+	if (checksum_ctx.type != CHECKSUM_TYPE_NONE && !opt->dry_run)
+	{
+		*checksum_payload = pg_malloc(PG_CHECKSUM_MAX_LENGTH);
+		*checksum_length = pg_checksum_final(&checksum_ctx,
+											 *checksum_payload);
 	}
+}
 
-	closedir(dir);
+#ifndef WIN32
+/*
+ * State shared by the worker pool callbacks of process_queued_files().
+ */
+typedef struct cb_pool_state
+{
+	int			n_prior_backups;
+	char	  **prior_backup_dirs;
+	manifest_data **manifests;
+	manifest_writer *mwriter;
+	cb_options *opt;
+} cb_pool_state;
+
+static void
+cb_pool_worker_start(void *arg)
+{
+	/* Cleaning up after a failure is the leader's job. */
+	reset_directory_cleanup_list();
+}
+
+static void
+cb_pool_run_job(int job, void *result, void *arg)
+{
+	cb_pool_state *state = arg;
+	cb_file_result *res = result;
+	int			checksum_length;
+	uint8	   *checksum_payload;
+
+	process_file(&file_jobs[job], state->n_prior_backups,
+				 state->prior_backup_dirs, state->manifests, state->opt,
+				 &checksum_length, &checksum_payload);
+
+	res->checksum_length = checksum_length;
+	if (checksum_length > 0)
+		memcpy(res->checksum_payload, checksum_payload, checksum_length);
+	if (checksum_payload != NULL)
+		pfree(checksum_payload);
+}
+
+static void
+cb_pool_handle_result(int job, const void *result, void *arg)
+{
+	cb_pool_state *state = arg;
+	const cb_file_result *res = result;
+
+	if (state->mwriter != NULL)
+		add_file_to_output_manifest(state->mwriter, &file_jobs[job],
+									res->checksum_length,
+									(uint8 *) res->checksum_payload);
 }
 
+/*
+ * Process the files queued up by process_directory_recursively() using
+ * opt->jobs worker processes.
+ *
+ * Each worker reports the checksum of every file it has written, and we add
+ * the files to the backup manifest as the results come in, so that the
+ * manifest is still written by this process alone.
+ */
+static void
+process_queued_files(int n_prior_backups,
+					 char **prior_backup_dirs,
+					 manifest_data **manifests,
+					 manifest_writer *mwriter,
+					 cb_options *opt)
+{
+	static const WorkerPoolCallbacks callbacks = {
+		.worker_start = cb_pool_worker_start,
+		.run_job = cb_pool_run_job,
+		.handle_result = cb_pool_handle_result,
+	};
+	cb_pool_state state;
+	uint64	   *costs;
+
+	state.n_prior_backups = n_prior_backups;
+	state.prior_backup_dirs = prior_backup_dirs;
+	state.manifests = manifests;
+	state.mwriter = mwriter;
+	state.opt = opt;
+
+	costs = pg_malloc(sizeof(uint64) * n_file_jobs);
+	for (int i = 0; i < n_file_jobs; i++)
+		costs[i] = file_jobs[i].cost;
+
+	pg_log_debug("processing %d files using %d worker processes",
+				 n_file_jobs, Min(opt->jobs, n_file_jobs));
+
+	if (!run_worker_pool(n_file_jobs, costs, opt->jobs,
+						 sizeof(cb_file_result), &callbacks, &state))
+		exit(1);
+
+	pfree(costs);
+}
+#endif
+
 /*
  * Read the version number from PG_VERSION and convert it to the usual server
  * version number format. (e.g. If PG_VERSION contains "14\n" this function
@@ -69,6 +69,9 @@ combine_and_test_one_backup('csum_none', undef, '--manifest-checksums=NONE',
 	$mode);
 combine_and_test_one_backup('csum_sha224',
 	undef, '--manifest-checksums=SHA224', $mode);
+combine_and_test_one_backup('csum_sha224_jobs',
+	undef, '--manifest-checksums=SHA224', '--jobs=4', $mode)
+  if !$windows_os;
 
 # Verify that SHA224 is mentioned in the SHA224 manifest lots of times.
 my $sha224_manifest =
@@ -22,7 +22,9 @@
 #include "access/xlog_internal.h"
 #include "common/logging.h"
 #include "common/parse_manifest.h"
+#include "fe_utils/option_utils.h"
 #include "fe_utils/simple_list.h"
+#include "fe_utils/worker_pool.h"
 #include "getopt_long.h"
 #include "pg_verifybackup.h"
 #include "pgtime.h"
@@ -88,6 +90,9 @@ static void verify_tar_file(verifier_context *context, char *relpath,
 							char *fullpath, astreamer *streamer);
 static void report_extra_backup_files(verifier_context *context);
 static void verify_backup_checksums(verifier_context *context);
+#ifndef WIN32
+static void verify_backup_checksums_parallel(verifier_context *context);
+#endif
 static void verify_file_checksum(verifier_context *context,
 								 manifest_file *m, char *fullpath,
 								 uint8 *buffer);
@@ -107,6 +112,9 @@ static const char *progname;
 /* is progress reporting enabled? */
 static bool show_progress = false;
 
+/* number of worker processes to use for checksum verification */
+static int	num_jobs = 1;
+
 /* Progress indicators */
 static uint64 total_size = 0;
 static uint64 done_size = 0;
@@ -122,6 +130,7 @@ main(int argc, char **argv)
 		{"ignore", required_argument, NULL, 'i'},
 		{"manifest-path", required_argument, NULL, 'm'},
 		{"format", required_argument, NULL, 'F'},
+		{"jobs", required_argument, NULL, 'j'},
 		{"no-parse-wal", no_argument, NULL, 'n'},
 		{"progress", no_argument, NULL, 'P'},
 		{"quiet", no_argument, NULL, 'q'},
@@ -180,7 +189,7 @@ main(int argc, char **argv)
 	simple_string_list_append(&context.ignore_list, "recovery.signal");
 	simple_string_list_append(&context.ignore_list, "standby.signal");
 
-	while ((c = getopt_long(argc, argv, "eF:i:m:nPqsw:", long_options, NULL)) != -1)
+	while ((c = getopt_long(argc, argv, "eF:i:j:m:nPqsw:", long_options, NULL)) != -1)
 	{
 		switch (c)
 		{
@@ -195,6 +204,11 @@ main(int argc, char **argv)
 					simple_string_list_append(&context.ignore_list, arg);
 					break;
 				}
+			case 'j':
+				if (!option_parse_int(optarg, "-j/--jobs", 1, INT_MAX,
+									  &num_jobs))
+					exit(1);
+				break;
 			case 'm':
 				manifest_path = pstrdup(optarg);
 				canonicalize_path(manifest_path);
@@ -255,6 +269,11 @@ main(int argc, char **argv)
 		pg_fatal("cannot specify both %s and %s",
 				 "-P/--progress", "-q/--quiet");
 
+#ifdef WIN32
+	if (num_jobs > 1)
+		pg_fatal("option %s is not supported on this platform", "-j/--jobs");
+#endif
+
 	/* Unless --no-parse-wal was specified, we will need pg_waldump. */
 	if (!no_parse_wal)
 	{
@@ -1063,6 +1082,14 @@ verify_backup_checksums(verifier_context *context)
 	manifest_file *m;
 	uint8	   *buffer;
 
+#ifndef WIN32
+	if (num_jobs > 1)
+	{
+		verify_backup_checksums_parallel(context);
+		return;
+	}
+#endif
+
 	progress_report(false);
 
 	buffer = pg_malloc(READ_CHUNK_SIZE * sizeof(uint8));
@@ -1092,6 +1119,117 @@ verify_backup_checksums(verifier_context *context)
 	progress_report(true);
 }
 
+#ifndef WIN32
+/*
+ * State shared by the worker pool callbacks of
+ * verify_backup_checksums_parallel().
+ */
+typedef struct verify_pool_state
+{
+	verifier_context *context;
+	manifest_file **files;
+	uint8	   *buffer;
+} verify_pool_state;
+
+static void
+verify_pool_worker_start(void *arg)
+{
+	verify_pool_state *state = arg;
+
+	/* Progress is reported by the leader. */
+	show_progress = false;
+	state->buffer = pg_malloc(READ_CHUNK_SIZE * sizeof(uint8));
+}
+
+static void
+verify_pool_run_job(int job, void *result, void *arg)
+{
+	verify_pool_state *state = arg;
+	manifest_file *m = state->files[job];
+	char	   *fullpath;
+
+	fullpath = psprintf("%s/%s", state->context->backup_directory,
+						m->pathname);
+	verify_file_checksum(state->context, m, fullpath, state->buffer);
+	pfree(fullpath);
+
+	*(uint64 *) result = m->size;
+}
+
+static void
+verify_pool_handle_result(int job, const void *result, void *arg)
+{
+	done_size += *(const uint64 *) result;
+	progress_report(false);
+}
+
+static int
+verify_pool_worker_exit_status(void *arg)
+{
+	verify_pool_state *state = arg;
+
+	return state->context->saw_any_error ? 1 : 0;
+}
+
+/*
+ * Like verify_backup_checksums, but spread the work across num_jobs worker
+ * processes.
+ *
+ * Workers report problems themselves, just like in the serial case, and send
+ * the size of each file they've verified back to us so that we can report
+ * progress.  A worker that saw an error exits with a non-zero status.
+ */
+static void
+verify_backup_checksums_parallel(verifier_context *context)
+{
+	static const WorkerPoolCallbacks callbacks = {
+		.worker_start = verify_pool_worker_start,
+		.run_job = verify_pool_run_job,
+		.handle_result = verify_pool_handle_result,
+		.worker_exit_status = verify_pool_worker_exit_status,
+	};
+	manifest_data *manifest = context->manifest;
+	manifest_files_iterator it;
+	manifest_file *m;
+	verify_pool_state state;
+	uint64	   *sizes;
+	int			nfiles = 0;
+
+	progress_report(false);
+
+	/* Collect the files that need to be verified. */
+	state.context = context;
+	state.files = pg_malloc(sizeof(manifest_file *) * manifest->files->members);
+	state.buffer = NULL;
+	sizes = pg_malloc(sizeof(uint64) * manifest->files->members);
+	manifest_files_start_iterate(manifest->files, &it);
+	while ((m = manifest_files_iterate(manifest->files, &it)) != NULL)
+	{
+		if (should_verify_checksum(m) &&
+			!should_ignore_relpath(context, m->pathname))
+		{
+			state.files[nfiles] = m;
+			sizes[nfiles] = m->size;
+			nfiles++;
+		}
+	}
+
+	/* Any problems have already been reported by the workers themselves. */
+	if (!run_worker_pool(nfiles, sizes, num_jobs, sizeof(uint64),
+						 &callbacks, &state))
+	{
+		context->saw_any_error = true;
+		if (context->exit_on_error)
+			exit(1);
+	}
+
+	pfree(state.files);
+	pfree(sizes);
+
+	progress_report(true);
+}
+#endif
+
 /*
  * Verify the checksum of a single file.
  */
@@ -1115,6 +1253,11 @@ verify_file_checksum(verifier_context *context, manifest_file *m,
 		return;
 	}
 
+#if defined(USE_POSIX_FADVISE) && defined(POSIX_FADV_SEQUENTIAL)
+	/* We'll read the whole file in order, so let the kernel read ahead. */
+	(void) posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+
 	/* Initialize checksum context. */
 	if (pg_checksum_init(&checksum_ctx, m->checksum_type) < 0)
 	{
@@ -1371,6 +1514,7 @@ usage(void)
 	printf(_("  -e, --exit-on-error         exit immediately on error\n"));
 	printf(_("  -F, --format=p|t            backup format (plain, tar)\n"));
 	printf(_("  -i, --ignore=RELATIVE_PATH  ignore indicated path\n"));
+	printf(_("  -j, --jobs=NUM              use this many parallel jobs to verify checksums\n"));
 	printf(_("  -m, --manifest-path=PATH    use specified path for manifest\n"));
 	printf(_("  -n, --no-parse-wal          do not try to parse WAL files\n"));
 	printf(_("  -P, --progress              show progress information\n"));
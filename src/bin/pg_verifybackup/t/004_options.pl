@@ -39,6 +39,11 @@ $primary->command_ok(
 	[ 'pg_verifybackup', '--format' => 'plain', $backup_path ],
 	"verifies with --format=plain");
 
+# Should also work with several jobs.
+$primary->command_ok([ 'pg_verifybackup', '--jobs' => 4, $backup_path ],
+	"verifies with --jobs")
+  if !$windows_os;
+
 # Should not work if we specify --format=y because that's invalid.
 $primary->command_fails_like(
 	[ 'pg_verifybackup', '--format' => 'y', $backup_path ],
@@ -75,6 +80,13 @@ command_fails_like(
 	qr/checksum mismatch for file \"PG_VERSION\"/,
 	'--quiet checksum mismatch');
 
+# The same problem should be found when checksums are verified in parallel.
+command_fails_like(
+	[ 'pg_verifybackup', '--jobs' => 4, $backup_path ],
+	qr/checksum mismatch for file \"PG_VERSION\"/,
+	'--jobs checksum mismatch')
+  if !$windows_os;
+
 # Since we didn't change the length of the file, verification should succeed
 # if we ignore checksums. Check that we get the right message, too.
 command_like(
@@ -0,0 +1,233 @@
+/*-------------------------------------------------------------------------
+ *
+ * Pool of worker processes for frontend programs
+ *
+ * This runs a set of independent jobs, typically one per file, in a number
+ * of forked worker processes.  The jobs are handed out up front, largest
+ * first, each to the worker that has the least work so far, which keeps the
+ * workers busy for roughly the same amount of time without any further
+ * coordination.  Each worker sends a fixed-size result back to the leader
+ * through a pipe after every job, so the leader can keep totals, report
+ * progress or write output that must come from a single process.
+ *
+ * Portions Copyright (c) 1996-2025, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * src/fe_utils/worker_pool.c
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include "postgres_fe.h"
+
+#ifndef WIN32
+
+#include <limits.h>
+#include <poll.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "common/int.h"
+#include "common/logging.h"
+#include "fe_utils/worker_pool.h"
+
+typedef struct WorkerPoolJob
+{
+	int			job;
+	int			worker;
+	uint64		cost;
+} WorkerPoolJob;
+
+/* Header of each message sent from a worker to the leader */
+typedef struct WorkerPoolMessage
+{
+	int			job;
+	/* result_size bytes of result follow, suitably aligned */
+} WorkerPoolMessage;
+
+#define WORKER_POOL_RESULT_OFFSET	MAXALIGN(sizeof(WorkerPoolMessage))
+
+static int
+worker_pool_job_cmp(const void *a, const void *b)
+{
+	const WorkerPoolJob *ja = (const WorkerPoolJob *) a;
+	const WorkerPoolJob *jb = (const WorkerPoolJob *) b;
+
+	/* largest first, and in job order among equals */
+	if (ja->cost != jb->cost)
+		return pg_cmp_u64(jb->cost, ja->cost);
+	return pg_cmp_s32(ja->job, jb->job);
+}
+
+/*
+ * Run jobs 0 .. njobs - 1 in up to nworkers worker processes.
+ *
+ * job_costs[i] is an estimate of the work involved in job i, such as the size
+ * of the file it processes.  See WorkerPoolCallbacks for the callbacks.
+ *
+ * Errors in the workers are reported by the workers themselves.  Returns
+ * true if all workers exited with status 0.
+ */
+bool
+run_worker_pool(int njobs, const uint64 *job_costs,
+				int nworkers, size_t result_size,
+				const WorkerPoolCallbacks *callbacks, void *arg)
+{
+	WorkerPoolJob *jobs;
+	uint64	   *worker_cost;
+	pid_t	   *worker_pid;
+	struct pollfd *pfds;
+	size_t		msgsize = WORKER_POOL_RESULT_OFFSET + result_size;
+	char	   *msg;
+	int			nrunning;
+	bool		success = true;
+
+	/* Each message must be written to the pipe atomically */
+	Assert(msgsize <= PIPE_BUF);
+
+	nworkers = Min(nworkers, njobs);
+	if (nworkers <= 0)
+		return true;
+
+	/* Assign each job to a worker. */
+	jobs = pg_malloc(sizeof(WorkerPoolJob) * njobs);
+	for (int i = 0; i < njobs; i++)
+	{
+		jobs[i].job = i;
+		jobs[i].cost = job_costs[i];
+	}
+	qsort(jobs, njobs, sizeof(WorkerPoolJob), worker_pool_job_cmp);
+	worker_cost = pg_malloc0(sizeof(uint64) * nworkers);
+	for (int i = 0; i < njobs; i++)
+	{
+		int			best = 0;
+
+		for (int w = 1; w < nworkers; w++)
+		{
+			if (worker_cost[w] < worker_cost[best])
+				best = w;
+		}
+		jobs[i].worker = best;
+		worker_cost[best] += jobs[i].cost;
+	}
+
+	msg = pg_malloc0(msgsize);
+
+	/* Launch the workers. */
+	worker_pid = pg_malloc(sizeof(pid_t) * nworkers);
+	pfds = pg_malloc(sizeof(struct pollfd) * nworkers);
+	for (int w = 0; w < nworkers; w++)
+	{
+		int			pipefd[2];
+
+		if (pipe(pipefd) < 0)
+			pg_fatal("could not create pipe: %m");
+
+		/* Flush stdio buffers so the child doesn't write them again. */
+		fflush(NULL);
+
+		worker_pid[w] = fork();
+		if (worker_pid[w] < 0)
+			pg_fatal("could not create worker process: %m");
+
+		if (worker_pid[w] == 0)
+		{
+			/* In the worker. */
+			close(pipefd[0]);
+			for (int i = 0; i < w; i++)
+				close(pfds[i].fd);
+
+			if (callbacks->worker_start)
+				callbacks->worker_start(arg);
+
+			for (int i = 0; i < njobs; i++)
+			{
+				if (jobs[i].worker != w)
+					continue;
+
+				memset(msg, 0, msgsize);
+				((WorkerPoolMessage *) msg)->job = jobs[i].job;
+				callbacks->run_job(jobs[i].job,
+								   msg + WORKER_POOL_RESULT_OFFSET, arg);
+				if (write(pipefd[1], msg, msgsize) != (ssize_t) msgsize)
+					pg_fatal("could not write to pipe: %m");
+			}
+			exit(callbacks->worker_exit_status ?
+				 callbacks->worker_exit_status(arg) : 0);
+		}
+
+		/* In the leader. */
+		close(pipefd[1]);
+		pfds[w].fd = pipefd[0];
+		pfds[w].events = POLLIN;
+	}
+
+	/* Collect results until every worker has closed its pipe. */
+	nrunning = nworkers;
+	while (nrunning > 0)
+	{
+		if (poll(pfds, nworkers, -1) < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			pg_fatal("%s() failed: %m", "poll");
+		}
+
+		for (int w = 0; w < nworkers; w++)
+		{
+			ssize_t		rc;
+			int			job;
+
+			if (pfds[w].fd < 0 || pfds[w].revents == 0)
+				continue;
+
+			/* Messages are written atomically, so we never see a partial one. */
+			rc = read(pfds[w].fd, msg, msgsize);
+			if (rc < 0)
+			{
+				if (errno == EINTR)
+					continue;
+				pg_fatal("could not read from pipe: %m");
+			}
+			if (rc == 0)
+			{
+				/* This worker is done, or has failed. */
+				close(pfds[w].fd);
+				pfds[w].fd = -1;
+				nrunning--;
+				continue;
+			}
+			job = ((WorkerPoolMessage *) msg)->job;
+			if (rc != (ssize_t) msgsize || job < 0 || job >= njobs)
+				pg_fatal("received invalid result from worker process");
+
+			if (callbacks->handle_result)
+				callbacks->handle_result(job,
+										 msg + WORKER_POOL_RESULT_OFFSET, arg);
+		}
+	}
+
+	/* Check how the workers exited. */
+	for (int w = 0; w < nworkers; w++)
+	{
+		int			status;
+
+		if (waitpid(worker_pid[w], &status, 0) < 0)
+			pg_fatal("could not wait for worker process: %m");
+		if (!WIFEXITED(status))
+			pg_log_error("worker process failed: %s",
+						 wait_result_to_str(status));
+		if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+			success = false;
+	}
+
+	pfree(jobs);
+	pfree(worker_cost);
+	pfree(worker_pid);
+	pfree(pfds);
+	pfree(msg);
+
+	return success;
+}
+
+#endif							/* WIN32 */
@@ -12,6 +12,9 @@
 #ifndef DETOAST_H
 #define DETOAST_H
 
+/* GUC */
+extern PGDLLIMPORT int detoast_cache_size;
+
 /*
  * Macro to fetch the possibly-unaligned contents of an EXTERNAL datum
  * into a local "struct varatt_external" toast pointer.  This should be
@@ -42,6 +42,7 @@
 /* "options" flag bits for heap_page_prune_and_freeze */
 #define HEAP_PAGE_PRUNE_MARK_UNUSED_NOW		(1 << 0)
 #define HEAP_PAGE_PRUNE_FREEZE				(1 << 1)
+#define HEAP_PAGE_PRUNE_FREEZE_EAGERLY		(1 << 2)
 
 typedef struct BulkInsertStateData *BulkInsertState;
 typedef struct GlobalVisState GlobalVisState;
@@ -367,6 +368,10 @@ extern TransactionId heap_index_delete_tuples(Relation rel,
 
 /* in heap/pruneheap.c */
 extern void heap_page_prune_opt(Relation relation, Buffer buffer);
+extern void heap_page_prune_deferred(Oid relid, BlockNumber blkno);
+extern void heap_page_freeze_request(Relation relation, BlockNumber blkno,
+									 bool try_now);
+extern void heap_page_freeze_deferred(Oid relid, BlockNumber blkno);
 extern void heap_page_prune_and_freeze(Relation relation, Buffer buffer,
 									   GlobalVisState *vistest,
 									   int options,
@@ -393,6 +398,13 @@ extern void log_heap_prune_and_freeze(Relation relation, Buffer buffer,
 /* in heap/vacuumlazy.c */
 extern void heap_vacuum_rel(Relation rel,
 							const VacuumParams params, BufferAccessStrategy bstrategy);
+extern void heap_vacuum_dead_items_worker(Relation rel, TidStore *dead_items,
+										  BufferAccessStrategy bstrategy,
+										  TransactionId OldestXmin,
+										  int myshare, int nshares,
+										  BlockNumber *vacuumed_pages,
+										  BlockNumber *vm_new_visible_pages,
+										  BlockNumber *vm_new_visible_frozen_pages);
 
 /* in heap/heapam_visibility.c */
 extern bool HeapTupleSatisfiesVisibility(HeapTuple htup, Snapshot snapshot,
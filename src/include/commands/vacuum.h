@@ -305,6 +305,9 @@ extern PGDLLIMPORT int vacuum_failsafe_age;
 extern PGDLLIMPORT int vacuum_multixact_failsafe_age;
 extern PGDLLIMPORT bool track_cost_delay_timing;
 extern PGDLLIMPORT bool vacuum_truncate;
+extern PGDLLIMPORT bool background_page_pruning;
+extern PGDLLIMPORT bool eager_page_freezing;
+extern PGDLLIMPORT bool eager_page_freezing_on_insert;
 
 /*
  * Relevant for vacuums implementing eager scanning. Normal vacuums may
@@ -394,6 +397,13 @@ extern void parallel_vacuum_cleanup_all_indexes(ParallelVacuumState *pvs,
 												long num_table_tuples,
 												int num_index_scans,
 												bool estimated_count);
+extern int	parallel_vacuum_heap_pass_begin(ParallelVacuumState *pvs,
+											TransactionId OldestXmin,
+											int *nshares);
+extern void parallel_vacuum_heap_pass_end(ParallelVacuumState *pvs,
+										  BlockNumber *vacuumed_pages,
+										  BlockNumber *vm_new_visible_pages,
+										  BlockNumber *vm_new_visible_frozen_pages);
 extern void parallel_vacuum_main(dsm_segment *seg, shm_toc *toc);
 
 /* in commands/analyze.c */
@@ -22,6 +22,9 @@
 typedef struct PartitionDispatchData *PartitionDispatch;
 typedef struct PartitionTupleRouting PartitionTupleRouting;
 
+/* Forward declaration, to avoid including plancache.h here */
+typedef struct CachedPlan CachedPlan;
+
 extern PartitionTupleRouting *ExecSetupPartitionTupleRouting(EState *estate,
 															 Relation rel);
 extern ResultRelInfo *ExecFindPartition(ModifyTableState *mtstate,
@@ -130,7 +133,29 @@ typedef struct PartitionPruneState
 	PartitionPruningData *partprunedata[FLEXIBLE_ARRAY_MEMBER];
 } PartitionPruneState;
 
-extern void ExecDoInitialPruning(EState *estate);
+/*
+ * InitialPruneResult
+ *		The outcome of performing the initial pruning steps of a PlannedStmt
+ *		before ExecutorStart(), as the plan cache does; see
+ *		ExecGetInitialPruneResult().
+ *
+ * plannedstmt			The statement that was pruned
+ * validsubplans		List with a Bitmapset of the surviving subplans for
+ *						each entry of plannedstmt->partPruneInfos, as
+ *						ExecDoInitialPruning() stores in es_part_prune_results
+ * unpruned_relids		RT indexes of the leaf partitions that survive
+ */
+typedef struct InitialPruneResult
+{
+	PlannedStmt *plannedstmt;
+	List	   *validsubplans;
+	Bitmapset  *unpruned_relids;
+} InitialPruneResult;
+
+extern void ExecDoInitialPruning(EState *estate, CachedPlan *cplan,
+								 int cplan_generation);
+extern InitialPruneResult *ExecGetInitialPruneResult(PlannedStmt *plannedstmt,
+													 ParamListInfo params);
 extern PartitionPruneState *ExecInitPartitionExecPruning(PlanState *planstate,
 														 int n_total_subplans,
 														 int part_prune_index,
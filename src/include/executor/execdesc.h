@@ -43,6 +43,11 @@ typedef struct QueryDesc
 	QueryEnvironment *queryEnv; /* query environment passed in */
 	int			instrument_options; /* OR of InstrumentOption flags */
 
+	/* Caller sets these if the plannedstmt belongs to a CachedPlan */
+	struct CachedPlan *cplan;	/* CachedPlan supplying the plannedstmt */
+	int			cplan_generation;	/* cplan->lock_generation as returned by
+									 * GetCachedPlan */
+
 	/* These fields are set by ExecutorStart */
 	TupleDesc	tupDesc;		/* descriptor for result tuples */
 	EState	   *estate;			/* executor's query-wide state */
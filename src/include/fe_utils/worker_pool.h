@@ -0,0 +1,46 @@
+/*-------------------------------------------------------------------------
+ *
+ * Pool of worker processes for frontend programs
+ *
+ * Portions Copyright (c) 1996-2025, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * src/include/fe_utils/worker_pool.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+#ifndef WIN32
+
+/*
+ * Callbacks for run_worker_pool().  'arg' is passed through unchanged.
+ *
+ * worker_start is called in each worker process before it runs its first
+ * job, and may be NULL.
+ *
+ * run_job is called in a worker process to run job 'job'.  It must fill in
+ * the result_size bytes at 'result', which are sent to the leader.
+ *
+ * handle_result is called in the leader for each result as it comes in, and
+ * may be NULL.
+ *
+ * worker_exit_status is called in each worker process after its last job to
+ * determine its exit status, and may be NULL, meaning 0.
+ */
+typedef struct WorkerPoolCallbacks
+{
+	void		(*worker_start) (void *arg);
+	void		(*run_job) (int job, void *result, void *arg);
+	void		(*handle_result) (int job, const void *result, void *arg);
+	int			(*worker_exit_status) (void *arg);
+} WorkerPoolCallbacks;
+
+extern bool run_worker_pool(int njobs, const uint64 *job_costs,
+							int nworkers, size_t result_size,
+							const WorkerPoolCallbacks *callbacks, void *arg);
+
+#endif							/* WIN32 */
+
+#endif							/* WORKER_POOL_H */
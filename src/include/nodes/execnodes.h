@@ -748,6 +748,9 @@ typedef struct EState
 	int			es_parallel_workers_launched;	/* number of workers actually
 												 * launched. */
 
+	bool		es_misestimated;	/* did a node see far more input rows
+									 * than the planner estimated? */
+
 	/* The per-query shared memory area to use for parallel execution. */
 	struct dsa_area *es_query_dsa;
 
@@ -2163,6 +2166,9 @@ typedef struct JoinState
  *		NeedNewOuter	   true if need new outer tuple on next call
  *		MatchedOuter	   true if found a join match for current outer tuple
  *		NullInnerTupleSlot prepared null tuple for left outer joins
+ *
+ *	The remaining fields are used when the plan allows switching to hashing
+ *	the inner plan's output (see nodeNestloop.c).
  * ----------------
  */
 typedef struct NestLoopState
@@ -2171,6 +2177,28 @@ typedef struct NestLoopState
 	bool		nl_NeedNewOuter;
 	bool		nl_MatchedOuter;
 	TupleTableSlot *nl_NullInnerTupleSlot;
+
+	double		nl_SwitchRows;	/* switch after this many outer tuples, or
+								 * 0 if switching isn't possible */
+	uint64		nl_OuterRows;	/* outer tuples fetched in this scan */
+	int			nl_NumHashKeys; /* number of hash keys */
+	Oid		   *nl_EqFuncOids;	/* per-key equality fns */
+	FmgrInfo   *nl_HashFunctions;	/* per-key hash fns */
+	Oid		   *nl_HashCollations;	/* per-key collations */
+	ProjectionInfo *nl_OuterKeyProj;	/* computes outer tuple's hash keys */
+	ProjectionInfo *nl_InnerKeyProj;	/* computes inner tuple's hash keys */
+	TupleHashTable nl_HashTable;	/* inner tuples, grouped by hash keys */
+	MemoryContext nl_HashContext;	/* memory context containing hash table */
+	bool		nl_HashFilled;	/* hash table filled and in use? */
+	bool		nl_HashFailed;	/* inner plan didn't fit in hash_mem */
+	TupleTableSlot *nl_HashTupleSlot;	/* slot for inner tuples from table */
+	List	   *nl_HashMatches; /* inner tuples for current outer tuple */
+	int			nl_HashMatchPos;	/* next entry of nl_HashMatches */
+
+	/* for EXPLAIN ANALYZE */
+	uint64		nl_SwitchedAt;	/* outer tuple at which we switched, or 0 */
+	uint64		nl_HashedRows;	/* inner tuples stored in hash table */
+	Size		nl_HashSpacePeak;	/* peak memory used by hash table */
 } NestLoopState;
 
 /* ----------------
@@ -298,6 +298,14 @@ struct PlannerInfo
 	List	   *join_rel_list;
 	struct HTAB *join_rel_hash pg_node_attr(read_write_ignore);
 
+	/*
+	 * child_rinfo_hash remembers the child RestrictInfos made by translating
+	 * a parent join's restriction clauses for partitionwise join, so that
+	 * each of them is only translated once no matter how many join orders
+	 * consider it.  NULL until first needed.
+	 */
+	struct HTAB *child_rinfo_hash pg_node_attr(read_write_ignore);
+
 	/*
 	 * When doing a dynamic-programming-style join search, join_rel_level[k]
 	 * is a list of all join-relation RelOptInfos of level k, and
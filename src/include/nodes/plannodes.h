@@ -980,6 +980,15 @@ typedef struct NestLoop
 	Join		join;
 	/* list of NestLoopParam nodes */
 	List	   *nestParams;
+
+	/*
+	 * Hashable join clauses (outer side on the left) that allow the executor
+	 * to switch to hashing the inner plan if the outer plan returns many more
+	 * rows than estimated, or NIL if that's not possible.
+	 */
+	List	   *hashclauses;
+	List	   *hashoperators;
+	List	   *hashcollations;
 } NestLoop;
 
 typedef struct NestLoopParam
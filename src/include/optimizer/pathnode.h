@@ -323,12 +323,19 @@ extern RelOptInfo *build_join_rel(PlannerInfo *root,
 								  SpecialJoinInfo *sjinfo,
 								  List *pushed_down_joins,
 								  List **restrictlist_ptr);
+extern RelOptInfo *build_grouped_join_rel(PlannerInfo *root,
+										  Relids joinrelids,
+										  RelOptInfo *agg_rel,
+										  RelOptInfo *other_rel,
+										  SpecialJoinInfo *sjinfo,
+										  List **restrictlist_ptr);
 extern Relids min_join_parameterization(PlannerInfo *root,
 										Relids joinrelids,
 										RelOptInfo *outer_rel,
 										RelOptInfo *inner_rel);
 extern RelOptInfo *fetch_upper_rel(PlannerInfo *root, UpperRelationKind kind,
 								   Relids relids);
+extern RelOptInfo *build_upper_rel(PlannerInfo *root, Relids relids);
 extern Relids find_childrel_parents(PlannerInfo *root, RelOptInfo *rel);
 extern ParamPathInfo *get_baserel_parampathinfo(PlannerInfo *root,
 												RelOptInfo *baserel,
@@ -22,6 +22,8 @@
  */
 extern PGDLLIMPORT bool enable_geqo;
 extern PGDLLIMPORT int geqo_threshold;
+extern PGDLLIMPORT int idp_threshold;
+extern PGDLLIMPORT int idp_block_size;
 extern PGDLLIMPORT int min_parallel_table_scan_size;
 extern PGDLLIMPORT int min_parallel_index_scan_size;
 extern PGDLLIMPORT bool enable_group_by_reordering;
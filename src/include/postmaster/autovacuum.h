@@ -23,6 +23,8 @@
 typedef enum
 {
 	AVW_BRINSummarizeRange,
+	AVW_HeapPrunePage,
+	AVW_HeapFreezePage,
 } AutoVacuumWorkItemType;
 
 
@@ -0,0 +1,41 @@
+/*-------------------------------------------------------------------------
+ *
+ * walcompress.h
+ *	  Compression of WAL data in the physical replication stream.
+ *
+ * Portions Copyright (c) 2025, PostgreSQL Global Development Group
+ *
+ * src/include/replication/walcompress.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef _WALCOMPRESS_H
+#define _WALCOMPRESS_H
+
+#include "access/xlogdefs.h"
+#include "common/compression.h"
+#include "lib/stringinfo.h"
+
+/*
+ * Amount of previously streamed WAL that is used as a dictionary when
+ * compressing the next chunk.  Both LZ4 and zstd can't make use of more
+ * than this with their default window settings, and the sender and the
+ * receiver must agree on it.
+ */
+#define WAL_COMPRESS_HISTORY_SIZE	(64 * 1024)
+
+typedef struct WalStreamCompressor WalStreamCompressor;
+
+extern WalStreamCompressor *WalStreamCompressorCreate(pg_compress_algorithm algorithm,
+													  int segsize,
+													  bool decompress);
+extern void WalStreamCompressorFree(WalStreamCompressor *wsc);
+extern bool WalStreamCompress(WalStreamCompressor *wsc, XLogRecPtr dataStart,
+							  const char *src, int srclen, StringInfo dst);
+extern void WalStreamDecompress(WalStreamCompressor *wsc, XLogRecPtr dataStart,
+								const char *src, int srclen,
+								char *dst, int rawlen);
+extern void WalStreamRemember(WalStreamCompressor *wsc, XLogRecPtr dataStart,
+							  const char *data, int len);
+
+#endif							/* _WALCOMPRESS_H */
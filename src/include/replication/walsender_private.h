@@ -13,6 +13,7 @@
 #define _WALSENDER_PRIVATE_H
 
 #include "access/xlog.h"
+#include "common/compression.h"
 #include "lib/ilist.h"
 #include "nodes/nodes.h"
 #include "nodes/replnodes.h"
@@ -76,6 +77,14 @@ typedef struct WalSnd
 	TimestampTz replyTime;
 
 	ReplicationKind kind;
+
+	/*
+	 * Compression used for the WAL stream, and the amount of WAL sent since
+	 * streaming started, before and after compression.
+	 */
+	pg_compress_algorithm compression;
+	uint64		sentBytes;
+	uint64		sentCompressedBytes;
 } WalSnd;
 
 extern PGDLLIMPORT WalSnd *MyWalSnd;
@@ -168,6 +168,8 @@ extern int	MakePGDirectory(const char *directoryName);
 extern void InitFileAccess(void);
 extern void InitTemporaryFileAccess(void);
 extern void set_max_safe_fds(void);
+extern void RestoreOriginalOpenFileLimit(void);
+extern void RestoreCustomOpenFileLimit(void);
 extern void closeAllVfds(void);
 extern void SetTempTablespaces(Oid *tableSpaces, int numSpaces);
 extern bool TempTablespacesAreSet(void);
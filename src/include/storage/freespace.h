@@ -21,10 +21,17 @@
 /* prototypes for public functions in freespace.c */
 extern Size GetRecordedFreeSpace(Relation rel, BlockNumber heapBlk);
 extern BlockNumber GetPageWithFreeSpace(Relation rel, Size spaceNeeded);
+extern BlockNumber GetPageWithFreeSpaceExtended(Relation rel, Size spaceNeeded,
+												int start_offset);
 extern BlockNumber RecordAndGetPageWithFreeSpace(Relation rel,
 												 BlockNumber oldPage,
 												 Size oldSpaceAvail,
 												 Size spaceNeeded);
+extern BlockNumber RecordAndGetPageWithFreeSpaceExtended(Relation rel,
+														 BlockNumber oldPage,
+														 Size oldSpaceAvail,
+														 Size spaceNeeded,
+														 int start_offset);
 extern void RecordPageWithFreeSpace(Relation rel, BlockNumber heapBlk,
 									Size spaceAvail);
 extern void XLogRecordPageWithFreeSpace(RelFileLocator rlocator, BlockNumber heapBlk,
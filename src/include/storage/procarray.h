@@ -19,6 +19,8 @@
 #include "utils/relcache.h"
 #include "utils/snapshot.h"
 
+/* GUC parameter */
+extern PGDLLIMPORT bool shared_snapshot_cache;
 
 extern Size ProcArrayShmemSize(void);
 extern void ProcArrayShmemInit(void);
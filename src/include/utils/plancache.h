@@ -26,6 +26,10 @@
 /* Forward declarations, to avoid including parsenodes.h here */
 typedef struct Query Query;
 typedef struct RawStmt RawStmt;
+typedef struct PlannedStmt PlannedStmt;
+
+/* Likewise for execPartition.h */
+typedef struct InitialPruneResult InitialPruneResult;
 
 /* possible values for plan_cache_mode */
 typedef enum
@@ -35,8 +39,17 @@ typedef enum
 	PLAN_CACHE_MODE_FORCE_CUSTOM_PLAN,
 }			PlanCacheMode;
 
-/* GUC parameter */
+/* GUC parameters */
 extern PGDLLIMPORT int plan_cache_mode;
+extern PGDLLIMPORT double plan_cache_misestimate_factor;
+
+/*
+ * A generic plan is put aside after this many consecutive executions that
+ * are misestimated according to plan_cache_misestimate_factor, and tried
+ * again after this many custom plans.
+ */
+#define PLAN_CACHE_MISESTIMATE_EXECUTIONS	3
+#define PLAN_CACHE_MISESTIMATE_RETRY		16
 
 /* Optional callback to editorialize on rewritten parse trees */
 typedef void (*PostRewriteHook) (List *querytree_list, void *arg);
@@ -165,11 +178,18 @@ typedef struct CachedPlan
 	bool		is_valid;		/* is the stmt_list currently valid? */
 	Oid			planRoleId;		/* Role ID the plan was created for */
 	bool		dependsOnRole;	/* is plan specific to that role? */
+	int			num_misestimates;	/* # of consecutive executions that saw
+									 * far more rows than expected */
+	int			num_misestimate_skips;	/* # of times not used since */
 	TransactionId saved_xmin;	/* if valid, replan when TransactionXmin
 								 * changes from this value */
 	int			generation;		/* parent's generation number for this plan */
 	int			refcount;		/* count of live references to this struct */
 	MemoryContext context;		/* context containing this CachedPlan */
+	/* initial pruning done when the plan was last locked for execution: */
+	int			lock_generation;	/* incremented each time it is locked */
+	List	   *prune_results;	/* list of InitialPruneResults */
+	MemoryContext prune_context;	/* context containing them, or NULL */
 } CachedPlan;
 
 /*
@@ -242,6 +262,10 @@ extern CachedPlan *GetCachedPlan(CachedPlanSource *plansource,
 								 ResourceOwner owner,
 								 QueryEnvironment *queryEnv);
 extern void ReleaseCachedPlan(CachedPlan *plan, ResourceOwner owner);
+extern void CachedPlanNoteEstimate(CachedPlan *plan, bool misestimated);
+extern InitialPruneResult *CachedPlanTakePruneResult(CachedPlan *plan,
+													 int generation,
+													 PlannedStmt *plannedstmt);
 
 extern bool CachedPlanAllowsSimpleValidityCheck(CachedPlanSource *plansource,
 												CachedPlan *plan,
@@ -342,6 +342,7 @@ typedef struct StdRdOptions
 	int32		vl_len_;		/* varlena header (do not touch directly!) */
 	int			fillfactor;		/* page fill factor in percent (0..100) */
 	int			toast_tuple_target; /* target for tuple toasting */
+	int			insert_targets; /* pages to spread concurrent inserts over */
 	AutoVacOpts autovacuum;		/* autovacuum-related options */
 	bool		user_catalog_table; /* use as an additional catalog relation */
 	int			parallel_workers;	/* max number of parallel workers */
@@ -367,6 +368,14 @@ typedef struct StdRdOptions
 	((relation)->rd_options ? \
 	 ((StdRdOptions *) (relation)->rd_options)->toast_tuple_target : (defaulttarg))
 
+/*
+ * RelationGetInsertTargets
+ *		Returns the relation's insert_targets.  Note multiple eval of argument!
+ */
+#define RelationGetInsertTargets(relation, defaulttargets) \
+	((relation)->rd_options ? \
+	 ((StdRdOptions *) (relation)->rd_options)->insert_targets : (defaulttargets))
+
 /*
  * RelationGetFillFactor
  *		Returns the relation's fillfactor.  Note multiple eval of argument!
@@ -0,0 +1,86 @@
+# Copyright (c) 2025, PostgreSQL Global Development Group
+
+# Test that with background_page_pruning, a query that finds a page worth
+# pruning leaves it to an autovacuum worker.  This test uses an injection
+# point located at the beginning of the autovacuum worker startup to keep
+# the workers away until the page has been queued.
+
+use strict;
+use warnings FATAL => 'all';
+use PostgreSQL::Test::Cluster;
+use Test::More;
+
+if ($ENV{enable_injection_points} ne 'yes')
+{
+	plan skip_all => 'Injection points not supported by this build';
+}
+
+my $node = PostgreSQL::Test::Cluster->new('node');
+$node->init;
+
+# This ensures a quick worker spawn.
+$node->append_conf(
+	'postgresql.conf', qq(
+autovacuum_naptime = 1
+background_page_pruning = on
+));
+$node->start;
+
+# Check if the extensions are available, as it may be possible that this
+# script is run with installcheck, where the modules would not be installed
+# by default.
+if (   !$node->check_extension('injection_points')
+	|| !$node->check_extension('pageinspect'))
+{
+	plan skip_all => 'Extension injection_points or pageinspect not installed';
+}
+
+$node->safe_psql('postgres', 'CREATE EXTENSION injection_points;');
+$node->safe_psql('postgres', 'CREATE EXTENSION pageinspect;');
+
+# From this point, autovacuum workers will wait at startup.
+$node->safe_psql('postgres',
+	"SELECT injection_points_attach('autovacuum-worker-start', 'wait');");
+
+# Accelerate worker creation in case we reach this point before the naptime
+# ends.
+$node->reload();
+
+# Wait until an autovacuum worker starts, and until any worker that started
+# before the injection point was attached is gone.
+$node->wait_for_event('autovacuum worker', 'autovacuum-worker-start');
+$node->poll_query_until('postgres',
+		"SELECT count(*) = 0 FROM pg_stat_activity "
+	  . "WHERE backend_type = 'autovacuum worker' "
+	  . "AND wait_event IS DISTINCT FROM 'autovacuum-worker-start';");
+
+# Fill most of a page, leaving less than a tenth of it free after a few HOT
+# updates.  Autovacuum is disabled for the table so that the only thing a
+# worker does with it is the work item.
+$node->safe_psql(
+	'postgres', qq(
+    CREATE TABLE prune_me (a int, b text) WITH (autovacuum_enabled = off);
+    INSERT INTO prune_me SELECT g, repeat('x', 100) FROM generate_series(1, 50) g;
+    UPDATE prune_me SET a = -a WHERE a <= 3;
+));
+
+# This would normally prune the page, but only queues it now.
+is($node->safe_psql('postgres', 'SELECT count(*) FROM prune_me;'),
+	'50', 'table scanned');
+
+my $redirected = "SELECT count(*) FROM heap_page_items(get_raw_page('prune_me', 0)) "
+  . "WHERE lp_flags = 2;";
+is($node->safe_psql('postgres', $redirected),
+	'0', 'page not pruned by the query');
+
+# Let the workers go, and wait for one of them to prune the page.
+$node->safe_psql('postgres',
+	"SELECT injection_points_detach('autovacuum-worker-start');");
+$node->safe_psql('postgres',
+	"SELECT injection_points_wakeup('autovacuum-worker-start');");
+
+ok( $node->poll_query_until(
+		'postgres', "SELECT ($redirected) = 3;"),
+	'page pruned by autovacuum');
+
+done_testing();
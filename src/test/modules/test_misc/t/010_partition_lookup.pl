@@ -0,0 +1,111 @@
+# Copyright (c) 2025, PostgreSQL Global Development Group
+
+# Benchmark single-row lookups in a table with many partitions, with custom
+# and generic plans.  For each partition count, this reports the planning
+# time of a custom plan and the time per lookup with either kind of plan,
+# and checks that executing the generic plan only locks the partition that
+# survives initial pruning.
+#
+# By default only a few small partition counts are tried, so that this runs
+# quickly as part of the test suite.  An actual benchmark sets
+# PG_TEST_PARTITION_COUNTS, for example to "10,100,1000,8000", and
+# PG_TEST_PARTITION_LOOKUPS to a larger number of lookups.
+
+use strict;
+use warnings FATAL => 'all';
+use PostgreSQL::Test::Cluster;
+use Test::More;
+use Time::HiRes qw(time);
+
+my @counts = split(/,/, $ENV{PG_TEST_PARTITION_COUNTS} // '10,100,1000');
+my $lookups = $ENV{PG_TEST_PARTITION_LOOKUPS} // 1000;
+
+my $node = PostgreSQL::Test::Cluster->new('node');
+$node->init;
+$node->append_conf(
+	'postgresql.conf', qq(
+max_locks_per_transaction = 256
+autovacuum = off
+));
+$node->start;
+
+# Time per lookup in microseconds, using the plan cache through PL/pgSQL.
+$node->safe_psql(
+	'postgres', q{
+CREATE FUNCTION lookup_loop(n int, nparts int) RETURNS float8
+LANGUAGE plpgsql AS $$
+DECLARE
+	start timestamptz := clock_timestamp();
+	r record;
+BEGIN
+	FOR i IN 1..n LOOP
+		SELECT * INTO r FROM lookup WHERE id = i % nparts;
+	END LOOP;
+	RETURN extract(epoch FROM clock_timestamp() - start) * 1000000 / n;
+END
+$$;
+});
+
+foreach my $nparts (@counts)
+{
+	my $start = time();
+
+	$node->safe_psql(
+		'postgres', qq{
+DROP TABLE IF EXISTS lookup;
+CREATE TABLE lookup (id int, val int) PARTITION BY RANGE (id);
+DO \$\$
+BEGIN
+	FOR i IN 0..$nparts - 1 LOOP
+		EXECUTE format('CREATE TABLE lookup_%s PARTITION OF lookup FOR VALUES FROM (%s) TO (%s)',
+					   i, i, i + 1);
+	END LOOP;
+END
+\$\$;
+INSERT INTO lookup SELECT g, g FROM generate_series(0, $nparts - 1) g;
+ANALYZE lookup;
+});
+	note sprintf("%d partitions created in %.1f s", $nparts, time() - $start);
+
+	# Planning time of a custom plan, taking the best of a few runs.
+	my $planning;
+	for (1 .. 5)
+	{
+		my $out = $node->safe_psql('postgres',
+			'EXPLAIN (SUMMARY ON, COSTS OFF) SELECT * FROM lookup WHERE id = 1'
+		);
+		$out =~ /Planning Time: ([0-9.]+) ms/
+		  or die "could not find planning time in EXPLAIN output";
+		$planning = $1 if !defined $planning || $1 < $planning;
+	}
+
+	my $custom = $node->safe_psql('postgres',
+		"SET plan_cache_mode = force_custom_plan; SELECT lookup_loop($lookups, $nparts)"
+	);
+	my $generic = $node->safe_psql('postgres',
+		"SET plan_cache_mode = force_generic_plan; SELECT lookup_loop($lookups, $nparts)"
+	);
+
+	# Locks held while executing the generic plan.  The last line of the
+	# output is the count.
+	my $out = $node->safe_psql(
+		'postgres', q{
+SET plan_cache_mode = force_generic_plan;
+PREPARE q (int) AS SELECT * FROM lookup WHERE id = $1;
+EXECUTE q (1);
+BEGIN;
+EXECUTE q (1);
+SELECT count(*) FROM pg_locks
+  WHERE pid = pg_backend_pid() AND relation::regclass::text LIKE 'lookup%';
+COMMIT;
+});
+	my $locks = (split /\n/, $out)[-1];
+	is($locks, '2',
+		"generic plan with $nparts partitions locks one partition");
+
+	note sprintf(
+		"%d partitions: planning %.3f ms, custom plan %.1f us/lookup, generic plan %.1f us/lookup",
+		$nparts, $planning, $custom, $generic);
+}
+
+done_testing();
@@ -0,0 +1,114 @@
+# Copyright (c) 2025, PostgreSQL Global Development Group
+
+# Check how many relation locks end up in the shared lock table, rather than
+# in the backend's fast-path slots, when a transaction locks many relations.
+#
+# With the default max_locks_per_transaction, each backend has 4 groups of 16
+# fast-path slots.  A relation may use a slot in either of two groups, chosen
+# by independent hashes.  For each set of relations, the test also reports
+# how many locks would have overflowed with only the first group, which is
+# how relations were placed before.
+
+use strict;
+use warnings FATAL => 'all';
+use PostgreSQL::Test::Cluster;
+use Test::More;
+
+my $ngroups = 4;
+my $slots_per_group = 16;
+
+my $node = PostgreSQL::Test::Cluster->new('node');
+$node->init;
+$node->append_conf(
+	'postgresql.conf', qq(
+max_locks_per_transaction = 64
+autovacuum = off
+));
+$node->start;
+
+$node->safe_psql(
+	'postgres', q{
+DO $$
+BEGIN
+	FOR i IN 1..400 LOOP
+		EXECUTE format('CREATE TABLE fp_%s (a int)', i);
+	END LOOP;
+END
+$$;
+});
+
+# Number of locks that would not fit if every relation could only use the
+# group given by the original FAST_PATH_REL_GROUP formula.
+sub single_group_overflow
+{
+	my @oids = @_;
+	my @used = (0) x $ngroups;
+	my $overflow = 0;
+
+	foreach my $oid (@oids)
+	{
+		my $group = ($oid * 49157) & ($ngroups - 1);
+
+		if ($used[$group] < $slots_per_group)
+		{
+			$used[$group]++;
+		}
+		else
+		{
+			$overflow++;
+		}
+	}
+	return $overflow;
+}
+
+# Lock the given relations in one transaction and return the number of locks
+# on them held outside the fast path.
+sub shared_table_locks
+{
+	my @oids = @_;
+	my $names = $node->safe_psql('postgres',
+		"SELECT string_agg(oid::regclass::text, ', ' ORDER BY oid) FROM pg_class WHERE oid IN ("
+		  . join(', ', @oids) . ")");
+
+	# The first transaction only warms up the caches, so that the second one
+	# does not take any catalog locks before locking the tables.
+	my $out = $node->safe_psql(
+		'postgres', qq{
+BEGIN;
+LOCK TABLE $names IN ACCESS SHARE MODE;
+COMMIT;
+BEGIN;
+LOCK TABLE $names IN ACCESS SHARE MODE;
+SELECT count(*) FILTER (WHERE fastpath) || ' ' || count(*) FILTER (WHERE NOT fastpath)
+  FROM pg_locks
+  WHERE pid = pg_backend_pid() AND relation::regclass::text LIKE 'fp\\_%';
+COMMIT;
+});
+	my ($fast, $shared) = split / /, (split /\n/, $out)[-1];
+
+	is($fast + $shared, scalar(@oids), 'all relations are locked');
+	return $shared;
+}
+
+my @all = split /\n/,
+  $node->safe_psql('postgres',
+	"SELECT oid FROM pg_class WHERE relname LIKE 'fp\\_%' ORDER BY oid");
+
+# Relations that all map to the same group with the original formula.  Only
+# 16 of them could use the fast path before.
+my @same = (grep { (($_ * 49157) & ($ngroups - 1)) == 0 } @all)[0 .. 31];
+my $before = single_group_overflow(@same);
+my $after = shared_table_locks(@same);
+note "32 relations in one group: $after locks in the shared lock table, $before with a single group";
+is($before, 16, 'single group placement overflows');
+cmp_ok($after, '<', $before,
+	'second group keeps more locks on the fast path');
+
+# Consecutively created relations, filling 3/4 of the fast-path slots.
+my @consecutive = @all[0 .. 47];
+$before = single_group_overflow(@consecutive);
+$after = shared_table_locks(@consecutive);
+note "48 consecutive relations: $after locks in the shared lock table, $before with a single group";
+cmp_ok($after, '<=', 2, 'few consecutive relations overflow');
+
+done_testing();
@@ -0,0 +1,116 @@
+# Copyright (c) 2025, PostgreSQL Global Development Group
+
+# Stress test for shared_snapshot_cache.  Read-only sessions publish and copy
+# snapshots through the cache while other sessions keep committing and
+# aborting transfers between accounts, some of them with enough
+# subtransactions to overflow the subxid cache.  A reader that copied a torn
+# or stale snapshot would see a partial transfer, so the readers check that
+# the balances always add up.  All writers lock the rows in ascending order,
+# so that they don't deadlock.
+
+use strict;
+use warnings FATAL => 'all';
+use PostgreSQL::Test::Cluster;
+use PostgreSQL::Test::Utils;
+use Test::More;
+
+my $node = PostgreSQL::Test::Cluster->new('node');
+$node->init;
+$node->append_conf(
+	'postgresql.conf', qq(
+shared_snapshot_cache = on
+max_connections = 40
+));
+$node->start;
+
+is($node->safe_psql('postgres', 'SHOW shared_snapshot_cache'),
+	'on', 'cache is enabled');
+
+my ($ret, $stdout, $stderr) =
+  $node->psql('postgres', 'SET shared_snapshot_cache = off');
+like(
+	$stderr,
+	qr/parameter "shared_snapshot_cache" cannot be changed now/,
+	'cache cannot be disabled by a session');
+
+$node->safe_psql(
+	'postgres', q{
+CREATE TABLE acct (id int PRIMARY KEY, bal int NOT NULL);
+INSERT INTO acct SELECT g, 0 FROM generate_series(1, 100) g;
+});
+
+# A snapshot copied from the cache must not hide transactions that committed
+# after it was published.
+$node->safe_psql('postgres', 'SELECT count(*) FROM acct');
+$node->safe_psql('postgres', 'INSERT INTO acct VALUES (101, 0)');
+is($node->safe_psql('postgres', 'SELECT count(*) FROM acct'),
+	'101', 'committed row is visible to the next snapshot');
+$node->safe_psql('postgres', 'DELETE FROM acct WHERE id = 101');
+
+$node->pgbench(
+	'--no-vacuum --client=20 --jobs=4 --transactions=300',
+	0,
+	[qr{actually processed}],
+	[qr{^$}],
+	'concurrent transfers and readers',
+	{
+		'012_transfer' => q{
+			\set a random(1, 100)
+			\set b random(1, 100)
+			\set lo least(:a, :b)
+			\set hi greatest(:a, :b)
+			\set x random(1, 1000)
+			BEGIN;
+			UPDATE acct SET bal = bal - :x WHERE id = :lo;
+			UPDATE acct SET bal = bal + :x WHERE id = :hi;
+			COMMIT;
+		},
+		'012_transfer_abort' => q{
+			\set a random(1, 100)
+			\set x random(1, 1000)
+			BEGIN;
+			UPDATE acct SET bal = bal - :x WHERE id = :a;
+			ROLLBACK;
+		},
+		'012_transfer_subxacts' => q{
+			DO $$
+			BEGIN
+				FOR i IN 1..80 LOOP
+					BEGIN
+						UPDATE acct SET bal = bal - i WHERE id = i;
+						UPDATE acct SET bal = bal + i WHERE id = i + 1;
+					EXCEPTION WHEN OTHERS THEN
+						RAISE;
+					END;
+				END LOOP;
+			END
+			$$;
+		},
+		'012_read@4' => q{
+			SELECT 1 / (sum(bal) = 0)::int FROM acct;
+			SELECT 1 / (count(*) = 100)::int FROM acct;
+		},
+		'012_read_repeatable@2' => q{
+			BEGIN ISOLATION LEVEL REPEATABLE READ;
+			SELECT sum(bal) AS s1 FROM acct \gset
+			SELECT pg_sleep(0.001);
+			SELECT 1 / (sum(bal) = :s1 AND :s1 = 0)::int FROM acct;
+			COMMIT;
+		},
+	});
+
+# Readers must keep working after the cache is disabled and enabled again.
+$node->safe_psql('postgres',
+	'ALTER SYSTEM SET shared_snapshot_cache = off; SELECT pg_reload_conf()');
+$node->poll_query_until('postgres', 'SHOW shared_snapshot_cache', 'off');
+$node->safe_psql('postgres', 'UPDATE acct SET bal = bal + 1 WHERE id = 1');
+$node->safe_psql('postgres', 'UPDATE acct SET bal = bal - 1 WHERE id = 1');
+$node->safe_psql('postgres',
+	'ALTER SYSTEM RESET shared_snapshot_cache; SELECT pg_reload_conf()');
+$node->poll_query_until('postgres', 'SHOW shared_snapshot_cache', 'on');
+
+is($node->safe_psql('postgres', 'SELECT sum(bal) FROM acct'),
+	'0', 'balances add up after the run');
+
+$node->stop;
+done_testing();
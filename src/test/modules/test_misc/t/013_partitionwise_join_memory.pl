@@ -0,0 +1,81 @@
+# Copyright (c) 2025, PostgreSQL Global Development Group
+
+# Report the planner memory used by two-way and three-way partitionwise joins
+# of tables with many partitions, as shown by EXPLAIN (MEMORY).  The child
+# join clauses are translated once and shared by all the join orders, so the
+# three-way join should not need much more memory per partition than the
+# two-way join.
+#
+# By default only a few small partition counts are tried, so that this runs
+# quickly as part of the test suite.  An actual benchmark sets
+# PG_TEST_PARTITION_COUNTS, for example to "100,1000,2000".
+
+use strict;
+use warnings FATAL => 'all';
+use PostgreSQL::Test::Cluster;
+use Test::More;
+
+my @counts = split(/,/, $ENV{PG_TEST_PARTITION_COUNTS} // '10,100');
+
+my $node = PostgreSQL::Test::Cluster->new('node');
+$node->init;
+$node->append_conf(
+	'postgresql.conf', qq(
+enable_partitionwise_join = on
+max_locks_per_transaction = 1024
+autovacuum = off
+));
+$node->start;
+
+# Planner memory used, in kB, for the given query.
+sub planner_memory
+{
+	my ($query) = @_;
+	my $out = $node->safe_psql('postgres',
+		"EXPLAIN (MEMORY, COSTS OFF, FORMAT JSON) $query");
+
+	$out =~ /"Memory Used": ([0-9]+)/
+	  or die "could not find memory usage in EXPLAIN output";
+	return $1;
+}
+
+foreach my $nparts (@counts)
+{
+	$node->safe_psql(
+		'postgres', qq{
+DROP TABLE IF EXISTS pwj1, pwj2, pwj3;
+CREATE TABLE pwj1 (a int, b int) PARTITION BY HASH (a);
+CREATE TABLE pwj2 (a int, b int) PARTITION BY HASH (a);
+CREATE TABLE pwj3 (a int, b int) PARTITION BY HASH (a);
+DO \$\$
+BEGIN
+	FOR i IN 0..$nparts - 1 LOOP
+		FOR t IN 1..3 LOOP
+			EXECUTE format('CREATE TABLE pwj%s_%s PARTITION OF pwj%s FOR VALUES WITH (MODULUS %s, REMAINDER %s)',
+						   t, i, t, $nparts, i);
+		END LOOP;
+	END LOOP;
+END
+\$\$;
+});
+
+	my $two = planner_memory(
+		'SELECT * FROM pwj1 JOIN pwj2 USING (a) WHERE pwj1.b = pwj2.b');
+	my $three = planner_memory(
+		'SELECT * FROM pwj1 JOIN pwj2 USING (a) JOIN pwj3 USING (a) WHERE pwj1.b = pwj3.b'
+	);
+
+	note sprintf(
+		"%d partitions: two-way join %d kB (%.1f kB/partition), three-way join %d kB (%.1f kB/partition)",
+		$nparts, $two, $two / $nparts, $three, $three / $nparts);
+
+	like(
+		$node->safe_psql(
+			'postgres',
+			'EXPLAIN (COSTS OFF) SELECT * FROM pwj1 JOIN pwj2 USING (a) JOIN pwj3 USING (a)'
+		),
+		qr/\AAppend\n\s+->  (Hash Join|Merge Join|Nested Loop)/,
+		"three-way join of $nparts partitions is done partitionwise");
+}
+
+done_testing();
@@ -0,0 +1,58 @@
+
+# Copyright (c) 2025, PostgreSQL Global Development Group
+
+# Test compression of the physical replication stream
+use strict;
+use warnings FATAL => 'all';
+use PostgreSQL::Test::Cluster;
+use PostgreSQL::Test::Utils;
+use Test::More;
+
+my @methods;
+push @methods, 'lz4' if check_pg_config("#define USE_LZ4 1");
+push @methods, 'zstd' if check_pg_config("#define USE_ZSTD 1");
+
+if (!@methods)
+{
+	plan skip_all => 'server was not built with LZ4 or zstd support';
+}
+
+my $node_primary = PostgreSQL::Test::Cluster->new('primary');
+$node_primary->init(allows_streaming => 1);
+$node_primary->start;
+$node_primary->backup('backup');
+
+$node_primary->safe_psql('postgres', "CREATE TABLE tab_int (a int)");
+
+foreach my $method (@methods)
+{
+	my $node_standby = PostgreSQL::Test::Cluster->new("standby_$method");
+	$node_standby->init_from_backup($node_primary, 'backup',
+		has_streaming => 1);
+	$node_standby->append_conf('postgresql.conf',
+		"wal_receiver_compression = $method");
+	$node_standby->start;
+
+	# Generate enough WAL to span several messages and a segment switch.
+	$node_primary->safe_psql('postgres',
+		"INSERT INTO tab_int SELECT generate_series(1, 100000)");
+	$node_primary->safe_psql('postgres', "SELECT pg_switch_wal()");
+	$node_primary->safe_psql('postgres',
+		"INSERT INTO tab_int SELECT generate_series(1, 100000)");
+	$node_primary->wait_for_replay_catchup($node_standby);
+
+	is( $node_standby->safe_psql('postgres', "SELECT count(*) FROM tab_int"),
+		$node_primary->safe_psql('postgres', "SELECT count(*) FROM tab_int"),
+		"standby with $method compression replays streamed WAL");
+
+	my $result = $node_primary->safe_psql('postgres',
+		"SELECT compression, sent_compressed_bytes < sent_bytes
+		 FROM pg_stat_replication WHERE application_name = 'standby_$method'"
+	);
+	is($result, "$method|t",
+		"pg_stat_replication reports $method compression of the stream");
+
+	$node_standby->stop;
+}
+
+done_testing();
@@ -1694,3 +1694,51 @@ drop table agg_hash_1;
 drop table agg_hash_2;
 drop table agg_hash_3;
 drop table agg_hash_4;
+
+-- Test partial aggregation below a join (eager aggregation)
+create table eager_agg_fact (dim_id int, amount int, qty int);
+create table eager_agg_dim (id int primary key, name text);
+insert into eager_agg_dim select i, 'dim' || (i % 5) from generate_series(1, 10) i;
+insert into eager_agg_fact select i % 10 + 1, i % 7, i % 3 from generate_series(1, 10000) i;
+analyze eager_agg_fact, eager_agg_dim;
+-- Show the aggregation and join nodes of a plan, ignoring the strategies
+create function explain_eager_agg(query text) returns setof text
+language plpgsql as
+$$
+declare
+    ln text;
+begin
+    for ln in execute format('explain (costs off) %s', query)
+    loop
+        ln := regexp_replace(ln, '^\s*(->\s+)?', '');
+        if ln ~ '^(Finalize |Partial )?\w*Aggregate' then
+            return next regexp_replace(ln, '\w*Aggregate', 'Aggregate');
+        elsif ln ~ '^Group Key' then
+            return next ln;
+        elsif ln ~ '^(\w+ Join|Nested Loop)' then
+            return next 'Join';
+        end if;
+    end loop;
+end;
+$$;
+set enable_eager_aggregate = on;
+select explain_eager_agg($$
+select d.name, sum(f.amount), count(*), max(f.qty)
+  from eager_agg_fact f join eager_agg_dim d on f.dim_id = d.id
+  group by d.name order by d.name$$);
+select d.name, sum(f.amount), count(*), max(f.qty)
+  from eager_agg_fact f join eager_agg_dim d on f.dim_id = d.id
+  group by d.name order by d.name;
+select sum(f.amount), count(*)
+  from eager_agg_fact f join eager_agg_dim d on f.dim_id = d.id
+  where d.name = 'dim1';
+select d.name, sum(f.amount), count(*)
+  from eager_agg_fact f join eager_agg_dim d on f.dim_id <= d.id
+  group by d.name order by d.name;
+reset enable_eager_aggregate;
+select explain_eager_agg($$
+select d.name, sum(f.amount), count(*), max(f.qty)
+  from eager_agg_fact f join eager_agg_dim d on f.dim_id = d.id
+  group by d.name order by d.name$$);
+drop table eager_agg_fact, eager_agg_dim;
+drop function explain_eager_agg(text);
@@ -188,3 +188,25 @@ select explain_filter('explain (analyze,buffers off,costs off) select sum(n) ove
 -- Test tuplestore storage usage in Window aggregate (memory and disk case, final result is disk)
 select explain_filter('explain (analyze,buffers off,costs off) select sum(n) over(partition by m) from (SELECT n < 3 as m, n from generate_series(1,2500) a(n))');
 reset work_mem;
+
+-- Test detoast cache counters
+create temp table detoast_test (f1 text);
+alter table detoast_test alter column f1 set storage external;
+insert into detoast_test values (repeat('x', 10000));
+create function pg_temp.detoast_cache_lines(query text) returns setof text
+language plpgsql as
+$$
+declare
+    ln text;
+begin
+    for ln in execute query
+    loop
+        if ln like '%Detoast Cache%' then
+            return next ln;
+        end if;
+    end loop;
+end;
+$$;
+set detoast_cache_size = '1MB';
+select * from pg_temp.detoast_cache_lines('explain (analyze, buffers, costs off, summary off, timing off) select f1 = f1 from detoast_test');
+reset detoast_cache_size;
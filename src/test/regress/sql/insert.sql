@@ -674,3 +674,30 @@ alter table returningwrtest2 drop c;
 alter table returningwrtest attach partition returningwrtest2 for values in (2);
 insert into returningwrtest values (2, 'foo') returning returningwrtest;
 drop table returningwrtest;
+
+-- check tuple routing for keys that are compared inline
+create table inlinecmp_range (a int2) partition by range (a);
+create table inlinecmp_range_lo partition of inlinecmp_range for values from (minvalue) to (-100);
+create table inlinecmp_range_mid partition of inlinecmp_range for values from (-100) to (100);
+create table inlinecmp_range_hi partition of inlinecmp_range for values from (100) to (maxvalue);
+insert into inlinecmp_range select s.a from generate_series(-200, 200, 10) s(a);
+select tableoid::regclass, count(*), min(a), max(a) from inlinecmp_range group by 1 order by 1;
+drop table inlinecmp_range;
+
+create table inlinecmp_list (a int8) partition by list (a);
+create table inlinecmp_list_1 partition of inlinecmp_list for values in (1, 3);
+create table inlinecmp_list_2 partition of inlinecmp_list for values in (2, 4);
+create table inlinecmp_list_def partition of inlinecmp_list default;
+insert into inlinecmp_list
+  select case when s.a <= 20 then 1 when s.a <= 25 then 3 else s.a end
+  from generate_series(1, 30) s(a);
+select tableoid::regclass, count(*), min(a), max(a) from inlinecmp_list group by 1 order by 1;
+drop table inlinecmp_list;
+
+create table inlinecmp_ts (a timestamptz) partition by range (a);
+create table inlinecmp_ts_1 partition of inlinecmp_ts for values from ('2025-01-01') to ('2025-02-01');
+create table inlinecmp_ts_2 partition of inlinecmp_ts for values from ('2025-02-01') to ('2025-03-01');
+insert into inlinecmp_ts
+  select '2025-01-01'::timestamptz + s.a * interval '1 day' from generate_series(0, 58) s(a);
+select tableoid::regclass, count(*) from inlinecmp_ts group by 1 order by 1;
+drop table inlinecmp_ts;
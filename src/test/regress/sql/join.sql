@@ -386,6 +386,35 @@ select count(*) from tenk1 x where
   x.unique1 in (select aa.f1 from int4_tbl aa,float8_tbl bb where aa.f1=bb.f1);
 rollback;
 
+-- and with iterative dynamic programming
+begin;
+set idp_threshold = 2;
+set idp_block_size = 2;
+select count(*) from tenk1 x where
+  x.unique1 in (select a.f1 from int4_tbl a,float8_tbl b where a.f1=b.f1) and
+  x.unique1 = 0 and
+  x.unique1 in (select aa.f1 from int4_tbl aa,float8_tbl bb where aa.f1=bb.f1);
+select count(*) from tenk1 a
+  join tenk1 b on a.unique1 = b.unique2
+  left join tenk1 c on b.unique1 = c.unique2
+  join int4_tbl d on a.unique2 = d.f1;
+-- outer joins constrain the join order; IDP must still find a plan, or
+-- fall back to the regular search
+set idp_block_size = 3;
+select count(*) from tenk1 t1
+  left join (tenk1 t2 join tenk1 t3 on t2.unique1 = t3.unique1)
+    on t1.unique2 = t2.unique2
+  left join (int4_tbl t4 join int4_tbl t5 on t4.f1 = t5.f1)
+    on t3.unique2 = t4.f1
+  where t1.unique1 < 10;
+-- no 4-way join is legal here, see join_search_one_level()
+set idp_block_size = 4;
+select count(*) from tenk1 x where
+  x.unique1 in (select a.f1 from int4_tbl a,float8_tbl b where a.f1=b.f1) and
+  x.unique1 = 0 and
+  x.unique1 in (select aa.f1 from int4_tbl aa,float8_tbl bb where aa.f1=bb.f1);
+rollback;
+
 --
 -- regression test: be sure we cope with proven-dummy append rels
 --
@@ -3728,3 +3757,56 @@ SELECT COUNT(*) FROM onek t1 LEFT JOIN tenk1 t2
     ON (t2.thousand = t1.tenthous OR t2.thousand = t1.thousand);
 SELECT COUNT(*) FROM onek t1 LEFT JOIN tenk1 t2
     ON (t2.thousand = t1.tenthous OR t2.thousand = t1.thousand);
+
+--
+-- Test nested loop joins that switch to hashing the inner relation
+--
+
+create function adaptive_nl_rows(n int) returns setof int
+language plpgsql rows 1 as
+$$ begin return query select generate_series(1, n); end; $$;
+
+create function explain_adaptive_nl(query text) returns setof text
+language plpgsql as
+$$
+declare
+    ln text;
+begin
+    for ln in
+        execute format('explain (analyze, costs off, summary off, timing off, buffers off) %s',
+            query)
+    loop
+        ln := regexp_replace(ln, 'rows=\d+\.\d+', 'rows=N');
+        ln := regexp_replace(ln, 'loops=\d+', 'loops=N');
+        ln := regexp_replace(ln, 'Rows Removed by Join Filter: \d+', 'Rows Removed by Join Filter: N');
+        ln := regexp_replace(ln, 'Memory Usage: \d+', 'Memory Usage: N');
+        return next ln;
+    end loop;
+end;
+$$;
+
+begin;
+set local enable_adaptive_nestloop = on;
+set local enable_hashjoin = off;
+set local enable_mergejoin = off;
+set local enable_indexscan = off;
+set local enable_bitmapscan = off;
+
+select explain_adaptive_nl('
+select count(*), count(o.unique1), sum(o.unique1)
+from adaptive_nl_rows(1000) g left join onek o on o.unique1 = g');
+select count(*), count(o.unique1), sum(o.unique1)
+from adaptive_nl_rows(1000) g left join onek o on o.unique1 = g;
+
+-- null keys never match, and inner rows with equal keys are all returned
+select count(*), count(o.ten)
+from (select nullif(g, 500) as g from adaptive_nl_rows(1000) g) s
+  left join onek o on o.ten = s.g % 10;
+select count(*)
+from adaptive_nl_rows(1000) g
+where not exists (select 1 from onek o where o.unique1 = g);
+
+rollback;
+
+drop function adaptive_nl_rows(int);
+drop function explain_adaptive_nl(text);
@@ -1447,3 +1447,32 @@ select min(a) over (partition by a order by a) from part_abc where a >= stable_o
 
 drop view part_abc_view;
 drop table part_abc;
+
+-- Generic plans only lock the partitions that survive initial pruning
+create table lockpart (a int) partition by list (a);
+create table lockpart_1 partition of lockpart for values in (1);
+create table lockpart_2 partition of lockpart for values in (2);
+create table lockpart_3 partition of lockpart for values in (3);
+set plan_cache_mode = force_generic_plan;
+prepare lockpart_q (int) as select * from lockpart where a = $1;
+execute lockpart_q (1);
+begin;
+execute lockpart_q (2);
+select relation::regclass, mode from pg_locks
+  where pid = pg_backend_pid() and relation::regclass::text like 'lockpart%'
+  order by relation::regclass::text;
+commit;
+deallocate lockpart_q;
+-- ... but all of them if the pruning steps call a stable function, since
+-- the executor may get a different answer under its own snapshot
+prepare lockpart_s (int) as select * from lockpart where a = $1 + stable_one();
+execute lockpart_s (1);
+begin;
+execute lockpart_s (1);
+select relation::regclass, mode from pg_locks
+  where pid = pg_backend_pid() and relation::regclass::text like 'lockpart%'
+  order by relation::regclass::text;
+commit;
+deallocate lockpart_s;
+reset plan_cache_mode;
+drop table lockpart;
@@ -223,3 +223,31 @@ select name, generic_plans, custom_plans from pg_prepared_statements
   where  name = 'test_mode_pp';
 
 drop table test_mode;
+
+-- Test plan_cache_misestimate_factor
+create table test_misest (a int, b int);
+insert into test_misest select 1, g from generate_series(1,1000) g
+  union all select g, g from generate_series(2,100) g;
+analyze test_misest;
+prepare test_misest_pp (int) as
+  select b from test_misest where a = $1 order by b limit 1;
+set plan_cache_misestimate_factor = 10;
+execute test_misest_pp(1); -- 1x
+execute test_misest_pp(1); -- 2x
+execute test_misest_pp(1); -- 3x
+execute test_misest_pp(1); -- 4x
+execute test_misest_pp(1); -- 5x
+-- the generic plan expects only a few rows to sort, but gets 1000, and
+-- after three such executions it is put aside
+execute test_misest_pp(1);
+execute test_misest_pp(1);
+execute test_misest_pp(1);
+select name, generic_plans, custom_plans from pg_prepared_statements
+  where  name = 'test_misest_pp';
+-- so we should now be back to custom plans
+execute test_misest_pp(1);
+select name, generic_plans, custom_plans from pg_prepared_statements
+  where  name = 'test_misest_pp';
+reset plan_cache_misestimate_factor;
+deallocate test_misest_pp;
+drop table test_misest;
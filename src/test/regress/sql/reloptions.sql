@@ -9,6 +9,8 @@ CREATE TABLE reloptions_test2(i INT) WITH (fillfactor=2);
 CREATE TABLE reloptions_test2(i INT) WITH (fillfactor=110);
 CREATE TABLE reloptions_test2(i INT) WITH (autovacuum_analyze_scale_factor = -10.0);
 CREATE TABLE reloptions_test2(i INT) WITH (autovacuum_analyze_scale_factor = 110.0);
+CREATE TABLE reloptions_test2(i INT) WITH (insert_targets=0);
+CREATE TABLE reloptions_test2(i INT) WITH (insert_targets=1025);
 
 -- Fail when option and namespace do not exist
 CREATE TABLE reloptions_test2(i INT) WITH (not_existing_option=2);
@@ -1834,3 +1834,32 @@ SELECT * FROM check_estimated_rows('SELECT * FROM sb_2 WHERE extstat_small(y)');
 -- Tidy up
 DROP TABLE sb_1, sb_2 CASCADE;
 DROP FUNCTION extstat_small(x numeric);
+
+-- Extended statistics on both sides of a join on multiple columns
+CREATE TABLE ej_1 AS SELECT i % 100 AS a, i % 100 AS b
+  FROM generate_series(1, 1000) AS i;
+CREATE TABLE ej_2 AS SELECT i % 100 AS a, i % 100 AS b
+  FROM generate_series(1, 1000) AS i;
+ANALYZE ej_1, ej_2;
+
+SELECT * FROM check_estimated_rows('SELECT * FROM ej_1 JOIN ej_2 ON ej_1.a = ej_2.a AND ej_1.b = ej_2.b');
+
+-- statistics on just one side are not enough
+CREATE STATISTICS ej_1_nd (ndistinct) ON a, b FROM ej_1;
+ANALYZE ej_1;
+
+SELECT * FROM check_estimated_rows('SELECT * FROM ej_1 JOIN ej_2 ON ej_1.a = ej_2.a AND ej_1.b = ej_2.b');
+
+CREATE STATISTICS ej_2_nd (ndistinct) ON a, b FROM ej_2;
+ANALYZE ej_2;
+
+SELECT * FROM check_estimated_rows('SELECT * FROM ej_1 JOIN ej_2 ON ej_1.a = ej_2.a AND ej_1.b = ej_2.b');
+
+-- MCV lists on the join columns are used too
+CREATE STATISTICS ej_1_mcv (mcv) ON a, b FROM ej_1;
+CREATE STATISTICS ej_2_mcv (mcv) ON a, b FROM ej_2;
+ANALYZE ej_1, ej_2;
+
+SELECT * FROM check_estimated_rows('SELECT * FROM ej_1 JOIN ej_2 ON ej_1.a = ej_2.a AND ej_1.b = ej_2.b');
+
+DROP TABLE ej_1, ej_2;
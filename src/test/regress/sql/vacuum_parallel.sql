@@ -35,6 +35,20 @@ WHERE oid in ('regular_sized_index'::regclass, 'typically_sized_index'::regclass
 DELETE FROM parallel_vacuum_table;
 VACUUM (PARALLEL 4, INDEX_CLEANUP ON) parallel_vacuum_table;
 
+-- Let the parallel workers also vacuum the heap's dead items, even though
+-- there are only a few pages of them.  Leave every fourth row in place, and
+-- check that the heap and the indexes still agree on them afterwards.
+INSERT INTO parallel_vacuum_table SELECT i FROM generate_series(1, 10000) i;
+SET min_parallel_table_scan_size TO 0;
+DELETE FROM parallel_vacuum_table WHERE a % 4 <> 0;
+VACUUM (PARALLEL 4, INDEX_CLEANUP ON) parallel_vacuum_table;
+RESET min_parallel_table_scan_size;
+SELECT count(*), sum(a) FROM parallel_vacuum_table;
+SET enable_seqscan TO off;
+SELECT count(*), sum(a) FROM parallel_vacuum_table WHERE a > 0;
+RESET enable_seqscan;
+DELETE FROM parallel_vacuum_table;
+
 -- Since vacuum_in_leader_small_index uses deduplication, we expect an
 -- assertion failure with bug #17245 (in the absence of bugfix):
 INSERT INTO parallel_vacuum_table SELECT i FROM generate_series(1, 10000) i;